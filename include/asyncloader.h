@@ -0,0 +1,67 @@
+#ifndef ASYNCLOADER_H
+#define ASYNCLOADER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loader.h"
+#include "loadprogress.h"
+
+using namespace std;
+
+/**
+ * This class loads object files in the background, so that the program
+ * keeps rendering while a large file is parsed. Every file gets its own
+ * thread with its own loader, which produces an object that only lives
+ * in memory. The thread never touches OpenGL, the main thread takes the
+ * finished objects and sends them to the GPU itself.
+ *
+ * The loads are only started, cancelled and taken from the main thread.
+ * Their progress can be read at any time.
+ */
+class AsyncLoader
+{
+    public:
+        // What the gui shows about a load.
+        struct Status {
+            string fileName;
+            int stage;
+            size_t bytesParsed;
+            size_t totalBytes;
+            bool cancelled;
+        };
+
+        AsyncLoader() {}
+        ~AsyncLoader();
+
+        AsyncLoader(const AsyncLoader&) = delete;
+        AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+        void start(const string &fileName, const string &filePath, const Loader::LoaderInfo &lInfo);
+        void cancel(size_t job);
+        bool takeFinished(Object &object, bool &success, string &output);
+
+        vector<Status> getStatus() const;
+        bool empty() const { return jobs.empty(); }
+        size_t size() const { return jobs.size(); }
+
+    private:
+        struct Job {
+            string fileName;
+            LoadProgress progress;
+            thread worker;
+            atomic<bool> finished;
+            Object object;
+            bool success = false;
+            string output;
+
+            Job(const string &fileName) : fileName(fileName), finished(false), object(fileName) {}
+        };
+
+        vector<unique_ptr<Job>> jobs;
+};
+
+#endif
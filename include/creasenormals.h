@@ -0,0 +1,102 @@
+#ifndef CREASENORMALS_H
+#define CREASENORMALS_H
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "vertex.h"
+#include "normalgenerator.h"
+
+using namespace std;
+
+/**
+ * This class generates vertex normals that keep hard edges. Two
+ * triangles that share an edge at a vertex are smoothed together if
+ * they are in the same smoothing group of the object file and if the
+ * angle between them is below the crease angle. The corners of a vertex
+ * that are joined this way, directly or through other corners, form one
+ * fan that gets the weighted sum of the normals of its triangles, and a
+ * vertex is split into one vertex for each of its fans.
+ *
+ * The mesh without any split vertices is kept, together with the face
+ * normals and the adjacency from the normal generator, and the pairs of
+ * corners around each vertex that share an edge. Edges are found by the
+ * position of their other end, so a texture seam does not break a fan.
+ * The fans are found by
+ * joining the pairs, so the work for a vertex grows with the number of
+ * its corners and not with its square. For every vertex the smallest
+ * and largest cosine of its pairs is also kept, so when the crease
+ * angle changes only the vertices with a pair between the old and the
+ * new angle are computed again.
+ *
+ * Smoothing groups are only used if the object file has any, since a
+ * file without them would otherwise become completely flat.
+ */
+class CreaseNormals
+{
+    public:
+        void setMesh(const vector<Vertex> &vertices, const vector<unsigned int> &triangles,
+                     const vector<unsigned int> &groups, NormalGenerator::Weighting weighting);
+        bool needsUpdate(float creaseAngle, bool useGroups) const;
+        size_t update(float creaseAngle, bool useGroups);
+        void writeMesh(vector<Vertex> &vertices, vector<unsigned int> &triangles) const;
+
+        bool empty() const { return baseVertices.empty(); }
+        bool hasGroups() const { return fileHasGroups; }
+        size_t splitVertexCount() const { return nExtraVertices; }
+        const vector<unsigned int>& getBaseTriangles() const { return baseTriangles; }
+
+    private:
+        // Vertices per task when the vertices are updated.
+        static const size_t TASK_SIZE = 4096;
+        // Corners that share an edge and whose normals are closer than this are always smoothed.
+        static constexpr float SAME_NORMAL = 0.99999f;
+
+        // Two entries of the adjacency of a vertex whose triangles share an edge.
+        struct CornerPair {
+            unsigned int first;
+            unsigned int second;
+            // The cosine between the triangles, above 1 if either has no direction.
+            float cosine;
+            bool sameGroup;
+        };
+
+        vector<Vertex> baseVertices;
+        vector<unsigned int> baseTriangles;
+        bool fileHasGroups = false;
+
+        // The corners of vertex v are adjacency[adjacencyStart[v]] up to adjacencyStart[v + 1].
+        vector<unsigned int> adjacencyStart;
+        vector<unsigned int> adjacency;
+        // Per entry of the adjacency: the unit normal, weighted normal and group of its triangle.
+        vector<glm::vec3> unitNormals;
+        vector<glm::vec3> weightedNormals;
+        vector<unsigned int> cornerGroups;
+
+        // The pairs of vertex v are pairs[pairStart[v]] up to pairStart[v + 1].
+        vector<unsigned int> pairStart;
+        vector<CornerPair> pairs;
+        // The fan of each entry of the adjacency while a vertex is computed.
+        vector<unsigned int> fanRoot;
+
+        // Cosine range of the pairs of each vertex that can be smoothed together.
+        vector<float> minCosine, maxCosine;
+
+        // The normals of each vertex are stored in the slots of its adjacency.
+        vector<glm::vec3> slotNormals;
+        vector<unsigned int> nSlots;
+        vector<unsigned int> cornerSlot;
+        size_t nExtraVertices = 0;
+
+        float appliedCosine = 0.0f;
+        bool appliedGroups = false;
+        bool applied = false;
+
+        void findPairs(size_t v, const vector<unsigned int> &positionIds,
+                       vector<pair<unsigned int, unsigned int>> &edges, vector<CornerPair> &vertexPairs) const;
+        void updateVertex(size_t v, float cosine, bool useGroups, bool full);
+        unsigned int findRoot(unsigned int a);
+        static float toCosine(float creaseAngle);
+};
+
+#endif
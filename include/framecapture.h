@@ -0,0 +1,78 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <GL/glew.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+
+#include "glresource.h"
+
+using namespace std;
+
+/**
+ * This class renders into a framebuffer that is not shown anywhere and
+ * saves the rendered frames as PNG files, which makes it possible to
+ * render without a visible window.
+ *
+ * A frame is read back into one of a few pixel buffer objects, so
+ * glReadPixels returns at once and the GPU copies the pixels while the
+ * next frame is drawn. A fence marks when the copy is done, and only
+ * then is the buffer mapped. The pixels are compressed and written by
+ * the shared thread pool, so the main thread never waits for the disk.
+ */
+class FrameCapture
+{
+    public:
+        FrameCapture() {}
+        ~FrameCapture();
+
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        bool create(int width, int height);
+        void bind() const;
+        void unbind() const;
+        void readBack(const string &fileName);
+        void collect(bool wait);
+        void finish();
+
+        int width() const { return captureWidth; }
+        int height() const { return captureHeight; }
+        size_t writtenCount() const { return nWritten; }
+        size_t failedCount() const { return nFailed; }
+
+    private:
+        // A frame that is being copied into a pixel buffer.
+        struct Readback {
+            GLBuffer buffer;
+            GLsync fence = 0;
+            string fileName;
+        };
+
+        // How many frames can be copied at the same time.
+        static const size_t RING_SIZE = 3;
+
+        GLFramebuffer framebuffer;
+        GLRenderbuffer colorBuffer;
+        GLRenderbuffer depthBuffer;
+        int captureWidth = 0;
+        int captureHeight = 0;
+
+        Readback ring[RING_SIZE];
+        // The frames from nCollected up to nRead are being copied.
+        size_t nRead = 0;
+        size_t nCollected = 0;
+
+        mutex writeMutex;
+        condition_variable writeDone;
+        size_t writesInFlight = 0;
+        atomic<size_t> nWritten{0};
+        atomic<size_t> nFailed{0};
+
+        bool collectOldest(bool wait);
+        void waitForWrites();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "vertex.h"
+
+using namespace std;
+
+/**
+ * This file contains the bounding volumes of the objects and the
+ * view frustum that they are tested against. Every object and every
+ * material group of an object gets both an axis aligned bounding box
+ * and a bounding sphere when it is loaded. The sphere is a cheap first
+ * test and the box is used to refine the result of the spheres that
+ * pass.
+ */
+
+/**
+ * An axis aligned bounding box together with a bounding sphere,
+ * both in the coordinates of the object.
+ */
+struct BoundingVolume {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    static BoundingVolume fromVertices(const vector<Vertex> &vertices);
+    static BoundingVolume fromIndices(const vector<Vertex> &vertices, const vector<unsigned int> &indices);
+};
+
+/**
+ * A set of spheres stored as a structure of arrays. Keeping each
+ * component in its own array lets the frustum test many spheres
+ * against a plane in a loop the compiler can vectorize.
+ */
+struct SphereSet {
+    vector<float> x;
+    vector<float> y;
+    vector<float> z;
+    vector<float> r;
+
+    void clear() { x.clear(); y.clear(); z.clear(); r.clear(); }
+    void add(const glm::vec3 &center, float radius);
+    size_t size() const { return r.size(); }
+};
+
+/**
+ * The six planes of a view frustum. The planes are extracted from a
+ * combined projection and view matrix and point into the frustum, so
+ * a point is inside when its distance to every plane is positive.
+ */
+class Frustum
+{
+    public:
+        enum Containment {
+            OUTSIDE,
+            INTERSECTS,
+            INSIDE
+        };
+
+        void extract(const glm::mat4 &projView);
+
+        void cullSpheres(const SphereSet &spheres, vector<unsigned char> &visible) const;
+        bool intersects(const BoundingVolume &volume, const glm::mat4 &M) const;
+        Containment classify(const glm::vec3 &min, const glm::vec3 &max) const;
+
+        static float maxScale(const glm::mat4 &M);
+
+    private:
+        glm::vec4 planes[6];
+};
+
+#endif
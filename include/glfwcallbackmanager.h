@@ -28,6 +28,55 @@ class glfwCallbackManager
         if(app)
             app->keyCallback(window, key, scancode, action, mods);
     }
+
+    // The callbacks below replace the ones imgui installed, so they pass the input on to imgui.
+    static void cursorPosCallback(GLFWwindow* window, double x, double y)
+    {
+        ImGui_ImplGlfw_CursorPosCallback(window, x, y);
+        if(app)
+            app->inputCallback(window);
+    }
+
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+    {
+        ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
+        if(app)
+            app->inputCallback(window);
+    }
+
+    static void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+    {
+        ImGui_ImplGlfw_ScrollCallback(window, xoffset, yoffset);
+        if(app)
+            app->inputCallback(window);
+    }
+
+    static void charCallback(GLFWwindow* window, unsigned int c)
+    {
+        ImGui_ImplGlfw_CharCallback(window, c);
+        if(app)
+            app->inputCallback(window);
+    }
+
+    static void windowFocusCallback(GLFWwindow* window, int focused)
+    {
+        ImGui_ImplGlfw_WindowFocusCallback(window, focused);
+        if(app)
+            app->inputCallback(window);
+    }
+
+    static void cursorEnterCallback(GLFWwindow* window, int entered)
+    {
+        ImGui_ImplGlfw_CursorEnterCallback(window, entered);
+        if(app)
+            app->inputCallback(window);
+    }
+
+    static void refreshCallback(GLFWwindow* window)
+    {
+        if(app)
+            app->inputCallback(window);
+    }
     
 public:
     static void initCallbacks(Studio3D* std3dapp)
@@ -37,5 +86,12 @@ public:
         glfwSetErrorCallback(errorCallback);
         glfwSetFramebufferSizeCallback(app->window() , resizeCallback);
         glfwSetKeyCallback(app->window(), keyCallback);
+        glfwSetCursorPosCallback(app->window(), cursorPosCallback);
+        glfwSetMouseButtonCallback(app->window(), mouseButtonCallback);
+        glfwSetScrollCallback(app->window(), scrollCallback);
+        glfwSetCharCallback(app->window(), charCallback);
+        glfwSetWindowFocusCallback(app->window(), windowFocusCallback);
+        glfwSetCursorEnterCallback(app->window(), cursorEnterCallback);
+        glfwSetWindowRefreshCallback(app->window(), refreshCallback);
     }
 };
@@ -0,0 +1,134 @@
+#ifndef GLRESOURCE_H
+#define GLRESOURCE_H
+
+#include "gltypes.h"
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * This file contains owning wrappers for OpenGL objects. A wrapper
+ * holds the name of a single OpenGL object and deletes it when the
+ * wrapper is destroyed, which means that objects can never be leaked
+ * when the owner of the wrapper goes away.
+ *
+ * The wrappers can be moved but not copied, so there is always
+ * exactly one owner of an OpenGL object. The object is not created
+ * until create() is called, so a wrapper can be constructed without
+ * a current OpenGL context.
+ *
+ * Each wrapper type counts how many of its objects that are alive,
+ * which makes it easy to check that resetting the scene frees all
+ * the memory on the GPU.
+ *
+ * Without OpenGL (NO_GL) the wrappers never hold an object, so the
+ * objects that own them can still be used on the CPU.
+ */
+template<class Traits>
+class GLResource
+{
+    public:
+        GLResource() {}
+        ~GLResource() { destroy(); }
+
+        GLResource(const GLResource&) = delete;
+        GLResource& operator=(const GLResource&) = delete;
+
+        GLResource(GLResource &&other) noexcept : handle(other.handle) { other.handle = 0; }
+        GLResource& operator=(GLResource &&other) noexcept
+        {
+            if(this != &other) {
+                destroy();
+                handle = other.handle;
+                other.handle = 0;
+            }
+            return *this;
+        }
+
+        /**
+         * Creates a new OpenGL object, any object that was held
+         * before is deleted first.
+         */
+        void create()
+        {
+            destroy();
+            Traits::generate(handle);
+            if(handle != 0) nAlive++;
+        }
+
+        /**
+         * Deletes the held OpenGL object, if there is one.
+         */
+        void destroy()
+        {
+            if(handle == 0) return;
+            Traits::remove(handle);
+            handle = 0;
+            nAlive--;
+        }
+
+        GLuint id() const { return handle; }
+        bool valid() const { return handle != 0; }
+
+        static size_t aliveCount() { return nAlive; }
+
+    private:
+        GLuint handle = 0;
+        static size_t nAlive;
+};
+
+template<class Traits>
+size_t GLResource<Traits>::nAlive = 0;
+
+#ifdef NO_GL
+struct GLNoTraits {
+    static void generate(GLuint &handle) { handle = 0; }
+    static void remove(GLuint) {}
+};
+
+typedef GLResource<GLNoTraits> GLBuffer;
+typedef GLResource<GLNoTraits> GLVertexArray;
+typedef GLResource<GLNoTraits> GLTexture;
+typedef GLResource<GLNoTraits> GLQuery;
+typedef GLResource<GLNoTraits> GLFramebuffer;
+typedef GLResource<GLNoTraits> GLRenderbuffer;
+#else
+struct GLBufferTraits {
+    static void generate(GLuint &handle) { glGenBuffers(1, &handle); }
+    static void remove(GLuint handle) { glDeleteBuffers(1, &handle); }
+};
+
+struct GLVertexArrayTraits {
+    static void generate(GLuint &handle) { glGenVertexArrays(1, &handle); }
+    static void remove(GLuint handle) { glDeleteVertexArrays(1, &handle); }
+};
+
+struct GLTextureTraits {
+    static void generate(GLuint &handle) { glGenTextures(1, &handle); }
+    static void remove(GLuint handle) { glDeleteTextures(1, &handle); }
+};
+
+struct GLQueryTraits {
+    static void generate(GLuint &handle) { glGenQueries(1, &handle); }
+    static void remove(GLuint handle) { glDeleteQueries(1, &handle); }
+};
+
+struct GLFramebufferTraits {
+    static void generate(GLuint &handle) { glGenFramebuffers(1, &handle); }
+    static void remove(GLuint handle) { glDeleteFramebuffers(1, &handle); }
+};
+
+struct GLRenderbufferTraits {
+    static void generate(GLuint &handle) { glGenRenderbuffers(1, &handle); }
+    static void remove(GLuint handle) { glDeleteRenderbuffers(1, &handle); }
+};
+
+typedef GLResource<GLBufferTraits> GLBuffer;
+typedef GLResource<GLVertexArrayTraits> GLVertexArray;
+typedef GLResource<GLTextureTraits> GLTexture;
+typedef GLResource<GLQueryTraits> GLQuery;
+typedef GLResource<GLFramebufferTraits> GLFramebuffer;
+typedef GLResource<GLRenderbufferTraits> GLRenderbuffer;
+#endif
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef GLTYPES_H
+#define GLTYPES_H
+
+/**
+ * This file includes OpenGL for the headers that only need its types.
+ * Programs that are built with NO_GL, like the mesh benchmark, get the
+ * types without OpenGL, so they can use the objects on the CPU without
+ * linking GLEW or a driver.
+ */
+#ifdef NO_GL
+typedef unsigned int GLenum;
+typedef unsigned int GLuint;
+typedef int GLint;
+typedef int GLsizei;
+typedef float GLfloat;
+#else
+#include <GL/glew.h>
+#endif
+
+#endif
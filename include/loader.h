@@ -4,6 +4,8 @@
 #include <cstring>
 
 #include "object.h"
+#include "meshcache.h"
+#include "objparser.h"
 #include "tiny_obj_loader.h"
 
 using namespace std;
@@ -27,9 +29,44 @@ class Loader
 {   
     public:
 
-        Object parseFile(bool&, string, string);
+        struct LoaderInfo {
+            bool useMeshCache = true;
+            bool useParallelParser = true;
+            int normalWeighting = NormalGenerator::ANGLE_WEIGHTED;
+            float creaseAngle = 180.0f;
+            bool useSmoothingGroups = true;
+            bool optimizeMeshes = true;
+            float overdrawThreshold = 1.05f;
+            bool generateLods = true;
+            bool runNormalBenchmark = false;
+        };
+
+        Object parseFile(bool&, string, string, const LoaderInfo&, LoadProgress *progress = NULL);
         void normalizeVertexCoords(vector<Vertex>&, float l);
         string outputString = "";
         string getOutputString() const { return outputString; }
 
+    private:
+        // The position, normal and texture coordinate index of a face corner.
+        struct IndexTriplet {
+            int v, vn, vt;
+            bool operator==(const IndexTriplet &o) const { return v == o.v && vn == o.vn && vt == o.vt; }
+        };
+
+        struct IndexTripletHash {
+            size_t operator()(const IndexTriplet &t) const {
+                size_t h = static_cast<size_t>(t.v)*73856093u;
+                h ^= static_cast<size_t>(t.vn)*19349663u;
+                h ^= static_cast<size_t>(t.vt)*83492791u;
+                return h;
+            }
+        };
+
+        MeshCache meshCache;
+        ObjParser objParser = ObjParser(ThreadPool::shared());
+
+        bool finishObject(Object &object, const LoaderInfo &lInfo, LoadProgress *progress);
+        static bool matchesSettings(const Object &object, const LoaderInfo &lInfo);
+        bool isCancelled(const LoadProgress *progress);
+
 };
\ No newline at end of file
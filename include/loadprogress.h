@@ -0,0 +1,45 @@
+#ifndef LOADPROGRESS_H
+#define LOADPROGRESS_H
+
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * This struct is shared between a thread that loads an object and the
+ * gui that shows how far it has come. The loader writes the stage and
+ * the number of bytes parsed, and the gui can ask it to stop. All
+ * values are atomic, so they can be read and written at any time.
+ */
+struct LoadProgress
+{
+    enum Stage {
+        WAITING,
+        READING_CACHE,
+        READING_FILE,
+        PARSING,
+        BUILDING_MESH,
+        OPTIMIZING,
+        GENERATING_NORMALS,
+        BUILDING_LODS,
+        DONE
+    };
+
+    atomic<int> stage;
+    atomic<size_t> bytesParsed;
+    atomic<size_t> totalBytes;
+    atomic<bool> cancelled;
+
+    LoadProgress() : stage(WAITING), bytesParsed(0), totalBytes(0), cancelled(false) {}
+
+    static const char* stageName(int stage)
+    {
+        static const char *names[] = {
+            "Waiting", "Reading mesh cache", "Reading file", "Parsing", "Building mesh",
+            "Optimizing", "Generating normals", "Building levels of detail", "Done" };
+        return stage >= WAITING && stage <= DONE ? names[stage] : "";
+    }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef MESHBENCHMARK_H
+#define MESHBENCHMARK_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "object.h"
+
+using namespace std;
+
+/**
+ * This class measures the parts of loading an object that run on the
+ * CPU: parsing the file, both cold and from a warm mesh cache,
+ * generating normals and texture coordinates, and finding and
+ * normalizing the size of the object. Nothing is sent to the GPU, so
+ * no OpenGL context is needed.
+ *
+ * Each function is measured on the given object files and on synthetic
+ * spheres of 1k to 10M triangles. A function is called until it has
+ * run for at least the minimum time, and the mean time of a call is
+ * reported along with how many triangles and megabytes it handles each
+ * second and how many allocations it makes. On the spheres the normal
+ * generator is also compared to the implementation it replaced.
+ *
+ * The benchmark is built as its own program with NO_GL, see the bench
+ * target of the Makefile. The allocations are counted by replacing the
+ * global operator new of that program, which only counts while a
+ * benchmark runs. Allocations on the worker threads of a call count as
+ * well.
+ */
+class MeshBenchmark
+{
+    public:
+        struct Result {
+            string name;
+            string mesh;
+            size_t iterations;
+            // Mean time of a call, in milliseconds.
+            double time;
+            double trianglesPerSecond;
+            double megabytesPerSecond;
+            double allocationsPerCall;
+            double bytesAllocatedPerCall;
+        };
+
+        // Synthetic files larger than this are not parsed, since they take minutes to write.
+        static const size_t MAX_PARSED_TRIANGLES = 1000000;
+
+        MeshBenchmark(double minTime = 0.5) : minTime(minTime) {}
+
+        void runFile(const string &objFile);
+        void runSynthetic(size_t nTriangles);
+        string report() const;
+
+        const vector<Result>& getResults() const { return results; }
+
+        static void makeSphere(size_t nTriangles, Object &object);
+
+    private:
+        double minTime;
+        vector<Result> results;
+        // The reports of NormalGenerator::benchmark on the spheres.
+        vector<string> comparisons;
+
+        void runParse(const string &fileName, const string &filePath, const string &mesh);
+        void runObject(Object &object, const string &mesh);
+        template<class Function>
+        void measure(const string &name, const string &mesh, size_t nTriangles, size_t nBytes, Function function);
+};
+
+#endif
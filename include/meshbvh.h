@@ -0,0 +1,66 @@
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "vertex.h"
+
+using namespace std;
+
+/**
+ * This class is a bounding volume hierarchy over the triangles of a
+ * single mesh, in the coordinates of the object. It is used to find
+ * where a ray hits the mesh without testing every triangle, which is
+ * what makes picking objects with the mouse fast.
+ *
+ * The triangles are copied into the tree as a corner and two edges,
+ * so a ray test only reads the tree itself. The tree is built with a
+ * binned surface area heuristic in the same way as the scene BVH.
+ *
+ * A built tree can also be set from its arrays, which is how the mesh
+ * cache gives it back without building it again.
+ */
+class MeshBVH
+{
+    public:
+        struct Triangle {
+            glm::vec3 v0;
+            glm::vec3 edge1;
+            glm::vec3 edge2;
+        };
+
+        // Either an inner node with two children at first and first + 1,
+        // or a leaf with count triangles starting at first.
+        struct Node {
+            glm::vec3 min;
+            unsigned int first;
+            glm::vec3 max;
+            unsigned int count;
+        };
+
+        void clear();
+        void addTriangles(const vector<Vertex> &vertices, const vector<unsigned int> &indices);
+        void build();
+
+        bool intersect(const glm::vec3 &origin, const glm::vec3 &direction, float &t) const;
+
+        size_t triangleCount() const { return triangles.size(); }
+        const vector<Triangle>& getTriangles() const { return triangles; }
+        const vector<Node>& getNodes() const { return nodes; }
+        bool setTree(const Triangle *newTriangles, size_t nTriangles, const Node *newNodes, size_t nNodes);
+
+    private:
+        static const int SAH_BINS = 8;
+        static const unsigned int MAX_LEAF_SIZE = 4;
+        static const unsigned int MAX_DEPTH = 60;
+
+        vector<Triangle> triangles;
+        vector<glm::vec3> centroids;
+        vector<Node> nodes;
+
+        void updateNodeBounds(Node &node) const;
+        bool findSplit(const Node &node, int &axis, float &position) const;
+        bool intersectTriangle(const Triangle &triangle, const glm::vec3 &origin, const glm::vec3 &direction, float &t) const;
+};
+
+#endif
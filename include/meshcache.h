@@ -0,0 +1,71 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "object.h"
+
+using namespace std;
+
+/**
+ * This class handles the binary mesh cache of the program. When an
+ * object has been loaded, the final vertices and the material groups
+ * of the object are written to a flat little-endian file, together
+ * with its levels of detail and its triangle tree. The next time the
+ * same object file is loaded the cache file is memory mapped and
+ * copied straight into the object, which skips the parsing and all
+ * the work the loader does after it.
+ *
+ * Generated normals are stored with the settings they were made with,
+ * and the loader only uses the cache file if its settings are the
+ * same. The vertex that each vertex was split from is stored as well,
+ * so the hard edges can be found again when the crease angle changes.
+ *
+ * A cache file is only used if the path, modification time and
+ * size of both the object file and all its material files are
+ * unchanged since the cache file was written.
+ *
+ * Cache file layout (all values little-endian):
+ *
+ *      - Header        (magic, version, counts and section offsets)
+ *      - Source path   (the path of the object file)
+ *      - File stamps   (size, mtime and path of each material file)
+ *      - Object info   (normal settings, and the error and triangles of each level of detail)
+ *      - Vertices      (the Object::vertices array, 8 byte aligned)
+ *      - Face records  (material and index range of each Object::Face)
+ *      - Indices       (all face indices, in face order)
+ *      - Groups        (the smoothing group of each triangle, in face order)
+ *      - LOD counts    (the index count of each level of detail of each face, level by level)
+ *      - LOD indices   (the indices of each level of detail, in the same order)
+ *      - Base vertices (the vertex each vertex was split from, if the normals were generated)
+ *      - Triangle tree (the triangles and then the nodes of the MeshBVH)
+ */
+class MeshCache
+{
+    public:
+        MeshCache(string cacheDir = ".meshcache");
+
+        bool load(string objFile, Object &object);
+        bool store(string objFile, const Object &object);
+        string getCacheFile(string objFile) const;
+
+    private:
+        // Increase when the layout of the cache or the loader output changes.
+        static const uint32_t CACHE_VERSION = 6;
+
+        struct FileStamp {
+            string path;
+            uint64_t size = 0;
+            int64_t mtime = 0;
+        };
+
+        string cacheDir;
+
+        bool readStamp(string path, FileStamp &stamp) const;
+        vector<string> findMaterialLibs(string objFile) const;
+        bool validate(const unsigned char *data, size_t size, string objFile, Object &object) const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include "vertex.h"
+
+using namespace std;
+
+/**
+ * This class reorders the triangles and vertices of a mesh so that the
+ * GPU does less work when drawing it. It is used by the loader in three
+ * steps:
+ *
+ *      - Vertex cache: The triangles of each group of faces are ordered
+ *                      with the method of Tom Forsyth, where every step
+ *                      picks the triangle whose vertices are most likely
+ *                      to still be in the post-transform cache.
+ *      - Overdraw:     The cache friendly order is split into clusters
+ *                      where the cache would be cold anyway, and the
+ *                      clusters that face out from the center of the mesh
+ *                      are drawn first so that they hide the ones behind.
+ *      - Vertex fetch: The vertices are renumbered in the order that the
+ *                      triangles first use them.
+ *
+ * Each step returns a new order instead of changing the mesh, so other
+ * data that follows the triangles can be reordered with them. The order
+ * of the triangles holds the index of the old triangle at each new place,
+ * and the vertex remap holds the new index of each old vertex.
+ *
+ * The vertex cache of the GPU is simulated as a FIFO cache to measure
+ * the result. ACMR is the number of transformed vertices per triangle
+ * and ATVR the number per unique vertex, where 1.0 is optimal.
+ */
+class MeshOptimizer
+{
+    public:
+        struct VertexCacheStats {
+            float acmr = 0.0f;
+            float atvr = 0.0f;
+        };
+
+        static vector<unsigned int> vertexCacheOrder(const vector<unsigned int> &indices, size_t nVertices);
+        static vector<unsigned int> overdrawOrder(const vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold);
+        static vector<unsigned int> vertexFetchRemap(const vector<unsigned int> &indices, size_t nVertices);
+
+        static VertexCacheStats analyzeVertexCache(const vector<unsigned int> &indices, size_t nVertices, unsigned int cacheSize = SIMULATED_CACHE_SIZE);
+
+    private:
+        // The size of the cache that triangles are scored against, and of the simulated cache.
+        static const unsigned int SCORING_CACHE_SIZE = 32;
+        static const unsigned int SIMULATED_CACHE_SIZE = 16;
+        // Vertices with more triangles left than this are scored as if they had this many.
+        static const unsigned int MAX_VALENCE = 32;
+
+        static float vertexScore(int cachePosition, unsigned int liveTriangles);
+};
+
+#endif
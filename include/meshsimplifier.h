@@ -0,0 +1,70 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "vertex.h"
+
+using namespace std;
+
+/**
+ * This class simplifies a mesh by collapsing edges, with the quadric
+ * error metric of Garland and Heckbert. Every vertex has a quadric that
+ * measures the squared distance to the planes of the triangles around
+ * it, weighted by their area. An edge is collapsed by moving one of its
+ * vertices onto the other, and the edges whose collapse moves the
+ * surface the least are collapsed first.
+ *
+ * Vertices are never moved or created, only removed, so a simplified
+ * mesh uses the same vertices as the full mesh and can share its vertex
+ * buffer. Vertices where the attributes of the surface are not
+ * continuous are never removed:
+ *
+ *      - Seams:     Vertices that have the same position as another
+ *                   vertex, where the normal or texture coordinate of
+ *                   the surface changes.
+ *      - Materials: Vertices that are used by more than one group of faces.
+ *      - Borders:   Vertices on an edge with only one triangle, or with
+ *                   more than two.
+ *
+ * The simplifier keeps its quadrics between calls, so a chain of levels
+ * of detail can be made by simplifying the result of the last call again.
+ */
+class MeshSimplifier
+{
+    public:
+        MeshSimplifier(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<unsigned int> &triangleGroups);
+
+        float simplify(vector<unsigned int> &indices, vector<unsigned int> &triangleGroups, size_t targetTriangles);
+
+        size_t lockedVertexCount() const;
+
+    private:
+        // A symmetric 4x4 matrix, and the total area of the planes in it.
+        struct Quadric {
+            double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+            double a11 = 0, a12 = 0, a13 = 0;
+            double a22 = 0, a23 = 0;
+            double a33 = 0;
+            double weight = 0;
+
+            void addPlane(double nx, double ny, double nz, double d, double area);
+            void add(const Quadric &q);
+            double error(const glm::vec3 &p) const;
+        };
+
+        struct Collapse {
+            unsigned int from;
+            unsigned int to;
+            double cost;
+        };
+
+        vector<glm::vec3> positions;
+        vector<Quadric> quadrics;
+        vector<unsigned char> locked;
+
+        bool flips(const vector<unsigned int> &indices, const vector<unsigned int> &triangleStart,
+                   const vector<unsigned int> &vertexTriangles, unsigned int from, unsigned int to) const;
+};
+
+#endif
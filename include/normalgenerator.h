@@ -0,0 +1,79 @@
+#ifndef NORMALGENERATOR_H
+#define NORMALGENERATOR_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+#include "vertex.h"
+#include "threadpool.h"
+
+using namespace std;
+
+/**
+ * This class generates vertex normals for meshes that have none. The
+ * normal of a vertex is the weighted sum of the normals of all the
+ * triangles that use it, where each triangle is weighted either by
+ * its area or by the angle of the triangle at the vertex.
+ *
+ * The work is done in three passes that all run on the thread pool:
+ *
+ *      - Face normals: The positions are stored as a structure of
+ *                      arrays and the cross products of four triangles
+ *                      are computed at once with SSE, with a plain loop
+ *                      as a fallback when SSE is not available.
+ *      - Adjacency:    The corners that use each vertex are sorted into
+ *                      a compressed list per vertex. Every task counts
+ *                      and fills only its own part of the triangles.
+ *      - Gather:       Every vertex sums the normals of its own corners,
+ *                      so no two tasks ever write to the same vertex.
+ *
+ * The face normals, corner weights and adjacency are kept after a run
+ * and can be used by other passes that need to know which triangles
+ * share a vertex, such as the crease aware normals.
+ */
+class NormalGenerator
+{
+    public:
+        enum Weighting {
+            AREA_WEIGHTED,
+            ANGLE_WEIGHTED
+        };
+
+        NormalGenerator(ThreadPool &pool);
+
+        void generate(vector<Vertex> &vertices, const vector<unsigned int> &triangles, Weighting weighting);
+        void prepare(const vector<Vertex> &vertices, const vector<unsigned int> &triangles, Weighting weighting);
+
+        // The normal of triangle t, unit length for angle weighting and twice the area long otherwise.
+        glm::vec3 getFaceNormal(size_t t) const { return glm::vec3(nx[t], ny[t], nz[t]); }
+        float getCornerWeight(size_t corner) const { return currentWeighting == ANGLE_WEIGHTED ? cornerWeights[corner] : 1.0f; }
+
+        const vector<unsigned int>& getAdjacencyStart() const { return adjacencyStart; }
+        const vector<unsigned int>& getAdjacency() const { return adjacency; }
+
+        static void generateReference(vector<Vertex> &vertices, const vector<unsigned int> &triangles);
+        static string benchmark(const vector<Vertex> &vertices, const vector<unsigned int> &triangles);
+
+    private:
+        // Triangles and vertices per task, small parts are not worth a task.
+        static const size_t TASK_SIZE = 16384;
+
+        ThreadPool &pool;
+        Weighting currentWeighting = AREA_WEIGHTED;
+
+        // Vertex positions, one array per component.
+        vector<float> px, py, pz;
+        // Face normals, one per triangle, and the weight of each corner.
+        vector<float> nx, ny, nz;
+        vector<float> cornerWeights;
+        // The corners of vertex v are adjacency[adjacencyStart[v]] up to adjacencyStart[v + 1].
+        vector<unsigned int> adjacencyStart;
+        vector<unsigned int> adjacency;
+
+        void computeFaceNormals(const unsigned int *triangles, size_t first, size_t last, Weighting weighting);
+        void buildAdjacency(const vector<unsigned int> &triangles, size_t nVertices);
+        void parallelRanges(size_t n, const function<void(size_t, size_t)> &task);
+};
+
+#endif
@@ -5,11 +5,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/component_wise.hpp>
-#include <GL/glew.h>
-#include <GLFW/glfw3.h>
 #include <vector>
 #include <iostream>
 #include "vertex.h"
+#include "gltypes.h"
+#include "glresource.h"
+#include "shaderprogram.h"
+#include "frustum.h"
+#include "meshbvh.h"
+#include "normalgenerator.h"
+#include "creasenormals.h"
+#include "meshoptimizer.h"
+#include "packedvertex.h"
 
 #define BUFFER_OFFSET(i) (reinterpret_cast<char*>(0 + (i)))
 
@@ -24,7 +31,25 @@ using namespace std;
  * 
  * Each object also holds their own vertex buffer and index 
  * buffer. This is to make it possible for multiple objects to
- * be rendered in the scene simultaneously.
+ * be rendered in the scene simultaneously. An object can also
+ * be drawn several times with one draw call by adding instances,
+ * where each instance has its own placement but shares all the
+ * buffers of the object. The buffers are
+ * owned by the object and freed with it, which is why an object
+ * can only be moved and never copied.
+ * 
+ * Generated normals keep the hard edges given by the smoothing
+ * groups and the crease angle of the object, and can be made
+ * again when the crease angle changes.
+ * 
+ * Dense objects also have simplified levels of detail that use
+ * the same vertices, with their indices after the full indices
+ * in the index buffer. The renderer picks which level is drawn.
+ * 
+ * The object and each group of faces have a bounding volume
+ * that is used to skip the parts that are outside the view.
+ * The triangles of the object are also kept in a tree so that
+ * rays can be tested against the object when picking.
  * 
  * Author: Christoffer Nordlander (c20cnr@cs.umu.se)
  * 
@@ -40,10 +65,38 @@ class Object
         struct ObjectInfo {
             size_t nShapes = 0;
             int nVertices = 0;
+            int nUnweldedVertices = 0;
             int nFaces = 0;
             int nIndices = 0;
             int nVertexNormals = 0;
             int nTexCoords = 0;
+            bool normalsGenerated = false;
+            int normalWeighting = NormalGenerator::AREA_WEIGHTED;
+            float creaseAngle = 180.0f;
+            bool useSmoothingGroups = true;
+            bool hasSmoothingGroups = false;
+            int nSplitVertices = 0;
+            int nNormalsUpdated = 0;
+            double normalUpdateTime = 0.0;
+            bool meshOptimized = false;
+            MeshOptimizer::VertexCacheStats cacheStatsBefore;
+            MeshOptimizer::VertexCacheStats cacheStats;
+            bool generateLods = false;
+            bool lodsOutdated = false;
+            bool editingNormals = false;
+            // The triangles of each level of detail, and how far each simplified level moves the surface.
+            vector<int> lodTriangles;
+            vector<float> lodErrors;
+            int currentLod = 0;
+            // If the vertex buffer holds packed vertices, and how far they are from the vertices.
+            bool packedVertices = false;
+            PackedVertex::QuantizationError quantizationError;
+            // If groups of faces may use 16 bit indices, and the size of the index buffer with and without them.
+            bool shortIndices = false;
+            size_t indexBufferSize = 0;
+            size_t fullIndexBufferSize = 0;
+            // Milliseconds from the start of the load until the object was finished.
+            double loadTime = 0.0;
             bool objectLoaded = false;
             bool showWireFrame = false;
             bool showTexture = false;
@@ -61,18 +114,35 @@ class Object
         float matAlpha = 2.0;
         MaterialInfo defMat = MaterialInfo();
 
+        // The placement of an instance relative to the model matrix, as it is edited in the gui.
+        struct InstanceTransform {
+            glm::vec3 translation = glm::vec3(0.0f);
+            // Rotation around the x, y and z axes, in degrees.
+            glm::vec3 rotation = glm::vec3(0.0f);
+            float scale = 1.0f;
+
+            glm::mat4 matrix() const;
+        };
+
         struct Face {
             int materialIndex;
             MaterialInfo mInfo;
             vector<unsigned int> indices;
+            // The smoothing group of each triangle, 0 if it has none.
+            vector<unsigned int> smoothingGroups;
+            // The indices of each simplified level of detail, after the full indices.
+            vector<vector<unsigned int>> lodIndices;
+            BoundingVolume bounds;
         };
 
         vector<Vertex> vertices;
         vector<Face> faces;
+        BoundingVolume bounds;
+        MeshBVH meshBVH;
 
-        // Vertex buffer and texture.
-        GLuint vao;
-        GLuint texture;
+        // Vertex array and texture.
+        GLVertexArray vao;
+        GLTexture texture;
 
         // Model matrix
         glm::mat4x4 matModel = {
@@ -83,21 +153,98 @@ class Object
 
         Object(string);
 
+        Object(const Object&) = delete;
+        Object& operator=(const Object&) = delete;
+        Object(Object&&) = default;
+        Object& operator=(Object&&) = default;
+
         void sendDataToBuffers();
-        void drawObject(GLuint);
-        void produceVertexNormals();
-        void produceTextureCoords(float r);
+        int drawObject(const ShaderProgram&, const vector<unsigned char> *visibleFaces = nullptr);
+        void produceVertexNormals(NormalGenerator::Weighting weighting);
+        bool updateVertexNormals();
+        void produceTextureCoords(float r, const vector<unsigned char> *hasTexCoords = nullptr);
+        void optimizeMesh(float overdrawThreshold);
+        void buildLods();
+        void clearLods();
         void updateModelMatrix(glm::vec3 tVals, float scVal, glm::vec3 rDir, float rotSpeed, bool &reset);
         void resetModel(bool&);
         float getLargestVertexLength();
+        void computeBounds();
+        void buildMeshBVH();
+        vector<unsigned int> getBaseVertexIndices() const;
+        void setBaseVertexIndices(vector<unsigned int> indices);
+
+        void addInstance();
+        void removeInstance();
+        size_t getInstanceCount() const { return instanceMatrices.size(); }
+        const vector<glm::mat4>& getInstanceMatrices() const { return instanceMatrices; }
+        const InstanceTransform& getInstanceTransform(size_t instance) const { return instanceTransforms[instance]; }
+        void setInstanceTransform(size_t instance, const InstanceTransform &transform);
+        unsigned int getTransformRevision() const { return transformRevision; }
+        unsigned int getMeshRevision() const { return meshRevision; }
+
+        size_t getLodCount() const { return oInfo.lodErrors.size() + 1; }
+        float getLodError(size_t lod) const { return lod == 0 ? 0.0f : oInfo.lodErrors[lod - 1]; }
+        size_t getLod() const { return currentLod; }
+        void setLod(size_t lod);
+        const vector<unsigned int>& getFaceIndices(size_t f, size_t lod) const;
+        size_t getTriangleCount(size_t lod) const;
+        static bool fitsShortIndices(const vector<unsigned int> &indices, unsigned int &baseVertex);
 
         vector<glm::vec3> getVertexCoords();
         vector<glm::vec3> getVertexNormals();
         vector<glm::vec2> getTextureCoords();
+        vector<unsigned int> getTriangles() const;
+        vector<unsigned int> getSmoothingGroups() const;
 
     private:
-        GLuint vBuffer;
-        GLuint iBuffer;
+        GLBuffer vBuffer;
+        GLBuffer iBuffer;
+
+        // Uniform buffer with the default material followed by the face materials.
+        GLBuffer materialBuffer;
+        MaterialInfo uploadedDefMat;
+
+        // The placement of each instance, relative to the model matrix, and the matrix it gives.
+        vector<InstanceTransform> instanceTransforms = vector<InstanceTransform>(1);
+        vector<glm::mat4> instanceMatrices = vector<glm::mat4>(1, glm::mat4(1.0f));
+        GLBuffer instanceBuffer;
+        bool instancesChanged = true;
+
+        // Objects with fewer triangles than this get no levels of detail.
+        static const size_t LOD_MIN_TRIANGLES = 4096;
+        static const size_t MAX_LODS = 4;
+
+        // The level of detail that is drawn.
+        size_t currentLod = 0;
+        // Where the indices of each level and group of faces are in the index buffer.
+        struct IndexRange {
+            size_t offset;
+            GLsizei count;
+            GLenum type;
+            GLint baseVertex;
+        };
+        vector<IndexRange> indexRanges;
+
+        // The mesh before any vertices were split for hard edges.
+        CreaseNormals creaseNormals;
+        // For an object from the mesh cache, the vertex that each vertex was split
+        // from and the settings of its normals, until the normals are made again.
+        vector<unsigned int> baseVertexIndices;
+        float baseCreaseAngle = 180.0f;
+        bool baseUseSmoothingGroups = true;
+
+        // Increased every time the model matrix or an instance matrix changes.
+        unsigned int transformRevision = 0;
+        // Increased every time the vertices or the indices of any level of detail change.
+        unsigned int meshRevision = 0;
+
+        void uploadInstances();
+        void restoreCreaseNormals();
+
+        static ShaderProgram::MaterialData toMaterialData(const MaterialInfo &mInfo);
+        void optimizeVertexFetch();
+        static void reorderTriangles(Face &face, const vector<unsigned int> &order);
 };
 
 #endif
\ No newline at end of file
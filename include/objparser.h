@@ -0,0 +1,86 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <string>
+#include <vector>
+
+#include "threadpool.h"
+#include "tiny_obj_loader.h"
+#include "loadprogress.h"
+
+using namespace std;
+
+/**
+ * This class is a multithreaded front end for parsing object files.
+ * It produces the same attributes, shapes and materials as the
+ * tinyobj::ObjReader so that the loader can build its objects in the
+ * same way regardless of which front end that was used.
+ *
+ * The file is read into memory and split into line-aligned chunks
+ * which are parsed in two passes on a thread pool:
+ *
+ *      1. Count the v/vn/vt records of each chunk. A prefix sum over
+ *         the counts gives each chunk its offset in the final arrays.
+ *      2. Parse all records of each chunk. Vertex attributes are
+ *         written directly to their final position and relative face
+ *         indices are resolved using the offsets of the chunk.
+ *
+ * The faces of all chunks are then merged in file order into shapes,
+ * where o/g/usemtl/s records are replayed like tinyobj does. Polygons
+ * are triangulated with the same method as tinyobj.
+ *
+ * If a progress is given, the bytes of each parsed chunk are added to
+ * it, and the parse stops early if it is cancelled.
+ */
+class ObjParser
+{
+    public:
+        ObjParser(ThreadPool &pool);
+
+        bool parseFile(string objFile, string mtlSearchPath, LoadProgress *progress = NULL);
+
+        const tinyobj::attrib_t& getAttrib() const { return attrib; }
+        const vector<tinyobj::shape_t>& getShapes() const { return shapes; }
+        const vector<tinyobj::material_t>& getMaterials() const { return materials; }
+        const string& getWarning() const { return warning; }
+        const string& getError() const { return error; }
+
+    private:
+        struct Corner {
+            int v, vt, vn;
+        };
+
+        // Records that change the state of the faces that follow them.
+        struct Event {
+            enum Type { OBJECT, GROUP, USEMTL, MTLLIB, SMOOTHING } type;
+            size_t faceIndex;
+            string name;
+            unsigned int value;
+        };
+
+        struct Chunk {
+            const char *begin;
+            const char *end;
+            size_t nV = 0, nVn = 0, nVt = 0;
+            size_t vOffset = 0, vnOffset = 0, vtOffset = 0;
+            vector<Corner> corners;
+            vector<unsigned int> faceSizes;
+            vector<Event> events;
+            string error;
+        };
+
+        ThreadPool &pool;
+        tinyobj::attrib_t attrib;
+        vector<tinyobj::shape_t> shapes;
+        vector<tinyobj::material_t> materials;
+        string warning;
+        string error;
+
+        void countChunk(Chunk &chunk) const;
+        void parseChunk(Chunk &chunk);
+        void mergeChunks(vector<Chunk> &chunks, string mtlSearchPath);
+        void addFace(tinyobj::shape_t &shape, const Corner *corners, size_t nCorners, int materialId, unsigned int smoothingId);
+        size_t clipEars(vector<tinyobj::index_t> polygon, vector<tinyobj::index_t> &indices) const;
+};
+
+#endif
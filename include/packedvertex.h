@@ -0,0 +1,55 @@
+#ifndef PACKEDVERTEX_H
+#define PACKEDVERTEX_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "vertex.h"
+
+using namespace std;
+
+/**
+ * This class is a compressed copy of a vertex that is only used in the
+ * vertex buffers of the GPU. It is 16 bytes instead of the 32 bytes of
+ * a vertex:
+ *
+ *      - Position:  Three 16 bit normalized integers and 16 bits of
+ *                   padding. The loader scales every object so that
+ *                   no vertex is further than 1 from the origin, so
+ *                   the position fits the [-1, 1] range of the integers.
+ *      - Normal:    Two 16 bit normalized integers with the normal
+ *                   folded onto an octahedron, unfolded by the shader.
+ *      - Texture:   Two half floats.
+ *
+ * The vertices on the CPU are not changed, so picking and normal
+ * generation still use full precision. How far the packed vertices
+ * are from the real vertices is measured when they are packed.
+ */
+class PackedVertex
+{
+    public:
+        int16_t position[4];
+        int16_t normal[2];
+        uint16_t texCoords[2];
+
+        // The largest and root mean square errors of a packed mesh.
+        struct QuantizationError {
+            float maxPosition = 0.0f;
+            float rmsPosition = 0.0f;
+            float maxNormalDegrees = 0.0f;
+            float maxTexCoord = 0.0f;
+        };
+
+        static vector<PackedVertex> pack(const vector<Vertex> &vertices, QuantizationError *error = NULL);
+        static void setAttributes(bool packed);
+
+    private:
+        static int16_t toSnorm16(float value);
+        static float fromSnorm16(int16_t value);
+        static uint16_t toHalf(float value);
+        static float fromHalf(uint16_t value);
+        static void encodeNormal(const glm::vec3 &normal, int16_t encoded[2]);
+        static glm::vec3 decodeNormal(const int16_t encoded[2]);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * This class writes 8 bit images as PNG files, without any library.
+ * Each row gets the PNG filter that makes it smallest, and the rows
+ * are compressed with deflate using its fixed Huffman codes and a
+ * simple hash of the last three bytes to find repeated runs. That is
+ * far from the best compression, but rendered images with large flat
+ * areas still become a small part of their raw size.
+ */
+class PngWriter
+{
+    public:
+        static bool write(const string &fileName, int width, int height, int nChannels,
+                          const unsigned char *pixels, bool bottomUp = false);
+        static vector<unsigned char> encode(int width, int height, int nChannels,
+                                            const unsigned char *pixels, bool bottomUp = false);
+
+    private:
+        static void filterRows(int width, int height, int nChannels, const unsigned char *pixels,
+                               bool bottomUp, vector<unsigned char> &filtered);
+        static vector<unsigned char> deflate(const vector<unsigned char> &data);
+        static uint32_t crc32(const unsigned char *data, size_t size, uint32_t crc = 0);
+        static uint32_t adler32(const vector<unsigned char> &data);
+        static void addChunk(vector<unsigned char> &png, const char *type, const vector<unsigned char> &data);
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glresource.h"
+
+using namespace std;
+
+/**
+ * This class measures where the time of each frame goes. The frame is
+ * split into named scopes that can be nested, and each scope is timed
+ * on the CPU in nanoseconds. Render passes are also timed on the GPU
+ * with GL_TIME_ELAPSED queries, which are read a few frames later so
+ * the CPU never waits for the GPU.
+ *
+ * The last MAX_FRAMES frames are kept in a ring buffer, and can be
+ * shown in the profiler window or written as a Chrome trace, which
+ * opens in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Scopes are only recorded on the thread that runs the frame, scopes
+ * on other threads are ignored. The timing is added to the code with
+ * the macros at the end of this file, which compile to nothing if
+ * NO_PROFILER is defined.
+ */
+class Profiler
+{
+    public:
+        // A timed scope, in nanoseconds from the start of its frame.
+        struct Scope {
+            const char *name;
+            int64_t start;
+            int64_t end;
+            int depth;
+        };
+
+        // A pass timed on the GPU. The time is negative until the query is read.
+        struct GpuPass {
+            const char *name;
+            int64_t cpuStart;
+            int64_t time;
+            size_t query;
+        };
+
+        struct Frame {
+            uint64_t number = 0;
+            // Nanoseconds from the creation of the profiler.
+            int64_t start = 0;
+            int64_t duration = 0;
+            vector<Scope> scopes;
+            vector<GpuPass> gpuPasses;
+        };
+
+        static const size_t MAX_FRAMES = 300;
+        static const size_t NO_SCOPE = static_cast<size_t>(-1);
+        static const size_t NO_QUERY = static_cast<size_t>(-1);
+
+        Profiler();
+
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        void beginFrame();
+        void endFrame();
+        size_t beginScope(const char *name);
+        void endScope(size_t scope);
+        bool beginGpuPass(const char *name);
+        void endGpuPass();
+        void releaseQueries();
+
+        size_t frameCount() const;
+        const Frame& frame(size_t age) const;
+        bool writeChromeTrace(const string &fileName) const;
+
+        // While paused no frames are recorded, so the kept frames can be looked at.
+        bool paused = false;
+
+        static Profiler& shared();
+
+    private:
+        chrono::steady_clock::time_point epoch;
+        thread::id frameThread;
+        vector<Frame> frames;
+        uint64_t nFrames = 0;
+        bool inFrame = false;
+        int depth = 0;
+
+        // The queries are reused once their results have been read.
+        vector<GLQuery> queries;
+        vector<size_t> freeQueries;
+        bool gpuPassActive = false;
+
+        int64_t now() const;
+        bool recording() const;
+        void readQueries();
+};
+
+/**
+ * Times the code from its construction to the end of its block.
+ */
+class ProfileScope
+{
+    public:
+        ProfileScope(const char *name) : scope(Profiler::shared().beginScope(name)) {}
+        ~ProfileScope() { Profiler::shared().endScope(scope); }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        size_t scope;
+};
+
+/**
+ * Times the GPU commands from its construction to the end of its block.
+ * Only one GPU pass can be timed at a time, a pass inside another one
+ * is ignored.
+ */
+class GpuProfileScope
+{
+    public:
+        GpuProfileScope(const char *name) : started(Profiler::shared().beginGpuPass(name)) {}
+        ~GpuProfileScope() { if(started) Profiler::shared().endGpuPass(); }
+
+        GpuProfileScope(const GpuProfileScope&) = delete;
+        GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+    private:
+        bool started;
+};
+
+/**
+ * Records a frame from its construction to the end of its block.
+ */
+class ProfileFrame
+{
+    public:
+        ProfileFrame() { Profiler::shared().beginFrame(); }
+        ~ProfileFrame() { Profiler::shared().endFrame(); }
+
+        ProfileFrame(const ProfileFrame&) = delete;
+        ProfileFrame& operator=(const ProfileFrame&) = delete;
+};
+
+#define PROFILE_JOIN_NAME(a, b) a##b
+#define PROFILE_NAME(a, b) PROFILE_JOIN_NAME(a, b)
+
+#ifdef NO_PROFILER
+#define PROFILE_FRAME()
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_PASS(name)
+#else
+#define PROFILE_FRAME() ProfileFrame PROFILE_NAME(profileFrame, __LINE__)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_NAME(profileScope, __LINE__)(name)
+#define PROFILE_GPU_PASS(name) GpuProfileScope PROFILE_NAME(gpuProfileScope, __LINE__)(name)
+#endif
+
+#endif
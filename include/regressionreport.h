@@ -0,0 +1,71 @@
+#ifndef REGRESSIONREPORT_H
+#define REGRESSIONREPORT_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * This class checks headless renders for regressions. The rendered
+ * images are compared to stored golden images, and the load time,
+ * frame time and peak memory of each model are compared to the
+ * earlier runs in a CSV history file, which the new run is added to.
+ *
+ * Images are compared perceptually: both are blurred slightly and
+ * turned into luma and chroma, so a GPU that rasterizes edges a pixel
+ * differently does not count as a change, while a wrong color or a
+ * missing part does. An image fails if too many pixels differ.
+ *
+ * A time or a memory use is a regression if it is more than a given
+ * fraction above the median of the last HISTORY_RUNS runs of the same
+ * model, and also more than a small absolute amount, so that timer
+ * noise on tiny models is not flagged.
+ */
+class RegressionReport
+{
+    public:
+        // What was measured for one model in one run.
+        struct Record {
+            string model;
+            double loadTime = 0.0;
+            double cpuFrameTime = 0.0;
+            double gpuFrameTime = 0.0;
+            double peakRss = 0.0;
+            // The largest fraction of differing pixels of the views, negative if not compared.
+            double imageDifference = -1.0;
+        };
+
+        struct ImageDifference {
+            bool compared = false;
+            // The fraction of pixels that differ visibly.
+            double differingFraction = 1.0;
+            // The largest difference of a pixel, from 0 to 1.
+            double maxDifference = 1.0;
+        };
+
+        // How many earlier runs of a model the measurements are compared to.
+        static const size_t HISTORY_RUNS = 5;
+
+        static ImageDifference compareImages(const string &imageFile, const string &goldenFile);
+        static void resetPeakRss();
+        static double peakRss();
+
+        void add(const Record &record) { records.push_back(record); }
+        void addProblem(const string &problem) { problems.push_back(problem); }
+        size_t checkHistory(const string &historyFile, double maxSlowdown);
+        bool appendHistory(const string &historyFile) const;
+
+        const vector<Record>& getRecords() const { return records; }
+        const vector<string>& getProblems() const { return problems; }
+
+    private:
+        vector<Record> records;
+        vector<string> problems;
+
+        static vector<Record> readHistory(const string &historyFile);
+        void checkValue(const string &model, const char *name, const char *unit, double value,
+                        vector<double> previous, double maxSlowdown, double noiseFloor);
+};
+
+#endif
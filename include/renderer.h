@@ -2,7 +2,10 @@
 
 #include "studio3d.h"
 #include "loader.h"
-#include "stb_image.h"
+#include "shaderprogram.h"
+#include "scenebatch.h"
+#include "frustum.h"
+#include "framecapture.h"
 #include <glm/gtx/string_cast.hpp>
 
 /**
@@ -19,6 +22,26 @@
 class Renderer : public Studio3D
 {
     public:
+        // What a headless run writes and checks.
+        struct HeadlessInfo {
+            string outputDir = ".";
+            // The least number of models rendered each second, 0 for no target.
+            double targetModelsPerSecond = 1.0;
+            // How many objects are loaded at the same time, 0 for one per core.
+            size_t maxLoads = 0;
+            bool useMeshCache = true;
+            // The directory with the golden images, not compared if empty.
+            string goldenDir;
+            // If an image without a golden image is only reported, and not a problem.
+            bool allowMissingGolden = false;
+            // The largest fraction of the pixels of an image that may differ.
+            double imageTolerance = 0.01;
+            // The CSV file with the earlier runs, not used if empty.
+            string historyFile;
+            // How much slower or larger than the earlier runs a model may be.
+            double maxSlowdown = 0.2;
+        };
+
         template<typename... ARGS>
         Renderer(ARGS&&... args) : Studio3D{ std::forward<ARGS>(args)... }
         {}
@@ -29,15 +52,50 @@ class Renderer : public Studio3D
         void updateCamera() override;
         void updateLight() override;
         string loadObjectFromGui(string, string) override;
+        string finishLoads() override;
         string loadTextureFromGui(string, string, int) override;
+        int renderToFiles(const vector<string> &objFiles, const HeadlessInfo &hInfo);
+        int checkResources(const vector<string> &files);
+        int benchmarkGui(const vector<string> &objFiles, int nFrames);
+        int benchmarkInstances(const string &objFile, int nFrames);
+        int measureIdle(const vector<string> &objFiles, double duration);
 
     private:
-        GLuint program;
-        Loader loader;
-        bool objectParseSuccess;
+        ShaderProgram program;
+        ShaderProgram multiDrawProgram;
+        // The same programs for vertex buffers with packed vertices.
+        ShaderProgram packedProgram;
+        ShaderProgram packedMultiDrawProgram;
+        // The formats that the buffers of the objects are uploaded with.
+        bool packedVertices = false;
+        bool shortIndices = false;
+        SceneBatch sceneBatch;
+        ShaderProgram::FrameData frameData;
+        GLBuffer frameBuffer;
+
+        // A bounding volume to test against the frustum, placed in the world by M.
+        struct CullEntry {
+            size_t objectIndex;
+            size_t faceIndex;
+            glm::mat4 M;
+        };
+
+        Frustum frustum;
+        SphereSet cullSpheres;
+        vector<CullEntry> cullEntries;
+        vector<size_t> visibleItems;
+        vector<unsigned char> sphereVisible;
+        vector<unsigned char> visibleObjects;
+        vector<vector<unsigned char>> visibleFaces;
+        // Everything the loads have written, shown in the log.
+        string loadOutput;
 
         void debugShader(void) const;
-        void loadGeometry(string, string);
+        void cullScene();
+        void selectLods();
+        void updateBufferFormat();
         void resetTransformations(int);
-        string loadTexture(string, string, GLuint&, int);
+        bool loadAndWait(const string &file);
+        string finishObjectLoad();
+        string finishTextureLoad();
 };
@@ -0,0 +1,123 @@
+#ifndef SCENEBATCH_H
+#define SCENEBATCH_H
+
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include <vector>
+
+#include "object.h"
+#include "glresource.h"
+
+using namespace std;
+
+/**
+ * This class packs the geometry of all loaded objects into a single
+ * vertex buffer and a single index buffer, so that the whole scene
+ * can be drawn with one glMultiDrawElementsIndirect call.
+ *
+ * Every material group (Object::Face) of every object becomes one
+ * indirect draw command. The base instance of a command is the index
+ * of the draw, which is passed to the shader through an instanced
+ * vertex attribute. The shader uses it to look up the model matrix
+ * and material of the draw in a shader storage buffer.
+ *
+ * Every object has its own range of the shared buffers, with some room
+ * to grow. When the mesh of an object changes, for example when its
+ * crease angle is edited, only its range is written again. The buffers
+ * are only built again when objects are added or removed, or when an
+ * object has outgrown its range. The draw data is uploaded every frame
+ * since the model matrices and
+ * materials can be changed at any time. Objects that show a texture
+ * or are drawn as a wireframe can not share the draw call, and neither
+ * can objects with several instances. Their commands are disabled and
+ * they are drawn on their own instead. The commands of material groups
+ * that are outside the view are disabled the same way.
+ *
+ * The indices of every level of detail of an object are in the index
+ * buffer, and each frame the command of a material group is pointed at
+ * the range of the level that its object is drawn with. Each range is
+ * counted from its own first vertex, so that the whole index buffer can
+ * be 16 bit when no range spans more than 65535 vertices.
+ */
+class SceneBatch
+{
+    public:
+        // The binding point of the draw data storage buffer.
+        static const GLuint DRAW_DATA_BINDING = 2;
+
+        // The layout of a single draw in the draw data buffer (std430).
+        struct DrawData {
+            glm::mat4 M;
+            glm::vec4 ka;
+            glm::vec4 kd;
+            glm::vec4 ks;
+            glm::vec4 params;
+        };
+
+        void rebuild(const vector<Object> &objects, unsigned int sceneRevision, bool packedVertices, bool shortIndices);
+        void update(const vector<Object> &objects);
+        int draw(const vector<Object> &objects, const vector<vector<unsigned char>> &visibleFaces);
+
+        bool isBuiltFor(unsigned int sceneRevision, bool packedVertices, bool shortIndices) const
+        {
+            return built && revision == sceneRevision && packed == packedVertices && shortIndicesAllowed == shortIndices;
+        }
+        static bool canBatch(const Object &object);
+
+    private:
+        // The layout that glMultiDrawElementsIndirect reads.
+        struct DrawCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        };
+
+        // Which material group of which object a draw belongs to.
+        struct DrawSource {
+            size_t objectIndex;
+            size_t faceIndex;
+        };
+
+        struct IndexRange {
+            GLuint firstIndex;
+            GLuint count;
+            GLint baseVertex;
+        };
+
+        // Where the vertices and indices of an object are in the shared
+        // buffers, and the index range of each material group at each
+        // level of detail, in the order f*nLods + lod.
+        struct ObjectSlot {
+            GLuint firstVertex;
+            GLuint vertexCapacity;
+            GLuint firstIndex;
+            GLuint indexCapacity;
+            size_t nLods;
+            vector<IndexRange> ranges;
+            unsigned int meshRevision;
+        };
+
+        GLVertexArray vao;
+        GLBuffer vertexBuffer;
+        GLBuffer indexBuffer;
+        GLBuffer drawIdBuffer;
+        GLBuffer commandBuffer;
+        GLBuffer drawDataBuffer;
+
+        vector<DrawSource> sources;
+        vector<ObjectSlot> slots;
+        vector<DrawCommand> commands;
+        vector<DrawData> drawData;
+        unsigned int revision = 0;
+        bool packed = false;
+        bool shortIndicesAllowed = false;
+        GLenum indexType = GL_UNSIGNED_INT;
+        bool built = false;
+
+        void writeObject(const Object &object, ObjectSlot &slot);
+        static bool fitsShortIndices(const Object &object);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SCENEBVH_H
+#define SCENEBVH_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+#include "object.h"
+#include "frustum.h"
+
+using namespace std;
+
+/**
+ * This class is a bounding volume hierarchy over the world space
+ * bounding boxes of all object instances in the scene. It answers
+ * frustum and ray queries without looking at every object.
+ *
+ * The tree is built top down with the surface area heuristic, where
+ * the centroids of the boxes are sorted into a few bins along each
+ * axis and the cheapest split between two bins is used. The nodes are
+ * stored in a flat array where the two children of a node are next to
+ * each other and always come after their parent.
+ *
+ * When objects are only moved the tree is refitted instead of rebuilt,
+ * which keeps the structure of the tree and only recomputes the boxes
+ * bottom up. The tree is rebuilt when objects or instances are added
+ * or removed.
+ */
+class SceneBVH
+{
+    public:
+        // A single instance of an object, with its box in world space.
+        struct Item {
+            size_t objectIndex;
+            size_t instanceIndex;
+            glm::mat4 M;
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        // An item that a ray hits, at the distance t along the ray.
+        struct RayHit {
+            size_t item;
+            float t;
+        };
+
+        void update(const vector<Object> &objects);
+        void build(const vector<Object> &objects);
+        void refit(const vector<Object> &objects);
+
+        void queryFrustum(const Frustum &frustum, vector<size_t> &result) const;
+        void queryRay(const glm::vec3 &origin, const glm::vec3 &direction, vector<RayHit> &result) const;
+
+        const Item& item(size_t index) const { return items[index]; }
+        size_t itemCount() const { return items.size(); }
+        size_t nodeCount() const { return nodes.size(); }
+
+        static string benchmark(size_t nItems);
+
+    private:
+        static const int SAH_BINS = 12;
+        static const unsigned int MAX_LEAF_SIZE = 2;
+        // Keeps the traversal stacks small, deeper nodes become leaves.
+        static const unsigned int MAX_DEPTH = 60;
+
+        // Either an inner node with two children at first and first + 1,
+        // or a leaf with count items starting at first in itemOrder.
+        struct Node {
+            glm::vec3 min;
+            unsigned int first;
+            glm::vec3 max;
+            unsigned int count;
+        };
+
+        vector<Node> nodes;
+        vector<Item> items;
+        vector<unsigned int> itemOrder;
+        vector<unsigned int> transformRevisions;
+
+        void collectItems(const vector<Object> &objects);
+        void buildNodes();
+        void refitNodes();
+        void updateNodeBounds(Node &node) const;
+        bool findSplit(const Node &node, int &axis, float &position) const;
+        void addSubtree(unsigned int nodeIndex, vector<size_t> &result) const;
+
+        static float surfaceArea(const glm::vec3 &min, const glm::vec3 &max);
+};
+
+#endif
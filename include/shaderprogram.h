@@ -0,0 +1,71 @@
+#ifndef SHADERPROGRAM_H
+#define SHADERPROGRAM_H
+
+#include <glm/glm.hpp>
+#include "gltypes.h"
+#include <string>
+
+using namespace std;
+
+/**
+ * This class represents a linked shader program. All uniform
+ * locations that the program uses are looked up once when the
+ * class is created, so that no string lookups has to be done
+ * while rendering. The uniform blocks of the program are also
+ * bound to fixed binding points here.
+ *
+ * The program uses two uniform blocks, both with std140 layout:
+ *
+ *      - FrameData: The camera and light values which are the same
+ *                   for all objects. Updated once per frame.
+ *      - Materials: The material coefficients of a single object,
+ *                   indexed by the matIndex uniform.
+ */
+class ShaderProgram
+{
+    public:
+        enum Uniform {
+            MODEL,
+            SHOW_TEXTURE,
+            ALPHA,
+            MATERIAL_INDEX,
+            TEXTURE,
+            N_UNIFORMS
+        };
+
+        enum BlockBinding {
+            FRAME_DATA_BINDING = 0,
+            MATERIALS_BINDING = 1
+        };
+
+        // Must match the size of the materials array in the fragment shader.
+        static const int MAX_MATERIALS = 256;
+
+        // The layout of the FrameData uniform block.
+        struct FrameData {
+            glm::mat4 V = glm::mat4(1.0f);
+            glm::mat4 P = glm::mat4(1.0f);
+            glm::vec4 camPos = glm::vec4(0.0f);
+            glm::vec4 la = glm::vec4(0.0f);
+            glm::vec4 lsPos = glm::vec4(0.0f);
+            glm::vec4 lsColor = glm::vec4(0.0f);
+        };
+
+        // The layout of a single element in the Materials uniform block.
+        struct MaterialData {
+            glm::vec4 ka;
+            glm::vec4 kd;
+            glm::vec4 ks;
+        };
+
+        ShaderProgram(GLuint program = 0);
+
+        GLuint id() const { return program; }
+        GLint location(Uniform uniform) const { return locations[uniform]; }
+
+    private:
+        GLuint program;
+        GLint locations[N_UNIFORMS];
+};
+
+#endif
@@ -14,6 +14,9 @@
 
 #include "logger.h"
 #include "worldcontext.h"
+#include "asyncloader.h"
+#include "textureloader.h"
+#include "profiler.h"
 
 /**
  * This is the main class of the whole program. This class
@@ -43,23 +46,35 @@ class Studio3D
             bool showObjMatWindow = false;
             bool showSettingsWindow = false;
             bool showSceneWindow = false;
+            bool showProfilerWindow = false;
         } wInfo;
 
-        Studio3D(string title, int width, int height);
+        // What the overlay shows about how much the studio does.
+        struct FrameStats {
+            // Running average of the time it takes to build the gui, in ms.
+            double guiTime = 0.0;
+            // Cpu time of the whole program over the last second, in percent of one core.
+            double cpuUsage = 0.0;
+            double framesPerSecond = 0.0;
+        };
+
+        Studio3D(string title, int width, int height, bool headless = false);
         ~Studio3D();
 
         GLFWwindow* window() const;
-        void start();
+        void start(double duration = 0.0);
 
         virtual void errorCallback(int error, const char* desc);
         virtual void resizeCallback(GLFWwindow* window, int width, int height);
         virtual void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+        virtual void inputCallback(GLFWwindow* window);
         virtual void initialize() = 0;
         virtual void display() = 0;
         virtual void updateObject(int) = 0;
         virtual void updateCamera() = 0;
         virtual void updateLight() = 0;
         virtual string loadObjectFromGui(string, string) = 0;
+        virtual string finishLoads() = 0;
         virtual string loadTextureFromGui(string, string, int) = 0;
 
     protected:
@@ -69,10 +84,13 @@ class Studio3D
         float getAspectRatio();
 
         string readShaderSource(const string shaderFile) const;
-        GLuint initProgram(const string vShaderFile, const string fShaderFile) const;
+        GLuint initProgram(const string vShaderFile, const string fShaderFile, const string defines = "") const;
 
         void reshape(const int width, const int height) const;
+        double drawFrame();
         WorldContext wContext = WorldContext();
+        AsyncLoader objectLoads;
+        TextureLoader textureLoads;
 
     private:
         int windowWidth = 0;
@@ -84,8 +102,20 @@ class Studio3D
         string texPath;  
 
         GLFWwindow* glfwWindow;
+        // A headless studio has a hidden window and no gui, it only renders to files.
+        bool headless = false;
         Logger log = Logger();
-        
+
+        FrameStats stats;
+        // How many more frames the gui is drawn after the last input.
+        int guiFramesLeft = GUI_SETTLE_FRAMES;
+        // Imgui needs a few frames after an input to settle hovering and window sizes.
+        static const int GUI_SETTLE_FRAMES = 3;
+        // How long the loop sleeps at most while nothing changes, in seconds.
+        static constexpr double IDLE_WAIT_TIME = 1.0;
+
+        bool needsRedraw() const;
+
         void DrawGui();
         void handleMouseInput(); 
         void openObjectFile();
@@ -28,13 +28,14 @@ namespace StudioGui {
     void sceneWindow(bool&, WorldContext&);
     void aboutPopupModal(bool&);
     void objMatWindow(bool&, Object&);
-    void objInfWindow(bool&, std::string, Object::ObjectInfo&);
-    void camWindow(bool&, WorldContext::CameraInfo&, glm::vec3, glm::vec3);
+    void objInfWindow(bool&, const std::string&, Object::ObjectInfo&);
+    bool camWindow(bool&, WorldContext::CameraInfo&, glm::vec3, glm::vec3);
     void keyRefWindow(bool&);
-    void showStudioOverlay(bool&, WorldContext);
-    void showLightSourcesWindow(bool&, WorldContext&);
+    void showStudioOverlay(bool&, const WorldContext&, AsyncLoader&, const TextureLoader&, const Studio3D::FrameStats&);
+    bool showLightSourcesWindow(bool&, WorldContext&);
     void logWindow(bool&, Logger&);
     void settingsWindow(bool&, WorldContext&);
+    void profilerWindow(bool&, Profiler&);
 
 }
 
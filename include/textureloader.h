@@ -0,0 +1,99 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <GL/glew.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glresource.h"
+
+using namespace std;
+
+/**
+ * This class loads textures in the background. The image files are
+ * decoded by the shared thread pool, and the decoded pixels are then
+ * sent to the GPU by the main thread a few rows at a time. The rows
+ * are copied into a pixel buffer object and the texture is filled from
+ * that buffer, so the driver can copy them to the GPU without stalling
+ * the frame. At most a given number of bytes is uploaded each frame.
+ *
+ * The texture format follows the number of channels in the image:
+ *
+ *      - 1 channel:  Grey, shown as grey with full opacity.
+ *      - 2 channels: Grey and alpha.
+ *      - 3 channels: Red, green and blue.
+ *      - 4 channels: Red, green, blue and alpha.
+ *
+ * A texture is only handed out once all of it has been uploaded and
+ * its mipmaps are built, so a half uploaded texture is never drawn.
+ */
+class TextureLoader
+{
+    public:
+        // What the gui shows about a load.
+        struct Status {
+            string fileName;
+            bool decoded;
+            size_t bytesUploaded;
+            size_t totalBytes;
+        };
+
+        // A load that has finished, successfully or not.
+        struct Result {
+            string fileName;
+            int objectIndex;
+            string objectName;
+            bool success;
+            string output;
+            GLTexture texture;
+        };
+
+        TextureLoader() {}
+
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+
+        void start(const string &fileName, const string &filePath, int objectIndex, const string &objectName);
+        void upload(size_t byteBudget);
+        bool takeFinished(Result &result);
+
+        vector<Status> getStatus() const;
+        bool empty() const { return jobs.empty(); }
+
+    private:
+        struct Job {
+            string fileName;
+            string filePath;
+            int objectIndex;
+            string objectName;
+            // Written by the decoding thread before decoded is set.
+            unsigned char *pixels = NULL;
+            int width = 0;
+            int height = 0;
+            int nChannels = 0;
+            string error;
+            atomic<bool> decoded;
+            // Only used by the main thread.
+            GLTexture texture;
+            GLBuffer pixelBuffer;
+            int rowsUploaded = 0;
+            bool finished = false;
+
+            Job() : decoded(false) {}
+            ~Job();
+            size_t rowBytes() const { return static_cast<size_t>(width)*nChannels; }
+            size_t totalBytes() const { return rowBytes()*height; }
+        };
+
+        // Shared with the decoding tasks, so a job outlives the loader if it is still being decoded.
+        vector<shared_ptr<Job>> jobs;
+
+        static void decode(Job &job);
+        static void beginUpload(Job &job);
+        static size_t uploadRows(Job &job, size_t byteBudget);
+        static void endUpload(Job &job);
+};
+
+#endif
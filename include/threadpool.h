@@ -0,0 +1,48 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+/**
+ * This class represents a fixed size pool of worker threads. Tasks
+ * are put in a queue and picked up by the first idle worker. The
+ * pool is used for the work in the program that can be split into
+ * independent parts, such as parsing large object files.
+ *
+ * A single pool that is shared by the whole program can be reached
+ * through the shared() function, which avoids creating new threads
+ * every time some work should run in parallel.
+ */
+class ThreadPool
+{
+    public:
+        ThreadPool(size_t nThreads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t size() const { return workers.size(); }
+        void enqueue(function<void()> task);
+        void parallelFor(size_t nTasks, const function<void(size_t)> &task);
+
+        static ThreadPool& shared();
+
+    private:
+        vector<thread> workers;
+        queue<function<void()>> tasks;
+        mutex queueMutex;
+        condition_variable queueCondition;
+        bool stopping = false;
+
+        void workerLoop();
+};
+
+#endif
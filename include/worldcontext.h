@@ -10,6 +10,7 @@
 
 #include "loader.h"
 #include "lightsource.h"
+#include "scenebvh.h"
 
 /**
  * The world context class is to represent all the information
@@ -57,7 +58,67 @@ class WorldContext
             bool perspProj = true;
         } cInfo;
 
+        Loader::LoaderInfo lInfo;
+
+        struct RenderInfo {
+            bool useMultiDraw = true;
+            bool multiDrawSupported = true;
+            bool useFrustumCulling = true;
+            bool useSceneBVH = true;
+            bool runBVHBenchmark = false;
+            double cullTime = 0.0;
+            double pickTime = 0.0;
+            int nDrawCalls = 0;
+            int nObjectsDrawn = 0;
+            int nObjectsCulled = 0;
+            int nGroupsDrawn = 0;
+            int nGroupsCulled = 0;
+            bool usePackedVertices = true;
+            bool useShortIndices = true;
+            bool useLods = true;
+            float lodPixelError = 1.0f;
+            long long nTrianglesDrawn = 0;
+            // How many MB of texture pixels that are sent to the GPU each frame.
+            float textureUploadBudget = 2.0f;
+            // If the scene is only drawn again when something has changed.
+            bool renderOnDemand = true;
+        } rInfo;
+
+        // What has changed since the scene was last drawn. Everything
+        // starts out changed, so that the first frame is drawn.
+        struct DirtyFlags {
+            bool camera = true;
+            bool light = true;
+            bool objects = true;
+
+            bool any() const { return camera || light || objects; }
+            void clear() { camera = light = objects = false; }
+        } dirty;
+
+        // A lightweight copy of what the gui shows about the loaded objects.
+        struct SceneSummary {
+            struct Entry {
+                string fileName;
+                string selectLabel;
+                string addInstanceLabel;
+                string removeInstanceLabel;
+                int nInstances = 1;
+                int nVertices = 0;
+                int nIndices = 0;
+            };
+            vector<Entry> entries;
+            int selectedObject = 0;
+            // The instance of the selected object that is edited, and its placement.
+            int selectedInstance = 0;
+            Object::InstanceTransform instanceTransform;
+            long long totalVertices = 0;
+            long long totalIndices = 0;
+            unsigned int revision = 0;
+            unsigned int geometryRevision = 0;
+        };
+
         int selectedObject = 0;
+        int selectedInstance = 0;
         float ROT_SPEED = 5.0f;
         float TRA_SPEED = 0.1f;
         float SCA_SPEED = 0.1f;
@@ -78,12 +139,31 @@ class WorldContext
         glm::mat4x4 matProj = glm::perspective(glm::radians(cInfo.fov), getAspectRatio(), cInfo.nearPlane, cInfo.farPlane);
 
         void updateMatrices();
+        bool isMoving() const;
+        void addObject(Object &&object);
+        void selectObject(int objIndex);
+        int pickObject(const glm::vec3 &origin, const glm::vec3 &direction) const;
+        bool selectObjectAt(float ndcX, float ndcY);
+        void addInstance(int objIndex);
+        void removeInstance(int objIndex);
+        void selectInstance(int instance);
+        void setInstanceTransform(const Object::InstanceTransform &transform);
+        bool updateVertexNormals(int objIndex);
         void clearObjects();
+        const SceneSummary& getSceneSummary() const { return sceneSummary; }
+        const SceneBVH& getSceneBVH() const { return sceneBVH; }
 
     private:
 
+        SceneSummary sceneSummary;
+        SceneBVH sceneBVH;
+
+        void updateSceneSummary();
+
         glm::mat4x4 obliqueProjection(glm::mat4x4, float, float);
 
+        bool isTransforming() const;
+        bool isCameraMoving() const;
         void updateViewMatrix();
         void updateProjMatrix();
         float getAspectRatio();
@@ -0,0 +1,89 @@
+#include "asyncloader.h"
+
+/**
+ * This class loads object files in the background, so that the program
+ * keeps rendering while a large file is parsed.
+ */
+
+/**
+ * Cancels all loads that are still running and waits for their threads.
+ */
+AsyncLoader::~AsyncLoader()
+{
+    for(unique_ptr<Job> &job : jobs) job->progress.cancelled = true;
+    for(unique_ptr<Job> &job : jobs) {
+        if(job->worker.joinable()) job->worker.join();
+    }
+}
+
+/**
+ * Function for starting to load an object file on a new thread. The
+ * loader settings are copied, so they can be changed during the load.
+ *
+ * @param fileName: The name of the object file.
+ * @param filePath: The directory of the object file, ending with a slash.
+ * @param lInfo: The loader settings.
+ */
+void AsyncLoader::start(const string &fileName, const string &filePath, const Loader::LoaderInfo &lInfo)
+{
+    jobs.push_back(unique_ptr<Job>(new Job(fileName)));
+    Job *job = jobs.back().get();
+    job->worker = thread([job, fileName, filePath, lInfo]() {
+        Loader loader;
+        job->object = loader.parseFile(job->success, fileName, filePath, lInfo, &job->progress);
+        job->output = loader.getOutputString();
+        job->finished = true;
+    });
+}
+
+/**
+ * Function for asking a load to stop. The loader stops at the next
+ * chunk or stage, and the load is then taken as a failed load.
+ *
+ * @param job: The index of the load, in the order of getStatus.
+ */
+void AsyncLoader::cancel(size_t job)
+{
+    if(job < jobs.size()) jobs[job]->progress.cancelled = true;
+}
+
+/**
+ * Function for taking the oldest load that has finished. Only one load is
+ * taken per call, so that the main thread can spread the uploads of many
+ * objects over several frames.
+ *
+ * @param object: Set to the loaded object.
+ * @param success: Set to true if the object was loaded, false if it failed or was cancelled.
+ * @param output: Set to the output of the loader.
+ *
+ * @return True if a load was taken.
+ */
+bool AsyncLoader::takeFinished(Object &object, bool &success, string &output)
+{
+    for(size_t j = 0; j < jobs.size(); j++) {
+        Job &job = *jobs[j];
+        if(!job.finished) continue;
+        job.worker.join();
+        object = move(job.object);
+        success = job.success && !job.progress.cancelled;
+        output = job.output;
+        jobs.erase(jobs.begin() + j);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Function for getting the progress of all loads that have not been taken.
+ *
+ * @return The status of each load, oldest first.
+ */
+vector<AsyncLoader::Status> AsyncLoader::getStatus() const
+{
+    vector<Status> status;
+    for(const unique_ptr<Job> &job : jobs) {
+        Status s = { job->fileName, job->progress.stage, job->progress.bytesParsed, job->progress.totalBytes, job->progress.cancelled };
+        status.push_back(s);
+    }
+    return status;
+}
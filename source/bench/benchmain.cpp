@@ -0,0 +1,40 @@
+#include "meshbenchmark.h"
+#include "scenebvh.h"
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * The main function of the mesh benchmark. It measures the loading of
+ * the given object files and of synthetic spheres on the CPU, and the
+ * culling and picking queries of the scene BVH on scenes of 1k objects
+ * and up. It is built without OpenGL, GLFW and ImGui, so no display or
+ * driver is needed:
+ *
+ *      3d_studio_bench.exe [options] file.obj...
+ *
+ *      --time s            Least time to run each benchmark.
+ *      --max-triangles n   Largest sphere, from 1k up in steps of 10x.
+ *      --max-objects n     Largest scene, from 1k up in steps of 10x.
+ */
+int main(int argc, char **argv)
+{
+    double minTime = 0.5;
+    size_t maxTriangles = 10000000;
+    size_t maxObjects = 100000;
+    vector<string> objFiles;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--time" && hasValue) minTime = atof(argv[++i]);
+        else if (arg == "--max-triangles" && hasValue) maxTriangles = atol(argv[++i]);
+        else if (arg == "--max-objects" && hasValue) maxObjects = atol(argv[++i]);
+        else objFiles.push_back(arg);
+    }
+
+    MeshBenchmark benchmark(minTime);
+    for (const string &objFile : objFiles) benchmark.runFile(objFile);
+    for (size_t nTriangles = 1000; nTriangles <= maxTriangles; nTriangles *= 10) benchmark.runSynthetic(nTriangles);
+    cout << benchmark.report();
+    for (size_t nObjects = 1000; nObjects <= maxObjects; nObjects *= 10) cout << SceneBVH::benchmark(nObjects);
+    return 0;
+}
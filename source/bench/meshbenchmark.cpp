@@ -0,0 +1,281 @@
+#include "meshbenchmark.h"
+#include "loader.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+/**
+ * This class measures the parts of loading an object that run on the CPU.
+ */
+
+// Only set while a benchmark runs, so the rest of the program allocates as before.
+static atomic<bool> countingAllocations(false);
+static atomic<size_t> nAllocations(0);
+static atomic<size_t> nBytesAllocated(0);
+
+void* operator new(size_t size)
+{
+    if(countingAllocations.load(memory_order_relaxed)) {
+        nAllocations.fetch_add(1, memory_order_relaxed);
+        nBytesAllocated.fetch_add(size, memory_order_relaxed);
+    }
+    void *memory = malloc(size == 0 ? 1 : size);
+    if(!memory) throw bad_alloc();
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+/**
+ * Function for writing a number with a k, M or G suffix.
+ *
+ * @param value: The number.
+ *
+ * @return The number with three significant digits.
+ */
+static string scaled(double value)
+{
+    static const char *SUFFIXES[] = { "", "k", "M", "G" };
+    int s = 0;
+    while(value >= 1000.0 && s < 3) {
+        value /= 1000.0;
+        s++;
+    }
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), value < 10.0 ? "%.2f%s" : value < 100.0 ? "%.1f%s" : "%.0f%s", value, SUFFIXES[s]);
+    return buffer;
+}
+
+/**
+ * Function for measuring the functions on an object file. The file is
+ * parsed without the mesh cache, and the other functions are measured
+ * on the parsed object.
+ *
+ * @param objFile: The path of the object file.
+ */
+void MeshBenchmark::runFile(const string &objFile)
+{
+    size_t slash = objFile.find_last_of('/');
+    string filePath = slash == string::npos ? "." : objFile.substr(0, slash);
+    string fileName = slash == string::npos ? objFile : objFile.substr(slash + 1);
+    runParse(fileName, filePath, fileName);
+
+    Loader::LoaderInfo lInfo;
+    lInfo.useMeshCache = false;
+    bool success;
+    Loader loader;
+    Object object = loader.parseFile(success, fileName, filePath, lInfo);
+    if(success) runObject(object, fileName);
+}
+
+/**
+ * Function for measuring the functions on a sphere with the given number
+ * of triangles. The sphere is also written to an object file and parsed,
+ * if it is not larger than MAX_PARSED_TRIANGLES. The normal generator
+ * is also compared to the implementation it replaced on the sphere.
+ *
+ * @param nTriangles: About how many triangles the sphere has.
+ */
+void MeshBenchmark::runSynthetic(size_t nTriangles)
+{
+    Object object("synthetic");
+    makeSphere(nTriangles, object);
+    string mesh = "sphere_" + scaled(static_cast<double>(object.getTriangleCount(0)));
+
+    if(nTriangles <= MAX_PARSED_TRIANGLES) {
+        string fileName = "bench_" + mesh + ".obj";
+        ofstream file(fileName);
+        char line[96];
+        for(const Vertex &vertex : object.vertices) {
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", vertex.position.x, vertex.position.y, vertex.position.z);
+            file << line;
+        }
+        const vector<unsigned int> &indices = object.faces[0].indices;
+        for(size_t i = 0; i < indices.size(); i += 3) {
+            snprintf(line, sizeof(line), "f %u %u %u\n", indices[i] + 1, indices[i + 1] + 1, indices[i + 2] + 1);
+            file << line;
+        }
+        file.close();
+        if(file) runParse(fileName, ".", mesh);
+        remove(fileName.c_str());
+    }
+    runObject(object, mesh);
+    comparisons.push_back(NormalGenerator::benchmark(object.vertices, object.getTriangles()));
+}
+
+/**
+ * Function for making a bumpy sphere with a radius of about 3, so that
+ * normalizing it does some work. The rows and columns are chosen to
+ * give close to the given number of triangles.
+ *
+ * @param nTriangles: About how many triangles the sphere should have.
+ * @param object: The object that gets the vertices and a single face.
+ */
+void MeshBenchmark::makeSphere(size_t nTriangles, Object &object)
+{
+    size_t rows = std::max<size_t>(2, static_cast<size_t>(sqrt(nTriangles/4.0) + 0.5));
+    size_t columns = 2*rows;
+    object.vertices.clear();
+    object.vertices.reserve((rows + 1)*(columns + 1));
+    for(size_t r = 0; r <= rows; r++) {
+        float theta = 3.14159265f*r/rows;
+        for(size_t c = 0; c <= columns; c++) {
+            float phi = 2.0f*3.14159265f*c/columns;
+            float radius = 3.0f + 0.1f*sin(7.0f*theta)*cos(5.0f*phi);
+            object.vertices.push_back(Vertex(radius*sin(theta)*cos(phi), radius*cos(theta), radius*sin(theta)*sin(phi)));
+        }
+    }
+
+    Object::Face face;
+    face.materialIndex = -1;
+    face.indices.reserve(6*rows*columns);
+    for(size_t r = 0; r < rows; r++) {
+        for(size_t c = 0; c < columns; c++) {
+            unsigned int v0 = static_cast<unsigned int>(r*(columns + 1) + c);
+            unsigned int v1 = v0 + 1;
+            unsigned int v2 = v0 + static_cast<unsigned int>(columns + 1);
+            unsigned int v3 = v2 + 1;
+            unsigned int triangles[6] = { v0, v2, v1, v1, v2, v3 };
+            face.indices.insert(face.indices.end(), triangles, triangles + 6);
+        }
+    }
+    object.faces.clear();
+    object.faces.push_back(move(face));
+    object.oInfo.nVertices = static_cast<int>(object.vertices.size());
+    object.oInfo.nIndices = static_cast<int>(object.faces[0].indices.size());
+}
+
+/**
+ * Function for making a table of all results, followed by the
+ * comparisons of the normal generator.
+ *
+ * @return The table and the comparisons.
+ */
+string MeshBenchmark::report() const
+{
+    string table = "Benchmark                                              Time   Iterations  Triangles/s      MB/s  Allocs/call  Alloc MB/call\n";
+    char line[256];
+    for(const Result &result : results) {
+        string name = result.name + "/" + result.mesh;
+        snprintf(line, sizeof(line), "%-48s %9.3f ms %10zu %12s %9.1f %12.1f %14.2f\n", name.c_str(), result.time,
+                 result.iterations, scaled(result.trianglesPerSecond).c_str(), result.megabytesPerSecond,
+                 result.allocationsPerCall, result.bytesAllocatedPerCall/1048576.0);
+        table += line;
+    }
+    for(const string &comparison : comparisons) table += comparison;
+    return table;
+}
+
+/**
+ * Function for measuring the whole load of an object file, as it runs
+ * in the background of the program. The load is measured cold, without
+ * the mesh cache, and warm, from a cache file that the first call of the
+ * warm benchmark writes. A cache file that did not exist before is
+ * removed again afterwards.
+ *
+ * @param fileName: The name of the object file.
+ * @param filePath: The directory of the object file.
+ * @param mesh: The name of the mesh in the results.
+ */
+void MeshBenchmark::runParse(const string &fileName, const string &filePath, const string &mesh)
+{
+    ifstream file(filePath + "/" + fileName, ios::binary | ios::ate);
+    size_t nBytes = file ? static_cast<size_t>(file.tellg()) : 0;
+    Loader::LoaderInfo lInfo;
+    size_t nTriangles = 0;
+    auto parse = [&]() {
+        bool success;
+        Loader loader;
+        Object object = loader.parseFile(success, fileName, filePath, lInfo);
+        nTriangles = object.getTriangleCount(0);
+    };
+
+    lInfo.useMeshCache = false;
+    measure("Loader::parseFile(cold)", mesh, 0, nBytes, parse);
+    results.back().trianglesPerSecond = nTriangles*1000.0/results.back().time;
+
+    string cacheFile = MeshCache().getCacheFile(filePath + "/" + fileName);
+    bool cached = ifstream(cacheFile).good();
+    lInfo.useMeshCache = true;
+    measure("Loader::parseFile(warm)", mesh, 0, nBytes, parse);
+    results.back().trianglesPerSecond = nTriangles*1000.0/results.back().time;
+    if(!cached) remove(cacheFile.c_str());
+}
+
+/**
+ * Function for measuring the functions that work on a loaded object.
+ *
+ * @param object: The object, its vertices are changed.
+ * @param mesh: The name of the mesh in the results.
+ */
+void MeshBenchmark::runObject(Object &object, const string &mesh)
+{
+    size_t nTriangles = object.getTriangleCount(0);
+    size_t vertexBytes = object.vertices.size()*sizeof(Vertex);
+    size_t indexBytes = 3*nTriangles*sizeof(unsigned int);
+    Loader loader;
+    float largestLength = 0.0f;
+
+    measure("Object::getLargestVertexLength", mesh, nTriangles, vertexBytes, [&]() {
+        largestLength = object.getLargestVertexLength();
+    });
+    measure("Object::produceTextureCoords", mesh, nTriangles, vertexBytes, [&]() {
+        object.produceTextureCoords(largestLength);
+    });
+    // Dividing by one keeps the object the same size for the next call.
+    measure("Loader::normalizeVertexCoords", mesh, nTriangles, vertexBytes, [&]() {
+        loader.normalizeVertexCoords(object.vertices, 1.0f);
+    });
+    measure("Object::produceVertexNormals", mesh, nTriangles, vertexBytes + indexBytes, [&]() {
+        object.produceVertexNormals(NormalGenerator::ANGLE_WEIGHTED);
+    });
+}
+
+/**
+ * Function for calling a function until it has run for at least the
+ * minimum time, after one call to warm up the caches. The result is
+ * added to the results.
+ *
+ * @param name: The name of the function.
+ * @param mesh: The name of the mesh.
+ * @param nTriangles: The number of triangles handled by a call.
+ * @param nBytes: The number of bytes handled by a call.
+ * @param function: The function to measure.
+ */
+template<class Function>
+void MeshBenchmark::measure(const string &name, const string &mesh, size_t nTriangles, size_t nBytes, Function function)
+{
+    typedef chrono::steady_clock Clock;
+    function();
+
+    size_t allocationsBefore = nAllocations;
+    size_t bytesBefore = nBytesAllocated;
+    countingAllocations = true;
+    size_t iterations = 0;
+    double elapsed = 0.0;
+    Clock::time_point start = Clock::now();
+    do {
+        function();
+        iterations++;
+        elapsed = chrono::duration<double>(Clock::now() - start).count();
+    } while(elapsed < minTime);
+    countingAllocations = false;
+
+    Result result;
+    result.name = name;
+    result.mesh = mesh;
+    result.iterations = iterations;
+    result.time = 1000.0*elapsed/iterations;
+    result.trianglesPerSecond = nTriangles*iterations/elapsed;
+    result.megabytesPerSecond = nBytes*iterations/elapsed/1048576.0;
+    result.allocationsPerCall = static_cast<double>(nAllocations - allocationsBefore)/iterations;
+    result.bytesAllocatedPerCall = static_cast<double>(nBytesAllocated - bytesBefore)/iterations;
+    results.push_back(result);
+}
@@ -0,0 +1,345 @@
+#include "creasenormals.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+/**
+ * This class generates vertex normals that keep hard edges.
+ */
+
+namespace
+{
+    // The bits of a position, so that equal positions can be found with a hash map.
+    struct PositionKey {
+        uint32_t x, y, z;
+        bool operator==(const PositionKey &o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey &k) const {
+            return (size_t(k.x)*73856093u) ^ (size_t(k.y)*19349663u) ^ (size_t(k.z)*83492791u);
+        }
+    };
+
+    PositionKey toKey(const glm::vec3 &p)
+    {
+        PositionKey key;
+        memcpy(&key.x, &p.x, sizeof(float));
+        memcpy(&key.y, &p.y, sizeof(float));
+        memcpy(&key.z, &p.z, sizeof(float));
+        return key;
+    }
+}
+
+/**
+ * Function for setting the mesh that the normals are generated for. The
+ * face normals, the adjacency and the pairs of corners that share an edge
+ * are computed once here, and no normals are written until the mesh is
+ * updated with a crease angle.
+ *
+ * @param vertices: The vertices of the mesh, without any split vertices.
+ * @param triangles: Three vertex indices for each triangle.
+ * @param groups: The smoothing group of each triangle, 0 if it has none.
+ * @param weighting: How the normals of the triangles are weighted.
+ */
+void CreaseNormals::setMesh(const vector<Vertex> &vertices, const vector<unsigned int> &triangles,
+                            const vector<unsigned int> &groups, NormalGenerator::Weighting weighting)
+{
+    baseVertices = vertices;
+    baseTriangles = triangles;
+    fileHasGroups = false;
+    for(unsigned int group : groups) {
+        if(group != 0) {
+            fileHasGroups = true;
+            break;
+        }
+    }
+
+    NormalGenerator generator(ThreadPool::shared());
+    generator.prepare(vertices, triangles, weighting);
+    adjacencyStart = generator.getAdjacencyStart();
+    adjacency = generator.getAdjacency();
+
+    // Copy what the updates read into the order of the adjacency, so
+    // the corners of a vertex are next to each other in memory.
+    size_t nEntries = adjacency.size();
+    unitNormals.resize(nEntries);
+    weightedNormals.resize(nEntries);
+    cornerGroups.resize(nEntries);
+    ThreadPool::shared().parallelFor((nEntries + TASK_SIZE - 1)/TASK_SIZE, [&](size_t task) {
+        size_t last = std::min(nEntries, (task + 1)*TASK_SIZE);
+        for(size_t a = task*TASK_SIZE; a < last; a++) {
+            unsigned int corner = adjacency[a];
+            unsigned int t = corner/3;
+            glm::vec3 normal = generator.getFaceNormal(t);
+            float length = glm::length(normal);
+            unitNormals[a] = length > 0.0f ? normal/length : glm::vec3(0.0f);
+            weightedNormals[a] = generator.getCornerWeight(corner)*normal;
+            cornerGroups[a] = t < groups.size() ? groups[t] : 0;
+        }
+    });
+
+    // Vertices at the same position, like the two sides of a texture seam, get the same id.
+    size_t nVertices = vertices.size();
+    vector<unsigned int> positionIds(nVertices);
+    unordered_map<PositionKey, unsigned int, PositionKeyHash> idAtPosition;
+    idAtPosition.reserve(nVertices);
+    for(size_t v = 0; v < nVertices; v++) {
+        positionIds[v] = idAtPosition.insert(make_pair(toKey(vertices[v].position), static_cast<unsigned int>(v))).first->second;
+    }
+
+    // The pairs are found for each vertex on its own, and then put after each other.
+    size_t nTasks = (nVertices + TASK_SIZE - 1)/TASK_SIZE;
+    vector<vector<CornerPair>> taskPairs(nTasks);
+    pairStart.assign(nVertices + 1, 0);
+    ThreadPool::shared().parallelFor(nTasks, [&](size_t task) {
+        size_t last = std::min(nVertices, (task + 1)*TASK_SIZE);
+        vector<pair<unsigned int, unsigned int>> edges;
+        vector<CornerPair> vertexPairs;
+        for(size_t v = task*TASK_SIZE; v < last; v++) {
+            findPairs(v, positionIds, edges, vertexPairs);
+            pairStart[v + 1] = static_cast<unsigned int>(vertexPairs.size());
+            taskPairs[task].insert(taskPairs[task].end(), vertexPairs.begin(), vertexPairs.end());
+        }
+    });
+    for(size_t v = 0; v < nVertices; v++) pairStart[v + 1] += pairStart[v];
+    pairs.clear();
+    pairs.reserve(pairStart[nVertices]);
+    for(const vector<CornerPair> &vertexPairs : taskPairs) pairs.insert(pairs.end(), vertexPairs.begin(), vertexPairs.end());
+
+    fanRoot.resize(nEntries);
+    minCosine.assign(nVertices, 2.0f);
+    maxCosine.assign(nVertices, -2.0f);
+    slotNormals.assign(nEntries, glm::vec3(0.0f));
+    nSlots.assign(nVertices, 1);
+    cornerSlot.assign(triangles.size(), 0);
+    nExtraVertices = 0;
+    applied = false;
+}
+
+/**
+ * Function for checking if the normals have to be updated for a crease
+ * angle and use of smoothing groups.
+ *
+ * @param creaseAngle: The crease angle in degrees.
+ * @param useGroups: If the smoothing groups of the object file are used.
+ *
+ * @return True if the normals are not already made with these settings.
+ */
+bool CreaseNormals::needsUpdate(float creaseAngle, bool useGroups) const
+{
+    if(empty()) return false;
+    return !applied || appliedCosine != toCosine(creaseAngle) || appliedGroups != (useGroups && fileHasGroups);
+}
+
+/**
+ * Function for updating the normals for a crease angle. The first update,
+ * and any update that turns the smoothing groups on or off, computes every
+ * vertex. Otherwise only the vertices with a pair of triangles whose
+ * cosine is between the old and the new crease angle are computed.
+ *
+ * @param creaseAngle: The crease angle in degrees.
+ * @param useGroups: If the smoothing groups of the object file are used.
+ *
+ * @return The number of vertices that were computed.
+ */
+size_t CreaseNormals::update(float creaseAngle, bool useGroups)
+{
+    float cosine = toCosine(creaseAngle);
+    useGroups = useGroups && fileHasGroups;
+    bool full = !applied || appliedGroups != useGroups;
+    float low = std::min(cosine, appliedCosine);
+    float high = std::max(cosine, appliedCosine);
+
+    size_t nVertices = baseVertices.size();
+    size_t nTasks = (nVertices + TASK_SIZE - 1)/TASK_SIZE;
+    vector<size_t> counts(nTasks, 0);
+    ThreadPool::shared().parallelFor(nTasks, [&](size_t task) {
+        size_t last = std::min(nVertices, (task + 1)*TASK_SIZE);
+        for(size_t v = task*TASK_SIZE; v < last; v++) {
+            // A pair changes if its cosine is at least low but below high.
+            if(!full && (maxCosine[v] < low || minCosine[v] >= high)) continue;
+            updateVertex(v, cosine, useGroups, full);
+            counts[task]++;
+        }
+    });
+
+    nExtraVertices = 0;
+    for(size_t v = 0; v < nVertices; v++) nExtraVertices += nSlots[v] - 1;
+
+    appliedCosine = cosine;
+    appliedGroups = useGroups;
+    applied = true;
+
+    size_t nUpdated = 0;
+    for(size_t count : counts) nUpdated += count;
+    return nUpdated;
+}
+
+/**
+ * Function for finding the pairs of corners of a vertex whose triangles
+ * share an edge. Each corner is listed once for each of the two other
+ * vertices of its triangle, and after sorting the corners that list the
+ * same position are next to each other.
+ *
+ * @param v: The vertex.
+ * @param positionIds: The id of the position of each vertex.
+ * @param edges: Space for the position at the other end and the entry of each corner.
+ * @param vertexPairs: Set to the pairs of the vertex.
+ */
+void CreaseNormals::findPairs(size_t v, const vector<unsigned int> &positionIds,
+                              vector<pair<unsigned int, unsigned int>> &edges, vector<CornerPair> &vertexPairs) const
+{
+    unsigned int first = adjacencyStart[v];
+    unsigned int last = adjacencyStart[v + 1];
+    edges.clear();
+    vertexPairs.clear();
+    for(unsigned int a = first; a < last; a++) {
+        unsigned int corner = adjacency[a];
+        unsigned int t = corner/3;
+        edges.push_back(make_pair(positionIds[baseTriangles[3*t + (corner + 1)%3]], a));
+        edges.push_back(make_pair(positionIds[baseTriangles[3*t + (corner + 2)%3]], a));
+    }
+    sort(edges.begin(), edges.end());
+
+    for(size_t e = 1; e < edges.size(); e++) {
+        if(edges[e].first != edges[e - 1].first || edges[e].second == edges[e - 1].second) continue;
+        CornerPair cornerPair;
+        cornerPair.first = edges[e - 1].second;
+        cornerPair.second = edges[e].second;
+        // Degenerate triangles have no direction and are smoothed with anything.
+        const glm::vec3 &normalA = unitNormals[cornerPair.first];
+        const glm::vec3 &normalB = unitNormals[cornerPair.second];
+        bool degenerate = normalA == glm::vec3(0.0f) || normalB == glm::vec3(0.0f);
+        cornerPair.cosine = degenerate ? 2.0f : glm::dot(normalA, normalB);
+        unsigned int group = cornerGroups[cornerPair.first];
+        cornerPair.sameGroup = group != 0 && group == cornerGroups[cornerPair.second];
+        vertexPairs.push_back(cornerPair);
+    }
+}
+
+/**
+ * Function for computing the normals of the corners of one vertex. The
+ * pairs of corners that are smoothed together are joined into fans, and
+ * each fan gets a slot with the normal of its triangles. Each slot
+ * becomes one vertex of the mesh.
+ *
+ * @param v: The vertex.
+ * @param cosine: The cosine of the crease angle.
+ * @param useGroups: If triangles must be in the same smoothing group.
+ * @param full: If the cosine range of the vertex is computed as well.
+ */
+void CreaseNormals::updateVertex(size_t v, float cosine, bool useGroups, bool full)
+{
+    unsigned int first = adjacencyStart[v];
+    unsigned int last = adjacencyStart[v + 1];
+    if(full) {
+        minCosine[v] = 2.0f;
+        maxCosine[v] = -2.0f;
+    }
+
+    for(unsigned int a = first; a < last; a++) fanRoot[a] = a;
+    for(unsigned int p = pairStart[v]; p < pairStart[v + 1]; p++) {
+        const CornerPair &cornerPair = pairs[p];
+        if(useGroups && !cornerPair.sameGroup) continue;
+        if(full && cornerPair.cosine <= 1.0f) {
+            minCosine[v] = std::min(minCosine[v], cornerPair.cosine);
+            maxCosine[v] = std::max(maxCosine[v], cornerPair.cosine);
+        }
+        if(cornerPair.cosine < cosine && cornerPair.cosine <= SAME_NORMAL) continue;
+
+        // The fan is named by its first entry, so the roots come in order below.
+        unsigned int rootA = findRoot(cornerPair.first);
+        unsigned int rootB = findRoot(cornerPair.second);
+        if(rootA < rootB) fanRoot[rootB] = rootA;
+        else fanRoot[rootA] = rootB;
+    }
+
+    // The slot of a fan is kept at the corner of its root until the sums are done.
+    unsigned int slots = 0;
+    for(unsigned int a = first; a < last; a++) {
+        unsigned int root = findRoot(a);
+        if(root == a) {
+            cornerSlot[adjacency[a]] = slots;
+            slotNormals[first + slots++] = weightedNormals[a];
+        } else {
+            unsigned int slot = cornerSlot[adjacency[root]];
+            cornerSlot[adjacency[a]] = slot;
+            slotNormals[first + slot] += weightedNormals[a];
+        }
+    }
+    for(unsigned int s = 0; s < slots; s++) {
+        glm::vec3 &normal = slotNormals[first + s];
+        float length = glm::length(normal);
+        normal = length > 0.0f ? normal/length : glm::vec3(0.0f);
+    }
+    nSlots[v] = std::max(1u, slots);
+}
+
+/**
+ * Function for finding the first entry of the fan that an entry of the
+ * adjacency is in. The path is halved on the way, so later searches are
+ * shorter.
+ *
+ * @param a: The entry of the adjacency.
+ *
+ * @return The first entry of its fan.
+ */
+unsigned int CreaseNormals::findRoot(unsigned int a)
+{
+    while(fanRoot[a] != a) {
+        fanRoot[a] = fanRoot[fanRoot[a]];
+        a = fanRoot[a];
+    }
+    return a;
+}
+
+/**
+ * Function for writing the mesh with the current normals. Every vertex
+ * keeps its index for its first normal, and the vertices that are split
+ * are added after all the other vertices.
+ *
+ * @param vertices: Set to the vertices of the mesh.
+ * @param triangles: Set to three vertex indices for each triangle, in the same order as the triangles of the mesh.
+ */
+void CreaseNormals::writeMesh(vector<Vertex> &vertices, vector<unsigned int> &triangles) const
+{
+    size_t nVertices = baseVertices.size();
+    vertices.assign(baseVertices.begin(), baseVertices.end());
+    vertices.reserve(nVertices + nExtraVertices);
+    vector<unsigned int> extraStart(nVertices);
+    for(size_t v = 0; v < nVertices; v++) {
+        const glm::vec3 *normals = &slotNormals[adjacencyStart[v]];
+        if(adjacencyStart[v] < adjacencyStart[v + 1]) vertices[v].normal = normals[0];
+        extraStart[v] = static_cast<unsigned int>(vertices.size()) - 1;
+        for(unsigned int s = 1; s < nSlots[v]; s++) {
+            Vertex vertex = baseVertices[v];
+            vertex.normal = normals[s];
+            vertices.push_back(vertex);
+        }
+    }
+
+    triangles.resize(baseTriangles.size());
+    for(size_t c = 0; c < baseTriangles.size(); c++) {
+        unsigned int v = baseTriangles[c];
+        unsigned int slot = cornerSlot[c];
+        triangles[c] = slot == 0 ? v : extraStart[v] + slot;
+    }
+}
+
+/**
+ * Function for turning a crease angle into the smallest cosine between
+ * two triangles that are smoothed together. At 180 degrees all triangles
+ * are smoothed, even if rounding makes their cosine slightly below -1.
+ *
+ * @param creaseAngle: The crease angle in degrees.
+ *
+ * @return The cosine of the angle.
+ */
+float CreaseNormals::toCosine(float creaseAngle)
+{
+    if(creaseAngle >= 180.0f) return -2.0f;
+    return cos(std::max(0.0f, creaseAngle)*3.14159265f/180.0f);
+}
@@ -0,0 +1,188 @@
+#include "framecapture.h"
+#include "pngwriter.h"
+#include "threadpool.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/**
+ * This class renders into a framebuffer that is not shown anywhere and
+ * saves the rendered frames as PNG files.
+ */
+
+// How long collect waits for a copy before it gives up, in nanoseconds.
+static const GLuint64 FENCE_TIMEOUT = 5000000000ull;
+
+/**
+ * Deconstructor of the class. Waits for the files that are being
+ * written, frames that are still being copied are dropped.
+ */
+FrameCapture::~FrameCapture()
+{
+    for(Readback &readback : ring) {
+        if(readback.fence) glDeleteSync(readback.fence);
+        readback.fence = 0;
+    }
+    waitForWrites();
+}
+
+/**
+ * Function for creating the framebuffer and the pixel buffers that the
+ * frames are read into. The framebuffer has an RGBA color buffer and a
+ * 24 bit depth buffer.
+ *
+ * @param width: The width of the frames in pixels.
+ * @param height: The height of the frames in pixels.
+ *
+ * @return True if the framebuffer is complete and can be drawn to.
+ */
+bool FrameCapture::create(int width, int height)
+{
+    finish();
+    captureWidth = width;
+    captureHeight = height;
+
+    colorBuffer.create();
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer.id());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    depthBuffer.create();
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer.id());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    framebuffer.create();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer.id());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer.id());
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for(Readback &readback : ring) {
+        readback.buffer.create();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.id());
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width)*height*3, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return complete;
+}
+
+/**
+ * Function for drawing into the framebuffer instead of the window.
+ */
+void FrameCapture::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.id());
+    glViewport(0, 0, captureWidth, captureHeight);
+}
+
+/**
+ * Function for drawing into the window again.
+ */
+void FrameCapture::unbind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * Function for starting to copy what has been drawn into the
+ * framebuffer. The copy is done by the GPU, and the frame is written
+ * to the file by a later call to collect. If all pixel buffers are
+ * in use, the oldest frame is collected first.
+ *
+ * @param fileName: The PNG file to write the frame to.
+ */
+void FrameCapture::readBack(const string &fileName)
+{
+    if(nRead - nCollected == RING_SIZE) collectOldest(true);
+
+    Readback &readback = ring[nRead % RING_SIZE];
+    readback.fileName = fileName;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.id());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.id());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, captureWidth, captureHeight, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nRead++;
+}
+
+/**
+ * Function for sending the frames that have been copied to be written.
+ * Frames are collected in the order they were read.
+ *
+ * @param wait: If the copies that are not done yet should be waited for.
+ */
+void FrameCapture::collect(bool wait)
+{
+    while(nCollected < nRead && collectOldest(wait)) {}
+}
+
+/**
+ * Function for waiting until every frame that has been read back is
+ * written to its file.
+ */
+void FrameCapture::finish()
+{
+    collect(true);
+    waitForWrites();
+}
+
+/**
+ * Function for taking the pixels of the oldest frame that is being
+ * copied, and writing them to the file in the shared thread pool.
+ *
+ * @param wait: If the copy should be waited for if it is not done.
+ *
+ * @return True if the frame was collected.
+ */
+bool FrameCapture::collectOldest(bool wait)
+{
+    Readback &readback = ring[nCollected % RING_SIZE];
+    GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? FENCE_TIMEOUT : 0);
+    if(status == GL_TIMEOUT_EXPIRED && !wait) return false;
+    glDeleteSync(readback.fence);
+    readback.fence = 0;
+    nCollected++;
+    if(status == GL_WAIT_FAILED || status == GL_TIMEOUT_EXPIRED) {
+        nFailed++;
+        return true;
+    }
+
+    size_t size = static_cast<size_t>(captureWidth)*captureHeight*3;
+    shared_ptr<vector<unsigned char>> pixels = make_shared<vector<unsigned char>>(size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer.id());
+    void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    bool copied = mapped != NULL;
+    if(copied) memcpy(pixels->data(), mapped, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if(!copied) {
+        nFailed++;
+        return true;
+    }
+
+    {
+        lock_guard<mutex> lock(writeMutex);
+        writesInFlight++;
+    }
+    string fileName = readback.fileName;
+    int width = captureWidth, height = captureHeight;
+    ThreadPool::shared().enqueue([this, pixels, fileName, width, height]() {
+        // OpenGL reads the bottom row first.
+        bool written = PngWriter::write(fileName, width, height, 3, pixels->data(), true);
+        written ? nWritten++ : nFailed++;
+        lock_guard<mutex> lock(writeMutex);
+        writesInFlight--;
+        writeDone.notify_all();
+    });
+    return true;
+}
+
+/**
+ * Function for waiting until the thread pool has written all files.
+ */
+void FrameCapture::waitForWrites()
+{
+    unique_lock<mutex> lock(writeMutex);
+    writeDone.wait(lock, [this]() { return writesInFlight == 0; });
+}
@@ -0,0 +1,213 @@
+#include "frustum.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * This file contains the bounding volumes of the objects and the
+ * view frustum that they are tested against.
+ */
+
+namespace
+{
+    /**
+     * Function for finding the radius of the smallest sphere around a
+     * given center that contains all the given vertices.
+     */
+    template<class IndexFunction>
+    float sphereRadius(const vector<Vertex> &vertices, size_t n, const glm::vec3 &center, IndexFunction index)
+    {
+        float radius2 = 0.0f;
+        for(size_t i = 0; i < n; i++) {
+            glm::vec3 d = vertices[index(i)].position - center;
+            radius2 = max(radius2, glm::dot(d, d));
+        }
+        return sqrt(radius2);
+    }
+}
+
+/**
+ * Function for computing the bounding volume of all the given
+ * vertices. The sphere is centered in the middle of the box.
+ *
+ * @param vertices: The vertices to bound.
+ *
+ * @return The bounding volume, empty if there are no vertices.
+ */
+BoundingVolume BoundingVolume::fromVertices(const vector<Vertex> &vertices)
+{
+    BoundingVolume volume;
+    if(vertices.empty()) return volume;
+
+    volume.min = volume.max = vertices[0].position;
+    for(const Vertex &vertex : vertices) {
+        volume.min = glm::min(volume.min, vertex.position);
+        volume.max = glm::max(volume.max, vertex.position);
+    }
+    volume.center = 0.5f*(volume.min + volume.max);
+    volume.radius = sphereRadius(vertices, vertices.size(), volume.center, [](size_t i) { return i; });
+    return volume;
+}
+
+/**
+ * Function for computing the bounding volume of the vertices that
+ * are used by the given indices, such as the indices of a single
+ * material group.
+ *
+ * @param vertices: The vertices of the object.
+ * @param indices: The indices of the vertices to bound.
+ *
+ * @return The bounding volume, empty if there are no indices.
+ */
+BoundingVolume BoundingVolume::fromIndices(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+{
+    BoundingVolume volume;
+    if(indices.empty()) return volume;
+
+    volume.min = volume.max = vertices[indices[0]].position;
+    for(unsigned int index : indices) {
+        volume.min = glm::min(volume.min, vertices[index].position);
+        volume.max = glm::max(volume.max, vertices[index].position);
+    }
+    volume.center = 0.5f*(volume.min + volume.max);
+    volume.radius = sphereRadius(vertices, indices.size(), volume.center, [&indices](size_t i) { return indices[i]; });
+    return volume;
+}
+
+/**
+ * Function for adding a sphere to the set.
+ *
+ * @param center: The center of the sphere.
+ * @param radius: The radius of the sphere.
+ */
+void SphereSet::add(const glm::vec3 &center, float radius)
+{
+    x.push_back(center.x);
+    y.push_back(center.y);
+    z.push_back(center.z);
+    r.push_back(radius);
+}
+
+/**
+ * Function for extracting the frustum planes from a combined projection
+ * and view matrix. Each plane is a sum or difference of the last row
+ * and one of the other rows of the matrix, and is normalized so that
+ * the distances to it are in world units.
+ *
+ * @param projView: The projection matrix multiplied with the view matrix.
+ */
+void Frustum::extract(const glm::mat4 &projView)
+{
+    glm::vec4 rows[4];
+    for(int i = 0; i < 4; i++) rows[i] = glm::vec4(projView[0][i], projView[1][i], projView[2][i], projView[3][i]);
+
+    planes[0] = rows[3] + rows[0];  // Left
+    planes[1] = rows[3] - rows[0];  // Right
+    planes[2] = rows[3] + rows[1];  // Bottom
+    planes[3] = rows[3] - rows[1];  // Top
+    planes[4] = rows[3] + rows[2];  // Near
+    planes[5] = rows[3] - rows[2];  // Far
+
+    for(glm::vec4 &plane : planes) {
+        float length = glm::length(glm::vec3(plane));
+        if(length > 0.0f) plane /= length;
+    }
+}
+
+/**
+ * Function for testing a set of spheres against the frustum. A sphere
+ * is culled when it lies entirely on the outside of any plane. The
+ * planes are the outer loop so that the inner loop runs over plain
+ * float arrays without any branches.
+ *
+ * @param spheres: The spheres to test, in world coordinates.
+ * @param visible: Set to 1 for the spheres that may be visible and 0 for the others.
+ */
+void Frustum::cullSpheres(const SphereSet &spheres, vector<unsigned char> &visible) const
+{
+    size_t n = spheres.size();
+    visible.assign(n, 1);
+
+    const float *x = spheres.x.data();
+    const float *y = spheres.y.data();
+    const float *z = spheres.z.data();
+    const float *r = spheres.r.data();
+    unsigned char *out = visible.data();
+
+    for(const glm::vec4 &plane : planes) {
+        const float a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+        for(size_t i = 0; i < n; i++) {
+            float distance = a*x[i] + b*y[i] + c*z[i] + d;
+            out[i] &= static_cast<unsigned char>(distance >= -r[i]);
+        }
+    }
+}
+
+/**
+ * Function for testing a bounding box against the frustum. The box is
+ * transformed by the model matrix into a box in world coordinates that
+ * contains it, which is then tested against each plane.
+ *
+ * @param volume: The bounding volume, in the coordinates of the object.
+ * @param M: The matrix that places the object in the world.
+ *
+ * @return False if the box is entirely outside the frustum.
+ */
+bool Frustum::intersects(const BoundingVolume &volume, const glm::mat4 &M) const
+{
+    glm::vec3 center = glm::vec3(M*glm::vec4(0.5f*(volume.min + volume.max), 1.0f));
+    glm::vec3 halfSize = 0.5f*(volume.max - volume.min);
+
+    glm::mat3 absM = glm::mat3(M);
+    for(int c = 0; c < 3; c++) absM[c] = glm::abs(absM[c]);
+    glm::vec3 extent = absM*halfSize;
+
+    for(const glm::vec4 &plane : planes) {
+        glm::vec3 normal = glm::vec3(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float reach = glm::dot(glm::abs(normal), extent);
+        if(distance + reach < 0.0f) return false;
+    }
+    return true;
+}
+
+/**
+ * Function for classifying a box in world coordinates against the
+ * frustum. A box that is inside every plane is entirely inside the
+ * frustum, which lets a hierarchy accept all its children at once.
+ *
+ * @param min: The smallest corner of the box.
+ * @param max: The largest corner of the box.
+ *
+ * @return If the box is outside, intersecting or inside the frustum.
+ */
+Frustum::Containment Frustum::classify(const glm::vec3 &min, const glm::vec3 &max) const
+{
+    glm::vec3 center = 0.5f*(min + max);
+    glm::vec3 halfSize = 0.5f*(max - min);
+
+    Containment result = INSIDE;
+    for(const glm::vec4 &plane : planes) {
+        glm::vec3 normal = glm::vec3(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float reach = glm::dot(glm::abs(normal), halfSize);
+        if(distance + reach < 0.0f) return OUTSIDE;
+        if(distance - reach < 0.0f) result = INTERSECTS;
+    }
+    return result;
+}
+
+/**
+ * Function for finding the largest scaling that a matrix applies to
+ * any axis, which is how much a bounding sphere grows with it.
+ *
+ * @param M: The matrix.
+ *
+ * @return The length of the longest of the first three columns.
+ */
+float Frustum::maxScale(const glm::mat4 &M)
+{
+    float scale2 = max(glm::dot(glm::vec3(M[0]), glm::vec3(M[0])),
+                   max(glm::dot(glm::vec3(M[1]), glm::vec3(M[1])),
+                       glm::dot(glm::vec3(M[2]), glm::vec3(M[2]))));
+    return sqrt(scale2);
+}
@@ -1,12 +1,15 @@
-#define TINYOBJLOADER_IMPLEMENTATION
 #include "loader.h"
 #include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
 
 /**
  * Parses a given object file and stores the different values in the loader class.
  * 
  * The function uses the tiny_obj_loader.h (https://github.com/tinyobjloader/tinyobjloader) 
- * to handle the inital parsing of the file.
+ * to handle the inital parsing of the file, or the multithreaded ObjParser if it
+ * is selected in the loader settings. Both produce the same shapes.
  * 
  * Attributes effected by method:
  *      vertexCoords    - The vertex coordinates for a shape.
@@ -16,74 +19,107 @@
  *      vertexNormals   - The vertex normals for each face of a shape.
  *      objectLoadError - Returns a true/false if a error has occured when trying to parse the file.
  *  
+ * The corners of all faces are welded so that each unique combination of
+ * position, normal and texture coordinate index becomes a single vertex,
+ * which is then shared by all faces that use it.
+ * 
+ * If the mesh cache is enabled and holds an up to date copy of the object made
+ * with the same settings, the object is loaded from the cache instead and no
+ * parsing, normal generation, simplification or tree building is done at all.
+ * After a successful load the finished object is written to the mesh cache.
+ * 
  * If any errors occur corresponding output will be sent without crashing the program.
  * 
+ * The loader can run on its own thread. It then reports its stage to the
+ * progress and stops between stages if the progress is cancelled, and the
+ * returned object is not loaded.
+ * 
+ * @param lInfo: The loader settings.
+ * @param progress: Where the stage is reported and cancelling is read, if not null.
+ * 
  * @returns New 3D object from the file.
  */
-Object Loader::parseFile(bool &parseSuccessful, string fileName, string filePath) 
+Object Loader::parseFile(bool &parseSuccessful, string fileName, string filePath, const LoaderInfo &lInfo, LoadProgress *progress) 
 {
     parseSuccessful = false;
-    tinyobj::ObjReaderConfig readerConfig;
-    readerConfig.mtl_search_path = filePath;
-    tinyobj::ObjReader reader;
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    string objFile = filePath + "/" + fileName;
+    char timeBuffer[64];
     Object newObject = Object(fileName);
-    if(!reader.ParseFromFile(filePath + "/" + fileName, readerConfig)) {
+
+    // Cached objects are only used if they were finished with the same settings.
+    if(progress) progress->stage = LoadProgress::READING_CACHE;
+    bool cacheHit = lInfo.useMeshCache && meshCache.load(objFile, newObject) && matchesSettings(newObject, lInfo);
+    if(!cacheHit) newObject = Object(fileName);
+    if(cacheHit) {
+        newObject.computeBounds();
+        double loadTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        snprintf(timeBuffer, sizeof(timeBuffer), "%.2f ms", loadTime);
+        outputString += "\tLoaded from mesh cache (warm) in " + string(timeBuffer) + "\n";
+        if(progress) progress->stage = LoadProgress::DONE;
+        newObject.oInfo.objectLoaded = true;
+        newObject.oInfo.loadTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        parseSuccessful = true;
+        return newObject;
+    }
+
+    // Parse the file with either the parallel front end or tinyobj.
+    tinyobj::ObjReader reader;
+    bool parsed;
+    string parserName;
+    if(lInfo.useParallelParser) {
+        parserName = "ObjParser";
+        parsed = objParser.parseFile(objFile, filePath, progress);
+    } else {
+        parserName = "TinyObjReader";
+        if(progress) progress->stage = LoadProgress::PARSING;
+        tinyobj::ObjReaderConfig readerConfig;
+        readerConfig.mtl_search_path = filePath;
+        parsed = reader.ParseFromFile(objFile, readerConfig);
+    }
+    const string &parseError = lInfo.useParallelParser ? objParser.getError() : reader.Error();
+    const string &parseWarning = lInfo.useParallelParser ? objParser.getWarning() : reader.Warning();
+
+    if(isCancelled(progress)) return newObject;
+    if(!parsed) {
         // If reader detects known error.
-        if (!reader.Error().empty()) {
+        if (!parseError.empty()) {
             outputString += "\nError: \n";
-            outputString += "\tTinyObjReader: ";
-            outputString += reader.Error();
+            outputString += "\t" + parserName + ": ";
+            outputString += parseError;
         }
         // If reader is unable to parse the file.
         return newObject;
     }
 
-    if (!reader.Warning().empty()) {
+    if (!parseWarning.empty()) {
         outputString +="\nWarning: \n";
-        outputString +="\tTinyObjReader: ";
-        outputString += reader.Warning();
+        outputString +="\t" + parserName + ": ";
+        outputString += parseWarning;
     }
 
-    auto& attrib = reader.GetAttrib();
-    auto& shapes = reader.GetShapes();
-    auto& materials = reader.GetMaterials();
+    const tinyobj::attrib_t &attrib = lInfo.useParallelParser ? objParser.getAttrib() : reader.GetAttrib();
+    const vector<tinyobj::shape_t> &shapes = lInfo.useParallelParser ? objParser.getShapes() : reader.GetShapes();
+    const vector<tinyobj::material_t> &materials = lInfo.useParallelParser ? objParser.getMaterials() : reader.GetMaterials();
 
+    if(progress) progress->stage = LoadProgress::BUILDING_MESH;
     std::map<int, Object::Face> faceMap;
     
+    // Every unique (position, normal, texture coordinate) triplet becomes one vertex.
+    unordered_map<IndexTriplet, unsigned int, IndexTripletHash> weldMap;
+    weldMap.reserve(attrib.vertices.size()/3);
+    int nNormals = static_cast<int>(attrib.normals.size()/3);
+    int nTexCoords = static_cast<int>(attrib.texcoords.size()/2);
+    // Which vertices got texture coordinates from the file.
+    vector<unsigned char> hasTexCoords;
+    hasTexCoords.reserve(attrib.vertices.size()/3);
+
     // Loop over object shapes
     for (size_t s = 0; s < shapes.size(); s++) {
         size_t index_offset = 0;
-        std::vector<unsigned char> faceVertices = shapes[s].mesh.num_face_vertices;
+        const std::vector<unsigned char> &faceVertices = shapes[s].mesh.num_face_vertices;
         newObject.oInfo.nFaces += faceVertices.size();
 
-        // Store all vertex coordinates
-        for (size_t i = 0; i < attrib.vertices.size(); i+=3) {
-            newObject.vertices.push_back(Vertex(
-                attrib.vertices[i], 
-                attrib.vertices[i+1], 
-                attrib.vertices[i+2]));
-            newObject.oInfo.nVertices++;
-        }
-
-        // Store all the vertex normals if they exist.
-        if(attrib.normals.size() != 0) {
-            for (size_t i = 0; i < attrib.vertices.size(); i+=3) {
-                newObject.vertices[i/3].setNormal(
-                    attrib.normals[i], 
-                    attrib.normals[i+1], 
-                    attrib.normals[i+2]);
-                newObject.oInfo.nVertexNormals++;
-            }
-        }
-
-        // Store all texture coordinates
-        for (size_t t = 0; t < attrib.texcoords.size(); t+=2) {
-            newObject.vertices[t/2].setTexCoords(
-                attrib.texcoords[t], 
-                attrib.texcoords[t+1]);
-            newObject.oInfo.nTexCoords++;
-        }
-
         // Loop over faces(polygon)
         for (size_t f = 0; f < faceVertices.size(); f++) {
             size_t fv = size_t(faceVertices[f]);
@@ -101,11 +137,41 @@ Object Loader::parseFile(bool &parseSuccessful, string fileName, string filePath
                     faceMap[matIndex].mInfo.ks = glm::vec3(mat.specular[0], mat.specular[1], mat.specular[2]);
                 }
             }
+            Object::Face &face = faceMap[matIndex];
+            const vector<unsigned int> &groupIds = shapes[s].mesh.smoothing_group_ids;
+            face.smoothingGroups.push_back(f < groupIds.size() ? groupIds[f] : 0);
 
-            // Store all indices for each face
+            // Store the welded vertex index for each corner of the face
             for (size_t v = 0; v < fv; v++) {
                 tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-                faceMap[matIndex].indices.push_back(idx.vertex_index);
+                IndexTriplet key = {
+                    idx.vertex_index,
+                    idx.normal_index >= 0 && idx.normal_index < nNormals ? idx.normal_index : -1,
+                    idx.texcoord_index >= 0 && idx.texcoord_index < nTexCoords ? idx.texcoord_index : -1 };
+
+                auto inserted = weldMap.insert(make_pair(key, static_cast<unsigned int>(newObject.vertices.size())));
+                if(inserted.second) {
+                    Vertex vertex(
+                        attrib.vertices[3*key.v], 
+                        attrib.vertices[3*key.v+1], 
+                        attrib.vertices[3*key.v+2]);
+                    if(key.vn >= 0) {
+                        vertex.setNormal(
+                            attrib.normals[3*key.vn], 
+                            attrib.normals[3*key.vn+1], 
+                            attrib.normals[3*key.vn+2]);
+                        newObject.oInfo.nVertexNormals++;
+                    }
+                    if(key.vt >= 0) {
+                        vertex.setTexCoords(
+                            attrib.texcoords[2*key.vt], 
+                            attrib.texcoords[2*key.vt+1]);
+                        newObject.oInfo.nTexCoords++;
+                    }
+                    newObject.vertices.push_back(vertex);
+                    hasTexCoords.push_back(key.vt >= 0);
+                }
+                face.indices.push_back(inserted.first->second);
                 newObject.oInfo.nIndices++;
             }
             
@@ -113,6 +179,8 @@ Object Loader::parseFile(bool &parseSuccessful, string fileName, string filePath
         }
         newObject.oInfo.nShapes++;
     }
+    newObject.oInfo.nVertices = newObject.vertices.size();
+    newObject.oInfo.nUnweldedVertices = newObject.oInfo.nIndices;
 
     // Add all the material faces to the object.
     for (auto &pair : faceMap) {
@@ -121,14 +189,120 @@ Object Loader::parseFile(bool &parseSuccessful, string fileName, string filePath
     
     if(!newObject.oInfo.hasMaterials) newObject.oInfo.useDefaultMat = true;
     float largestVectorLength = newObject.getLargestVertexLength();
-    if(newObject.oInfo.nVertexNormals == 0) newObject.produceVertexNormals();
-    if(newObject.oInfo.nTexCoords == 0) newObject.produceTextureCoords(largestVectorLength);
+    // Vertices without texture coordinates in the file get generated ones, the others keep theirs.
+    if(newObject.oInfo.nTexCoords < newObject.oInfo.nVertices) newObject.produceTextureCoords(largestVectorLength, &hasTexCoords);
     normalizeVertexCoords(newObject.vertices, largestVectorLength);
+    if(isCancelled(progress)) return Object(fileName);
+    if(lInfo.optimizeMeshes) {
+        if(progress) progress->stage = LoadProgress::OPTIMIZING;
+        chrono::steady_clock::time_point optimizeStart = chrono::steady_clock::now();
+        newObject.optimizeMesh(lInfo.overdrawThreshold);
+        double optimizeTime = chrono::duration<double, milli>(chrono::steady_clock::now() - optimizeStart).count();
+        snprintf(timeBuffer, sizeof(timeBuffer), "%.2f ms, ACMR %.3f -> %.3f", optimizeTime,
+                 newObject.oInfo.cacheStatsBefore.acmr, newObject.oInfo.cacheStats.acmr);
+        outputString += "\tOptimized mesh for the vertex cache in " + string(timeBuffer) + "\n";
+    }
+
+    double loadTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    snprintf(timeBuffer, sizeof(timeBuffer), "%.2f ms", loadTime);
+    outputString += "\tParsed object file (cold, " + parserName + ") in " + string(timeBuffer) + "\n";
+    if(!finishObject(newObject, lInfo, progress)) return Object(fileName);
+    if(lInfo.useMeshCache && !meshCache.store(objFile, newObject)) {
+        outputString += "\tWarning: Could not write mesh cache file for \"" + fileName + "\"\n";
+    }
+
     newObject.oInfo.objectLoaded = true;
+    newObject.oInfo.loadTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
     parseSuccessful = true;
     return newObject;
 }
 
+/**
+ * Function for the steps that are done to a parsed object before it is
+ * stored in the mesh cache. Vertex normals are generated if any vertex
+ * lacks one in the object file, the levels of detail are built, and the
+ * bounds and triangle tree of the object are built.
+ * 
+ * @param object: The loaded object.
+ * @param lInfo: The loader settings.
+ * @param progress: Where the stage is reported and cancelling is read, if not null.
+ * 
+ * @return False if the load was cancelled.
+ */
+bool Loader::finishObject(Object &object, const LoaderInfo &lInfo, LoadProgress *progress)
+{
+    if(isCancelled(progress)) return false;
+    // Normals are generated for the whole object if any vertex lacks one, so that they are consistent.
+    if(object.oInfo.nVertexNormals < static_cast<int>(object.vertices.size())) {
+        if(progress) progress->stage = LoadProgress::GENERATING_NORMALS;
+        char timeBuffer[64];
+        chrono::steady_clock::time_point normalStart = chrono::steady_clock::now();
+        object.oInfo.creaseAngle = lInfo.creaseAngle;
+        object.oInfo.useSmoothingGroups = lInfo.useSmoothingGroups;
+        object.produceVertexNormals(static_cast<NormalGenerator::Weighting>(lInfo.normalWeighting));
+        double normalTime = chrono::duration<double, milli>(chrono::steady_clock::now() - normalStart).count();
+        snprintf(timeBuffer, sizeof(timeBuffer), "%.2f ms", normalTime);
+        string weightingName = lInfo.normalWeighting == NormalGenerator::ANGLE_WEIGHTED ? "angle" : "area";
+        outputString += "\tGenerated vertex normals (" + weightingName + " weighted) in " + string(timeBuffer) + "\n";
+        if(object.oInfo.nSplitVertices > 0) {
+            outputString += "\tSplit " + to_string(object.oInfo.nSplitVertices) + " vertices along hard edges\n";
+        }
+    }
+    if(isCancelled(progress)) return false;
+    object.oInfo.generateLods = lInfo.generateLods;
+    if(lInfo.generateLods) {
+        if(progress) progress->stage = LoadProgress::BUILDING_LODS;
+        char timeBuffer[64];
+        chrono::steady_clock::time_point lodStart = chrono::steady_clock::now();
+        object.buildLods();
+        double lodTime = chrono::duration<double, milli>(chrono::steady_clock::now() - lodStart).count();
+        if(object.getLodCount() > 1) {
+            snprintf(timeBuffer, sizeof(timeBuffer), "%.2f ms", lodTime);
+            outputString += "\tGenerated " + to_string(object.getLodCount() - 1) + " levels of detail in " + string(timeBuffer) + ", triangles:";
+            for(size_t lod = 0; lod < object.getLodCount(); lod++) outputString += " " + to_string(object.getTriangleCount(lod));
+            outputString += "\n";
+        }
+    }
+    object.computeBounds();
+    object.buildMeshBVH();
+    if(progress) progress->stage = LoadProgress::DONE;
+    return true;
+}
+
+/**
+ * Function for checking if an object from the mesh cache was finished
+ * with the same settings as the loader would finish it with now. The
+ * normal settings only matter if the normals were generated.
+ * 
+ * @param object: The object from the mesh cache.
+ * @param lInfo: The loader settings.
+ * 
+ * @return True if the object can be used as it is.
+ */
+bool Loader::matchesSettings(const Object &object, const LoaderInfo &lInfo)
+{
+    const Object::ObjectInfo &oInfo = object.oInfo;
+    if(oInfo.meshOptimized != lInfo.optimizeMeshes || oInfo.generateLods != lInfo.generateLods) return false;
+    if(!oInfo.normalsGenerated) return true;
+    return oInfo.normalWeighting == lInfo.normalWeighting && oInfo.creaseAngle == lInfo.creaseAngle &&
+           oInfo.useSmoothingGroups == lInfo.useSmoothingGroups;
+}
+
+/**
+ * Function for checking if a load has been cancelled, in which case it is
+ * written to the output.
+ * 
+ * @param progress: The progress of the load, or null if it can not be cancelled.
+ * 
+ * @return True if the load should stop.
+ */
+bool Loader::isCancelled(const LoadProgress *progress)
+{
+    if(!progress || !progress->cancelled) return false;
+    outputString += "\tCancelled\n";
+    return true;
+}
+
 /**
  * Normalizes all the shapes coordinates to fit inside the NDC cube.
  * This will change the vertexCoords value in the loader class.
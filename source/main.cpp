@@ -28,8 +28,115 @@
 
 Studio3D* glfwCallbackManager::app = nullptr;
 
+/**
+ * Without arguments the studio is opened in a window. With --headless
+ * the object files that follow are rendered to PNG files instead:
+ * 
+ *      3d_studio.exe --headless [options] file.obj...
+ * 
+ *      --out dir                 Existing directory to write the images to.
+ *      --target n                Least number of models per second, 0 for none.
+ *      --jobs n                  Objects loaded at the same time, 0 for one per core.
+ *      --no-cache                Always parse the object files.
+ *      --golden dir              Compare the images to the golden images in dir.
+ *      --allow-missing-golden    Do not fail images that have no golden image.
+ *      --tolerance f             Largest fraction of pixels that may differ.
+ *      --history file            Compare to and add to the CSV history file.
+ *      --max-slowdown f          How much slower than earlier runs, 0.2 is 20%.
+ * 
+ * The exit status is 1 if any file could not be rendered, 3 if an
+ * image or a measurement has regressed or an image has no golden
+ * image, and 2 if fewer models than the target were rendered each
+ * second.
+ * 
+ * With --check-resources the files are loaded into the scene and the
+ * scene is cleared again, and the exit status is 1 if any buffer,
+ * vertex array or texture was not freed, or if moving an object copied
+ * it. Image files are put as textures on the object before them:
+ * 
+ *      3d_studio.exe --check-resources file.obj [texture.bmp] ...
+ * 
+ * With --bench-gui the time it takes to build the gui with every window
+ * open is measured with each object file loaded alone:
+ * 
+ *      3d_studio.exe --bench-gui [--frames n] small.obj large.obj
+ * 
+ * With --bench-instances the time it takes to draw 1 and 1,000 instances
+ * of the object is measured in a hidden window:
+ * 
+ *      3d_studio.exe --bench-instances [--frames n] file.obj
+ * 
+ * With --measure-idle the cpu usage of the studio is measured while
+ * nothing happens, both when it redraws on demand and every frame:
+ * 
+ *      3d_studio.exe --measure-idle [--duration s] [file.obj...]
+ */
 int main(int argc, char **argv)
 {
+    bool headless = false;
+    bool checkResources = false;
+    bool benchGui = false;
+    bool benchInstances = false;
+    bool measureIdle = false;
+    int nFrames = 300;
+    double duration = 10.0;
+    Renderer::HeadlessInfo hInfo;
+    vector<string> objFiles;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless") headless = true;
+        else if (arg == "--check-resources") checkResources = true;
+        else if (arg == "--bench-gui") benchGui = true;
+        else if (arg == "--bench-instances") benchInstances = true;
+        else if (arg == "--measure-idle") measureIdle = true;
+        else if (arg == "--frames" && hasValue) nFrames = atoi(argv[++i]);
+        else if (arg == "--duration" && hasValue) duration = atof(argv[++i]);
+        else if (arg == "--no-cache") hInfo.useMeshCache = false;
+        else if (arg == "--out" && hasValue) hInfo.outputDir = argv[++i];
+        else if (arg == "--target" && hasValue) hInfo.targetModelsPerSecond = atof(argv[++i]);
+        else if (arg == "--jobs" && hasValue) hInfo.maxLoads = atoi(argv[++i]);
+        else if (arg == "--golden" && hasValue) hInfo.goldenDir = argv[++i];
+        else if (arg == "--allow-missing-golden") hInfo.allowMissingGolden = true;
+        else if (arg == "--tolerance" && hasValue) hInfo.imageTolerance = atof(argv[++i]);
+        else if (arg == "--history" && hasValue) hInfo.historyFile = argv[++i];
+        else if (arg == "--max-slowdown" && hasValue) hInfo.maxSlowdown = atof(argv[++i]);
+        else objFiles.push_back(arg);
+    }
+
+    if (checkResources) {
+        Renderer app("3D Studio", 1024, 768, true);
+        app.initialize();
+        return app.checkResources(objFiles);
+    }
+
+    if (benchGui) {
+        Renderer app("3D Studio", 1024, 768);
+        glfwCallbackManager::initCallbacks(&app);
+        app.initialize();
+        return app.benchmarkGui(objFiles, nFrames);
+    }
+
+    if (measureIdle) {
+        Renderer app("3D Studio", 1024, 768);
+        glfwCallbackManager::initCallbacks(&app);
+        app.initialize();
+        return app.measureIdle(objFiles, duration);
+    }
+
+    if (benchInstances) {
+        if (objFiles.empty()) return 1;
+        Renderer app("3D Studio", 1024, 768, true);
+        app.initialize();
+        return app.benchmarkInstances(objFiles[0], nFrames);
+    }
+
+    if (headless) {
+        Renderer app("3D Studio", 1024, 768, true);
+        app.initialize();
+        return app.renderToFiles(objFiles, hInfo);
+    }
+
     Renderer app("3D Studio", 1024, 768);
     glfwCallbackManager::initCallbacks(&app);
     app.initialize();
@@ -0,0 +1,344 @@
+#include "meshbvh.h"
+#include <algorithm>
+#include <limits>
+
+/**
+ * This class is a bounding volume hierarchy over the triangles of a
+ * single mesh, in the coordinates of the object.
+ */
+
+namespace
+{
+    /**
+     * Function for intersecting a ray with a box using the slab method.
+     *
+     * @param origin: The origin of the ray.
+     * @param invDirection: One divided by each component of the ray direction.
+     * @param min: The smallest corner of the box.
+     * @param max: The largest corner of the box.
+     * @param tMax: Hits further away than this are ignored.
+     * @param t: Set to the distance where the ray enters the box.
+     *
+     * @return True if the ray hits the box between its origin and tMax.
+     */
+    bool rayBox(const glm::vec3 &origin, const glm::vec3 &invDirection, const glm::vec3 &min, const glm::vec3 &max, float tMax, float &t)
+    {
+        glm::vec3 t0 = (min - origin)*invDirection;
+        glm::vec3 t1 = (max - origin)*invDirection;
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tLarge = glm::max(t0, t1);
+        float tNear = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, 0.0f));
+        float tFar = std::min(std::min(tLarge.x, tLarge.y), std::min(tLarge.z, tMax));
+        t = tNear;
+        return tNear <= tFar;
+    }
+
+    /**
+     * Function for calculating the surface area of a box.
+     */
+    float surfaceArea(const glm::vec3 &min, const glm::vec3 &max)
+    {
+        glm::vec3 d = max - min;
+        return 2.0f*(d.x*d.y + d.y*d.z + d.z*d.x);
+    }
+}
+
+/**
+ * Function for removing all triangles and nodes.
+ */
+void MeshBVH::clear()
+{
+    triangles.clear();
+    centroids.clear();
+    nodes.clear();
+}
+
+/**
+ * Function for adding the triangles of a group of faces to the tree.
+ * The tree must be built again after triangles have been added.
+ *
+ * @param vertices: The vertices of the mesh.
+ * @param indices: Three indices for each triangle.
+ */
+void MeshBVH::addTriangles(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+{
+    for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3 &a = vertices[indices[i]].position;
+        const glm::vec3 &b = vertices[indices[i + 1]].position;
+        const glm::vec3 &c = vertices[indices[i + 2]].position;
+        Triangle triangle = { a, b - a, c - a };
+        triangles.push_back(triangle);
+        centroids.push_back((a + b + c)/3.0f);
+    }
+}
+
+/**
+ * Function for building the tree from the added triangles. The
+ * triangles are reordered so that every leaf holds a range of them.
+ */
+void MeshBVH::build()
+{
+    nodes.clear();
+    if(triangles.empty()) return;
+
+    nodes.reserve(2*triangles.size()/MAX_LEAF_SIZE + 1);
+    Node root;
+    root.first = 0;
+    root.count = static_cast<unsigned int>(triangles.size());
+    updateNodeBounds(root);
+    nodes.push_back(root);
+
+    // Pairs of node index and depth.
+    vector<pair<unsigned int, unsigned int>> stack(1, make_pair(0u, 0u));
+    while(!stack.empty()) {
+        unsigned int nodeIndex = stack.back().first;
+        unsigned int depth = stack.back().second;
+        stack.pop_back();
+        Node node = nodes[nodeIndex];
+
+        int axis;
+        float position;
+        if(node.count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH || !findSplit(node, axis, position)) continue;
+
+        // Partition the triangles of the node around the split.
+        unsigned int i = node.first;
+        unsigned int j = node.first + node.count;
+        while(i < j) {
+            if(centroids[i][axis] < position) {
+                i++;
+            } else {
+                j--;
+                swap(triangles[i], triangles[j]);
+                swap(centroids[i], centroids[j]);
+            }
+        }
+        unsigned int leftCount = i - node.first;
+        if(leftCount == 0 || leftCount == node.count) continue;
+
+        Node left, right;
+        left.first = node.first;
+        left.count = leftCount;
+        right.first = i;
+        right.count = node.count - leftCount;
+        updateNodeBounds(left);
+        updateNodeBounds(right);
+
+        unsigned int leftIndex = static_cast<unsigned int>(nodes.size());
+        nodes.push_back(left);
+        nodes.push_back(right);
+        nodes[nodeIndex].first = leftIndex;
+        nodes[nodeIndex].count = 0;
+        stack.push_back(make_pair(leftIndex, depth + 1));
+        stack.push_back(make_pair(leftIndex + 1, depth + 1));
+    }
+}
+
+/**
+ * Function for setting the tree from the arrays of a tree that was
+ * built before. The tree is checked first, so that a ray test never
+ * reads outside the arrays or deeper than its stack.
+ *
+ * @param newTriangles: The triangles, in the order of the leaves.
+ * @param nTriangles: The number of triangles.
+ * @param newNodes: The nodes, with the root first.
+ * @param nNodes: The number of nodes.
+ *
+ * @return False if the arrays are not a valid tree, in which case the tree is left empty.
+ */
+bool MeshBVH::setTree(const Triangle *newTriangles, size_t nTriangles, const Node *newNodes, size_t nNodes)
+{
+    clear();
+    // The children of a node always come after it, which also rules out cycles.
+    vector<unsigned int> depths(nNodes, 0);
+    for(size_t n = 0; n < nNodes; n++) {
+        const Node &node = newNodes[n];
+        if(node.count > 0) {
+            if(node.first > nTriangles || node.count > nTriangles - node.first) return false;
+            continue;
+        }
+        if(node.first <= n || node.first >= nNodes - 1 || depths[n] >= MAX_DEPTH) return false;
+        depths[node.first] = std::max(depths[node.first], depths[n] + 1);
+        depths[node.first + 1] = std::max(depths[node.first + 1], depths[n] + 1);
+    }
+
+    triangles.assign(newTriangles, newTriangles + nTriangles);
+    nodes.assign(newNodes, newNodes + nNodes);
+    return true;
+}
+
+/**
+ * Function for finding the closest point where a ray hits the mesh.
+ * The closer child of every node is visited first, and nodes further
+ * away than the closest hit so far are skipped.
+ *
+ * @param origin: The origin of the ray.
+ * @param direction: The direction of the ray.
+ * @param t: The furthest distance to look at. Set to the distance of the hit, if any.
+ *
+ * @return True if the ray hits the mesh closer than t.
+ */
+bool MeshBVH::intersect(const glm::vec3 &origin, const glm::vec3 &direction, float &t) const
+{
+    if(nodes.empty()) return false;
+
+    glm::vec3 invDirection = 1.0f/direction;
+    float closest = t;
+    bool hit = false;
+    float tNode;
+    if(!rayBox(origin, invDirection, nodes[0].min, nodes[0].max, closest, tNode)) return false;
+
+    unsigned int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        const Node &node = nodes[stack[--stackSize]];
+        if(node.count > 0) {
+            for(unsigned int i = node.first; i < node.first + node.count; i++) {
+                float tTriangle;
+                if(intersectTriangle(triangles[i], origin, direction, tTriangle) && tTriangle < closest) {
+                    closest = tTriangle;
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        float tLeft, tRight;
+        bool hitLeft = rayBox(origin, invDirection, nodes[node.first].min, nodes[node.first].max, closest, tLeft);
+        bool hitRight = rayBox(origin, invDirection, nodes[node.first + 1].min, nodes[node.first + 1].max, closest, tRight);
+        // Push the further child first so the closer one is visited next.
+        if(hitLeft && hitRight) {
+            bool leftFirst = tLeft <= tRight;
+            stack[stackSize++] = leftFirst ? node.first + 1 : node.first;
+            stack[stackSize++] = leftFirst ? node.first : node.first + 1;
+        } else if(hitLeft) {
+            stack[stackSize++] = node.first;
+        } else if(hitRight) {
+            stack[stackSize++] = node.first + 1;
+        }
+    }
+
+    if(hit) t = closest;
+    return hit;
+}
+
+/**
+ * Function for computing the box of a node from its triangles.
+ *
+ * @param node: The node to update.
+ */
+void MeshBVH::updateNodeBounds(Node &node) const
+{
+    node.min = glm::vec3(numeric_limits<float>::max());
+    node.max = glm::vec3(-numeric_limits<float>::max());
+    for(unsigned int i = node.first; i < node.first + node.count; i++) {
+        const Triangle &triangle = triangles[i];
+        glm::vec3 b = triangle.v0 + triangle.edge1;
+        glm::vec3 c = triangle.v0 + triangle.edge2;
+        node.min = glm::min(node.min, glm::min(triangle.v0, glm::min(b, c)));
+        node.max = glm::max(node.max, glm::max(triangle.v0, glm::max(b, c)));
+    }
+}
+
+/**
+ * Function for finding the cheapest split of a node with the surface
+ * area heuristic, evaluated between bins of triangle centroids.
+ *
+ * @param node: The node to split.
+ * @param axis: Set to the axis of the best split.
+ * @param position: Set to the position of the best split along the axis.
+ *
+ * @return False if no split is cheaper than keeping the node as a leaf.
+ */
+bool MeshBVH::findSplit(const Node &node, int &axis, float &position) const
+{
+    struct Bin {
+        glm::vec3 min = glm::vec3(numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-numeric_limits<float>::max());
+        unsigned int count = 0;
+    };
+
+    glm::vec3 centroidMin = glm::vec3(numeric_limits<float>::max());
+    glm::vec3 centroidMax = glm::vec3(-numeric_limits<float>::max());
+    for(unsigned int i = node.first; i < node.first + node.count; i++) {
+        centroidMin = glm::min(centroidMin, centroids[i]);
+        centroidMax = glm::max(centroidMax, centroids[i]);
+    }
+
+    float bestCost = node.count*surfaceArea(node.min, node.max);
+    bool found = false;
+    for(int a = 0; a < 3; a++) {
+        float extent = centroidMax[a] - centroidMin[a];
+        if(extent <= 0.0f) continue;
+
+        Bin bins[SAH_BINS];
+        float scale = SAH_BINS/extent;
+        for(unsigned int i = node.first; i < node.first + node.count; i++) {
+            const Triangle &triangle = triangles[i];
+            int b = std::min(SAH_BINS - 1, static_cast<int>((centroids[i][a] - centroidMin[a])*scale));
+            glm::vec3 v1 = triangle.v0 + triangle.edge1;
+            glm::vec3 v2 = triangle.v0 + triangle.edge2;
+            bins[b].count++;
+            bins[b].min = glm::min(bins[b].min, glm::min(triangle.v0, glm::min(v1, v2)));
+            bins[b].max = glm::max(bins[b].max, glm::max(triangle.v0, glm::max(v1, v2)));
+        }
+
+        float rightArea[SAH_BINS - 1];
+        unsigned int rightCount[SAH_BINS - 1];
+        Bin right;
+        for(int b = SAH_BINS - 1; b > 0; b--) {
+            right.count += bins[b].count;
+            right.min = glm::min(right.min, bins[b].min);
+            right.max = glm::max(right.max, bins[b].max);
+            rightCount[b - 1] = right.count;
+            rightArea[b - 1] = right.count > 0 ? surfaceArea(right.min, right.max) : 0.0f;
+        }
+
+        Bin left;
+        for(int b = 0; b < SAH_BINS - 1; b++) {
+            left.count += bins[b].count;
+            left.min = glm::min(left.min, bins[b].min);
+            left.max = glm::max(left.max, bins[b].max);
+            if(left.count == 0 || rightCount[b] == 0) continue;
+            float cost = left.count*surfaceArea(left.min, left.max) + rightCount[b]*rightArea[b];
+            if(cost < bestCost) {
+                bestCost = cost;
+                axis = a;
+                position = centroidMin[a] + (b + 1)/scale;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * Function for intersecting a ray with a triangle, using the method of
+ * Möller and Trumbore. Both sides of the triangle can be hit.
+ *
+ * @param triangle: The triangle.
+ * @param origin: The origin of the ray.
+ * @param direction: The direction of the ray.
+ * @param t: Set to the distance of the hit.
+ *
+ * @return True if the ray hits the triangle in front of its origin.
+ */
+bool MeshBVH::intersectTriangle(const Triangle &triangle, const glm::vec3 &origin, const glm::vec3 &direction, float &t) const
+{
+    const float epsilon = 1e-8f;
+    glm::vec3 p = glm::cross(direction, triangle.edge2);
+    float determinant = glm::dot(triangle.edge1, p);
+    if(determinant > -epsilon && determinant < epsilon) return false;
+
+    float invDeterminant = 1.0f/determinant;
+    glm::vec3 s = origin - triangle.v0;
+    float u = glm::dot(s, p)*invDeterminant;
+    if(u < 0.0f || u > 1.0f) return false;
+
+    glm::vec3 q = glm::cross(s, triangle.edge1);
+    float v = glm::dot(direction, q)*invDeterminant;
+    if(v < 0.0f || u + v > 1.0f) return false;
+
+    t = glm::dot(triangle.edge2, q)*invDeterminant;
+    return t > 0.0f;
+}
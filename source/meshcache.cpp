@@ -0,0 +1,553 @@
+#include "meshcache.h"
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef WINDOWS_BUILD
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/**
+ * This class handles the binary mesh cache of the program. When an
+ * object has been loaded, the final vertices and the material groups
+ * of the object are written to a flat little-endian file, together
+ * with its levels of detail and its triangle tree. The next time the
+ * same object file is loaded the cache file is memory mapped and
+ * copied straight into the object.
+ */
+
+namespace
+{
+    const char CACHE_MAGIC[8] = { 'S', '3', 'D', 'M', 'E', 'S', 'H', '\0' };
+
+    // Flags stored in the header of the cache file.
+    const uint32_t FLAG_HAS_MATERIALS = 1 << 0;
+    const uint32_t FLAG_DEFAULT_MAT = 1 << 1;
+    const uint32_t FLAG_OPTIMIZED = 1 << 2;
+    const uint32_t FLAG_NORMALS_GENERATED = 1 << 3;
+    const uint32_t FLAG_USE_GROUPS = 1 << 4;
+    const uint32_t FLAG_HAS_GROUPS = 1 << 5;
+    const uint32_t FLAG_GENERATE_LODS = 1 << 6;
+
+    bool isLittleEndian()
+    {
+        uint16_t value = 1;
+        unsigned char firstByte;
+        memcpy(&firstByte, &value, 1);
+        return firstByte == 1;
+    }
+
+    template<typename T>
+    void putValue(vector<unsigned char> &buffer, T value)
+    {
+        size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        memcpy(&buffer[offset], &value, sizeof(T));
+    }
+
+    void putBytes(vector<unsigned char> &buffer, const void *data, size_t size)
+    {
+        size_t offset = buffer.size();
+        buffer.resize(offset + size);
+        if(size != 0) memcpy(&buffer[offset], data, size);
+    }
+
+    void putString(vector<unsigned char> &buffer, const string &str)
+    {
+        putValue<uint32_t>(buffer, static_cast<uint32_t>(str.size()));
+        putBytes(buffer, str.data(), str.size());
+    }
+
+    void alignTo(vector<unsigned char> &buffer, size_t alignment)
+    {
+        while(buffer.size() % alignment != 0) buffer.push_back(0);
+    }
+
+    /**
+     * Function for checking that every index of a range is below the
+     * number of vertices, and that the range holds whole triangles.
+     */
+    bool validIndices(const uint32_t *indices, uint64_t count, uint32_t vertexCount)
+    {
+        if(count % 3 != 0) return false;
+        for(uint64_t i = 0; i < count; i++) {
+            if(indices[i] >= vertexCount) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Small cursor for reading values from the mapped cache file. Every
+     * read is bounds checked so a truncated or corrupt cache file is
+     * rejected instead of read past its end.
+     */
+    struct Reader {
+        const unsigned char *data;
+        size_t size;
+        size_t pos;
+
+        template<typename T>
+        bool get(T &value)
+        {
+            if(size - pos < sizeof(T)) return false;
+            memcpy(&value, data + pos, sizeof(T));
+            pos += sizeof(T);
+            return true;
+        }
+
+        template<typename T>
+        bool getArray(vector<T> &values, uint32_t count)
+        {
+            if((size - pos)/sizeof(T) < count) return false;
+            values.resize(count);
+            if(count != 0) memcpy(values.data(), data + pos, count*sizeof(T));
+            pos += count*sizeof(T);
+            return true;
+        }
+
+        bool getString(string &str)
+        {
+            uint32_t length;
+            if(!get(length) || size - pos < length) return false;
+            str.assign(reinterpret_cast<const char*>(data + pos), length);
+            pos += length;
+            return true;
+        }
+    };
+
+    // Size of a single face record in the cache file.
+    const size_t FACE_RECORD_SIZE = sizeof(int32_t) + 9*sizeof(float) + sizeof(uint32_t);
+}
+
+/**
+ * Constructor of the mesh cache.
+ *
+ * @param cacheDir: The directory where the cache files are stored.
+ */
+MeshCache::MeshCache(string cacheDir)
+{
+    MeshCache::cacheDir = cacheDir;
+}
+
+/**
+ * Function for getting the path of the cache file that belongs to
+ * an object file. The name of the cache file is a hash of the path
+ * of the object file.
+ *
+ * @param objFile: The path to the object file.
+ *
+ * @return The path to the cache file.
+ */
+string MeshCache::getCacheFile(string objFile) const
+{
+    // 64-bit FNV-1a hash of the path.
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c : objFile) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return cacheDir + "/" + name + ".s3dmesh";
+}
+
+/**
+ * Function for reading the size and modification time of a file. If
+ * the file does not exist the stamp will be zeroed, which makes it
+ * possible to detect when a missing material file is later created.
+ *
+ * @param path: The path to the file.
+ * @param stamp: The stamp to be filled.
+ *
+ * @return True if the file exists.
+ */
+bool MeshCache::readStamp(string path, FileStamp &stamp) const
+{
+    struct stat fileStat;
+    stamp.path = path;
+    stamp.size = 0;
+    stamp.mtime = 0;
+    if(stat(path.c_str(), &fileStat) != 0) return false;
+    stamp.size = static_cast<uint64_t>(fileStat.st_size);
+    stamp.mtime = static_cast<int64_t>(fileStat.st_mtime);
+    return true;
+}
+
+/**
+ * Function for finding all material files that an object file
+ * refers to with "mtllib". The material files are searched for in
+ * the same directory as the object file, just like the loader does.
+ *
+ * @param objFile: The path to the object file.
+ *
+ * @return The paths to the material files.
+ */
+vector<string> MeshCache::findMaterialLibs(string objFile) const
+{
+    vector<string> mtlFiles;
+    string directory = "";
+    size_t slash = objFile.find_last_of("/\\");
+    if(slash != string::npos) directory = objFile.substr(0, slash + 1);
+
+    ifstream fs(objFile);
+    string line;
+    while(getline(fs, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if(start == string::npos || line.compare(start, 6, "mtllib") != 0) continue;
+
+        istringstream names(line.substr(start + 6));
+        string name;
+        while(names >> name) mtlFiles.push_back(directory + name);
+    }
+    return mtlFiles;
+}
+
+/**
+ * Function for loading an object from its cache file. The cache file
+ * is memory mapped and, if it is still valid for the object file, its
+ * vertices, faces, levels of detail and triangle tree are copied into
+ * the object. The loader must check that the settings in the object
+ * info are the ones it would have loaded the object with.
+ *
+ * @param objFile: The path to the object file.
+ * @param object: The object to be filled with the cached data.
+ *
+ * @return True if the object was loaded from the cache.
+ */
+bool MeshCache::load(string objFile, Object &object)
+{
+    if(!isLittleEndian()) return false;
+
+    string cacheFile = getCacheFile(objFile);
+    bool loaded = false;
+
+#ifdef WINDOWS_BUILD
+    ifstream fs(cacheFile, ios::in | ios::binary);
+    if(!fs) return false;
+    vector<unsigned char> data((istreambuf_iterator<char>(fs)), istreambuf_iterator<char>());
+    if(!data.empty()) loaded = validate(data.data(), data.size(), objFile, object);
+#else
+    int fd = open(cacheFile.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(fileStat.st_size);
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) return false;
+
+    loaded = validate(static_cast<const unsigned char*>(data), size, objFile, object);
+    munmap(data, size);
+#endif
+
+    return loaded;
+}
+
+/**
+ * Function for validating a mapped cache file against the current
+ * state of the object file and its material files. If the cache file
+ * is valid, the object will be filled with the cached data.
+ *
+ * @param data: The contents of the cache file.
+ * @param size: The size of the cache file.
+ * @param objFile: The path to the object file.
+ * @param object: The object to be filled with the cached data.
+ *
+ * @return True if the cache file was valid.
+ */
+bool MeshCache::validate(const unsigned char *data, size_t size, string objFile, Object &object) const
+{
+    Reader reader = { data, size, 0 };
+
+    char magic[8];
+    uint32_t version, vertexSize, nStamps, flags;
+    uint32_t vertexCount, faceCount, indexCount, lodCount, lodIndexCount, baseVertexCount, bvhTriangleCount, bvhNodeCount;
+    uint32_t nLodTriangles;
+    uint64_t vertexOffset;
+    int32_t nShapes, nVertices, nUnweldedVertices, nFaces, nIndices, nVertexNormals, nTexCoords;
+    int32_t normalWeighting, nSplitVertices;
+    float creaseAngle;
+    vector<float> lodErrors;
+    vector<int32_t> lodTriangles;
+    MeshOptimizer::VertexCacheStats statsBefore, stats;
+    string path;
+
+    for(size_t i = 0; i < sizeof(magic); i++) {
+        if(!reader.get(magic[i])) return false;
+    }
+    if(memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0) return false;
+    if(!reader.get(version) || version != CACHE_VERSION) return false;
+    if(!reader.get(vertexSize) || vertexSize != sizeof(Vertex)) return false;
+
+    // Check that the object file and material files are unchanged.
+    if(!reader.getString(path) || path != objFile) return false;
+    if(!reader.get(nStamps)) return false;
+    for(uint32_t s = 0; s < nStamps + 1; s++) {
+        FileStamp cached, current;
+        if(s == 0) {
+            cached.path = objFile;
+        } else if(!reader.getString(cached.path)) {
+            return false;
+        }
+        if(!reader.get(cached.size) || !reader.get(cached.mtime)) return false;
+        readStamp(cached.path, current);
+        if(current.size != cached.size || current.mtime != cached.mtime) return false;
+    }
+
+    if(!reader.get(flags) || !reader.get(nShapes) || !reader.get(nVertices) ||
+       !reader.get(nUnweldedVertices) || !reader.get(nFaces) || !reader.get(nIndices) || !reader.get(nVertexNormals) ||
+       !reader.get(nTexCoords)) return false;
+    if(!reader.get(statsBefore.acmr) || !reader.get(statsBefore.atvr) ||
+       !reader.get(stats.acmr) || !reader.get(stats.atvr)) return false;
+    if(!reader.get(normalWeighting) || !reader.get(creaseAngle) || !reader.get(nSplitVertices)) return false;
+    if(!reader.get(lodCount) || !reader.getArray(lodErrors, lodCount)) return false;
+    if(!reader.get(nLodTriangles) || !reader.getArray(lodTriangles, nLodTriangles)) return false;
+    if(!reader.get(vertexCount) || !reader.get(faceCount) || !reader.get(indexCount) || !reader.get(lodIndexCount) ||
+       !reader.get(baseVertexCount) || !reader.get(bvhTriangleCount) || !reader.get(bvhNodeCount)) return false;
+    if(!reader.get(vertexOffset)) return false;
+    if(baseVertexCount != 0 && baseVertexCount != vertexCount) return false;
+
+    // Check that all sections fit inside the cache file.
+    uint64_t faceOffset = vertexOffset + uint64_t(vertexCount)*sizeof(Vertex);
+    uint64_t indexOffset = faceOffset + uint64_t(faceCount)*FACE_RECORD_SIZE;
+    uint64_t groupOffset = indexOffset + uint64_t(indexCount)*sizeof(uint32_t);
+    uint64_t lodCountOffset = groupOffset + uint64_t(indexCount/3)*sizeof(uint32_t);
+    uint64_t lodIndexOffset = lodCountOffset + uint64_t(faceCount)*lodCount*sizeof(uint32_t);
+    uint64_t baseVertexOffset = lodIndexOffset + uint64_t(lodIndexCount)*sizeof(uint32_t);
+    uint64_t bvhTriangleOffset = baseVertexOffset + uint64_t(baseVertexCount)*sizeof(uint32_t);
+    uint64_t bvhNodeOffset = bvhTriangleOffset + uint64_t(bvhTriangleCount)*sizeof(MeshBVH::Triangle);
+    uint64_t endOffset = bvhNodeOffset + uint64_t(bvhNodeCount)*sizeof(MeshBVH::Node);
+    if(vertexOffset % 8 != 0 || vertexOffset < reader.pos || endOffset > size) return false;
+
+    const Vertex *vertices = reinterpret_cast<const Vertex*>(data + vertexOffset);
+    object.vertices.assign(vertices, vertices + vertexCount);
+
+    Reader faceReader = { data, size, static_cast<size_t>(faceOffset) };
+    const uint32_t *indices = reinterpret_cast<const uint32_t*>(data + indexOffset);
+    const uint32_t *groups = reinterpret_cast<const uint32_t*>(data + groupOffset);
+    uint64_t indexStart = 0;
+    uint64_t groupStart = 0;
+    object.faces.clear();
+    object.faces.reserve(faceCount);
+    for(uint32_t f = 0; f < faceCount; f++) {
+        Object::Face face;
+        int32_t materialIndex;
+        uint32_t faceIndexCount;
+        if(!faceReader.get(materialIndex) || !faceReader.get(face.mInfo.ka) || !faceReader.get(face.mInfo.kd) ||
+           !faceReader.get(face.mInfo.ks) || !faceReader.get(faceIndexCount)) return false;
+        // An index past the vertices would be read out of bounds by everything that uses the object.
+        if(indexStart + faceIndexCount > indexCount || !validIndices(indices + indexStart, faceIndexCount, vertexCount)) return false;
+
+        face.materialIndex = materialIndex;
+        face.indices.assign(indices + indexStart, indices + indexStart + faceIndexCount);
+        face.smoothingGroups.assign(groups + groupStart, groups + groupStart + faceIndexCount/3);
+        indexStart += faceIndexCount;
+        groupStart += faceIndexCount/3;
+        object.faces.push_back(face);
+    }
+
+    const uint32_t *lodIndexCounts = reinterpret_cast<const uint32_t*>(data + lodCountOffset);
+    const uint32_t *lodIndices = reinterpret_cast<const uint32_t*>(data + lodIndexOffset);
+    uint64_t lodStart = 0;
+    for(uint32_t lod = 0; lod < lodCount; lod++) {
+        for(uint32_t f = 0; f < faceCount; f++) {
+            uint32_t faceLodCount = lodIndexCounts[uint64_t(lod)*faceCount + f];
+            if(lodStart + faceLodCount > lodIndexCount || !validIndices(lodIndices + lodStart, faceLodCount, vertexCount)) return false;
+            object.faces[f].lodIndices.push_back(vector<unsigned int>(lodIndices + lodStart, lodIndices + lodStart + faceLodCount));
+            lodStart += faceLodCount;
+        }
+    }
+
+    const uint32_t *baseVertices = reinterpret_cast<const uint32_t*>(data + baseVertexOffset);
+    for(uint32_t v = 0; v < baseVertexCount; v++) {
+        if(baseVertices[v] >= vertexCount) return false;
+    }
+    const MeshBVH::Triangle *bvhTriangles = reinterpret_cast<const MeshBVH::Triangle*>(data + bvhTriangleOffset);
+    const MeshBVH::Node *bvhNodes = reinterpret_cast<const MeshBVH::Node*>(data + bvhNodeOffset);
+    if(!object.meshBVH.setTree(bvhTriangles, bvhTriangleCount, bvhNodes, bvhNodeCount)) return false;
+
+    object.oInfo.nShapes = static_cast<size_t>(nShapes);
+    object.oInfo.nVertices = nVertices;
+    object.oInfo.nUnweldedVertices = nUnweldedVertices;
+    object.oInfo.nFaces = nFaces;
+    object.oInfo.nIndices = nIndices;
+    object.oInfo.nVertexNormals = nVertexNormals;
+    object.oInfo.nTexCoords = nTexCoords;
+    object.oInfo.hasMaterials = (flags & FLAG_HAS_MATERIALS) != 0;
+    object.oInfo.useDefaultMat = (flags & FLAG_DEFAULT_MAT) != 0;
+    object.oInfo.meshOptimized = (flags & FLAG_OPTIMIZED) != 0;
+    object.oInfo.cacheStatsBefore = statsBefore;
+    object.oInfo.cacheStats = stats;
+    object.oInfo.normalsGenerated = (flags & FLAG_NORMALS_GENERATED) != 0;
+    object.oInfo.normalWeighting = normalWeighting;
+    object.oInfo.creaseAngle = creaseAngle;
+    object.oInfo.useSmoothingGroups = (flags & FLAG_USE_GROUPS) != 0;
+    object.oInfo.hasSmoothingGroups = (flags & FLAG_HAS_GROUPS) != 0;
+    object.oInfo.nSplitVertices = nSplitVertices;
+    object.oInfo.generateLods = (flags & FLAG_GENERATE_LODS) != 0;
+    object.oInfo.lodErrors = lodErrors;
+    object.oInfo.lodTriangles.assign(lodTriangles.begin(), lodTriangles.end());
+    object.setBaseVertexIndices(vector<unsigned int>(baseVertices, baseVertices + baseVertexCount));
+    return true;
+}
+
+/**
+ * Function for writing the cache file of an object. The file is first
+ * written to a temporary file which is then renamed, so that a partly
+ * written cache file is never read by the loader. The temporary file is
+ * named after the thread, since several objects can load at once.
+ *
+ * @param objFile: The path to the object file.
+ * @param object: The finished object to be stored in the cache.
+ *
+ * @return True if the cache file was written.
+ */
+bool MeshCache::store(string objFile, const Object &object)
+{
+    if(!isLittleEndian()) return false;
+
+    FileStamp objStamp;
+    if(!readStamp(objFile, objStamp)) return false;
+
+    vector<FileStamp> mtlStamps;
+    for(string &mtlFile : findMaterialLibs(objFile)) {
+        FileStamp stamp;
+        readStamp(mtlFile, stamp);
+        mtlStamps.push_back(stamp);
+    }
+
+    uint32_t indexCount = 0;
+    for(const Object::Face &face : object.faces) indexCount += face.indices.size();
+    uint32_t lodCount = static_cast<uint32_t>(object.getLodCount() - 1);
+    uint32_t lodIndexCount = 0;
+    for(const Object::Face &face : object.faces) {
+        for(const vector<unsigned int> &lodIndices : face.lodIndices) lodIndexCount += lodIndices.size();
+    }
+    vector<unsigned int> baseVertices = object.getBaseVertexIndices();
+    const vector<MeshBVH::Triangle> &bvhTriangles = object.meshBVH.getTriangles();
+    const vector<MeshBVH::Node> &bvhNodes = object.meshBVH.getNodes();
+
+    uint32_t flags = 0;
+    if(object.oInfo.hasMaterials) flags |= FLAG_HAS_MATERIALS;
+    if(object.oInfo.useDefaultMat) flags |= FLAG_DEFAULT_MAT;
+    if(object.oInfo.meshOptimized) flags |= FLAG_OPTIMIZED;
+    if(object.oInfo.normalsGenerated) flags |= FLAG_NORMALS_GENERATED;
+    if(object.oInfo.useSmoothingGroups) flags |= FLAG_USE_GROUPS;
+    if(object.oInfo.hasSmoothingGroups) flags |= FLAG_HAS_GROUPS;
+    if(object.oInfo.generateLods) flags |= FLAG_GENERATE_LODS;
+
+    vector<unsigned char> buffer;
+    putBytes(buffer, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    putValue<uint32_t>(buffer, CACHE_VERSION);
+    putValue<uint32_t>(buffer, sizeof(Vertex));
+    putString(buffer, objFile);
+    putValue<uint32_t>(buffer, static_cast<uint32_t>(mtlStamps.size()));
+    putValue<uint64_t>(buffer, objStamp.size);
+    putValue<int64_t>(buffer, objStamp.mtime);
+    for(FileStamp &stamp : mtlStamps) {
+        putString(buffer, stamp.path);
+        putValue<uint64_t>(buffer, stamp.size);
+        putValue<int64_t>(buffer, stamp.mtime);
+    }
+
+    putValue<uint32_t>(buffer, flags);
+    putValue<int32_t>(buffer, static_cast<int32_t>(object.oInfo.nShapes));
+    putValue<int32_t>(buffer, object.oInfo.nVertices);
+    putValue<int32_t>(buffer, object.oInfo.nUnweldedVertices);
+    putValue<int32_t>(buffer, object.oInfo.nFaces);
+    putValue<int32_t>(buffer, object.oInfo.nIndices);
+    putValue<int32_t>(buffer, object.oInfo.nVertexNormals);
+    putValue<int32_t>(buffer, object.oInfo.nTexCoords);
+    putValue<float>(buffer, object.oInfo.cacheStatsBefore.acmr);
+    putValue<float>(buffer, object.oInfo.cacheStatsBefore.atvr);
+    putValue<float>(buffer, object.oInfo.cacheStats.acmr);
+    putValue<float>(buffer, object.oInfo.cacheStats.atvr);
+    putValue<int32_t>(buffer, object.oInfo.normalWeighting);
+    putValue<float>(buffer, object.oInfo.creaseAngle);
+    putValue<int32_t>(buffer, object.oInfo.nSplitVertices);
+    putValue<uint32_t>(buffer, lodCount);
+    putBytes(buffer, object.oInfo.lodErrors.data(), lodCount*sizeof(float));
+    putValue<uint32_t>(buffer, static_cast<uint32_t>(object.oInfo.lodTriangles.size()));
+    putBytes(buffer, object.oInfo.lodTriangles.data(), object.oInfo.lodTriangles.size()*sizeof(int32_t));
+    putValue<uint32_t>(buffer, static_cast<uint32_t>(object.vertices.size()));
+    putValue<uint32_t>(buffer, static_cast<uint32_t>(object.faces.size()));
+    putValue<uint32_t>(buffer, indexCount);
+    putValue<uint32_t>(buffer, lodIndexCount);
+    putValue<uint32_t>(buffer, static_cast<uint32_t>(baseVertices.size()));
+    putValue<uint32_t>(buffer, static_cast<uint32_t>(bvhTriangles.size()));
+    putValue<uint32_t>(buffer, static_cast<uint32_t>(bvhNodes.size()));
+
+    // The vertex section starts at the next 8 byte boundary after its offset.
+    size_t offsetPos = buffer.size();
+    putValue<uint64_t>(buffer, 0);
+    alignTo(buffer, 8);
+    uint64_t vertexOffset = buffer.size();
+    memcpy(&buffer[offsetPos], &vertexOffset, sizeof(vertexOffset));
+
+    putBytes(buffer, object.vertices.data(), object.vertices.size()*sizeof(Vertex));
+    for(const Object::Face &face : object.faces) {
+        putValue<int32_t>(buffer, face.materialIndex);
+        putValue(buffer, face.mInfo.ka);
+        putValue(buffer, face.mInfo.kd);
+        putValue(buffer, face.mInfo.ks);
+        putValue<uint32_t>(buffer, static_cast<uint32_t>(face.indices.size()));
+    }
+    for(const Object::Face &face : object.faces) {
+        putBytes(buffer, face.indices.data(), face.indices.size()*sizeof(unsigned int));
+    }
+    for(const Object::Face &face : object.faces) {
+        for(size_t t = 0; t < face.indices.size()/3; t++) {
+            putValue<uint32_t>(buffer, t < face.smoothingGroups.size() ? face.smoothingGroups[t] : 0);
+        }
+    }
+    for(uint32_t lod = 0; lod < lodCount; lod++) {
+        for(const Object::Face &face : object.faces) putValue<uint32_t>(buffer, static_cast<uint32_t>(face.lodIndices[lod].size()));
+    }
+    for(uint32_t lod = 0; lod < lodCount; lod++) {
+        for(const Object::Face &face : object.faces) {
+            putBytes(buffer, face.lodIndices[lod].data(), face.lodIndices[lod].size()*sizeof(unsigned int));
+        }
+    }
+    putBytes(buffer, baseVertices.data(), baseVertices.size()*sizeof(unsigned int));
+    putBytes(buffer, bvhTriangles.data(), bvhTriangles.size()*sizeof(MeshBVH::Triangle));
+    putBytes(buffer, bvhNodes.data(), bvhNodes.size()*sizeof(MeshBVH::Node));
+
+#ifdef WINDOWS_BUILD
+    _mkdir(cacheDir.c_str());
+#else
+    mkdir(cacheDir.c_str(), 0755);
+#endif
+
+    string cacheFile = getCacheFile(objFile);
+    // Objects load on their own threads, so two loads of the same file must not share a temporary file.
+    ostringstream threadId;
+    threadId << this_thread::get_id();
+    string tmpFile = cacheFile + "." + threadId.str() + ".tmp";
+    ofstream fs(tmpFile, ios::out | ios::binary | ios::trunc);
+    if(!fs) return false;
+    fs.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    fs.close();
+    if(!fs) {
+        remove(tmpFile.c_str());
+        return false;
+    }
+
+    // Rename does not overwrite an existing file on Windows.
+    remove(cacheFile.c_str());
+    return rename(tmpFile.c_str(), cacheFile.c_str()) == 0;
+}
@@ -0,0 +1,349 @@
+#include "meshoptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * This class reorders the triangles and vertices of a mesh so that the
+ * GPU does less work when drawing it.
+ */
+
+namespace
+{
+    /**
+     * A FIFO vertex cache, like the post-transform cache of most GPUs. A
+     * vertex is in the cache if fewer than size vertices have been added
+     * after it, so nothing has to be removed when the cache is full.
+     */
+    class FifoCache
+    {
+        public:
+            FifoCache(size_t nVertices, unsigned int size) : stamps(nVertices, 0), time(size + 1), size(size) {}
+
+            /**
+             * Function for looking up a vertex and adding it if it is missing.
+             *
+             * @return True if the vertex was not in the cache.
+             */
+            bool miss(unsigned int v)
+            {
+                if(time - stamps[v] <= size) return false;
+                stamps[v] = time++;
+                return true;
+            }
+
+            /**
+             * Function for emptying the cache.
+             */
+            void flush() { time += size + 1; }
+
+        private:
+            vector<unsigned int> stamps;
+            unsigned int time;
+            unsigned int size;
+    };
+
+    /**
+     * Function for counting the cache misses of a range of triangles with
+     * an empty cache.
+     */
+    unsigned int countMisses(FifoCache &cache, const vector<unsigned int> &indices, size_t firstTriangle, size_t lastTriangle)
+    {
+        cache.flush();
+        unsigned int misses = 0;
+        for(size_t i = 3*firstTriangle; i < 3*lastTriangle; i++) misses += cache.miss(indices[i]);
+        return misses;
+    }
+}
+
+/**
+ * Function for finding an order of the triangles that uses the vertex
+ * cache well, with the method of Tom Forsyth. Every vertex is scored by
+ * its place in a simulated LRU cache and by how many triangles still use
+ * it, which makes vertices with few triangles left be finished first.
+ * The next triangle is the one with the highest total score among the
+ * triangles of the vertices in the cache, or the next triangle of the
+ * input if none of them has any triangles left.
+ *
+ * @param indices: Three vertex indices for each triangle.
+ * @param nVertices: The number of vertices in the mesh.
+ *
+ * @return The index of the old triangle at each place of the new order.
+ */
+vector<unsigned int> MeshOptimizer::vertexCacheOrder(const vector<unsigned int> &indices, size_t nVertices)
+{
+    size_t nTriangles = indices.size()/3;
+    vector<unsigned int> order;
+    order.reserve(nTriangles);
+    if(nTriangles == 0) return order;
+
+    // The triangles that use each vertex. The live triangles of vertex v are
+    // kept at the start of its range, liveTriangles[v] of them.
+    vector<unsigned int> triangleStart(nVertices + 1, 0);
+    for(size_t i = 0; i < 3*nTriangles; i++) triangleStart[indices[i] + 1]++;
+    for(size_t v = 0; v < nVertices; v++) triangleStart[v + 1] += triangleStart[v];
+    vector<unsigned int> liveTriangles(nVertices);
+    for(size_t v = 0; v < nVertices; v++) liveTriangles[v] = triangleStart[v + 1] - triangleStart[v];
+    vector<unsigned int> vertexTriangles(3*nTriangles);
+    vector<unsigned int> fill(triangleStart.begin(), triangleStart.end() - 1);
+    for(size_t i = 0; i < 3*nTriangles; i++) vertexTriangles[fill[indices[i]]++] = static_cast<unsigned int>(i/3);
+
+    vector<int> cachePosition(nVertices, -1);
+    vector<float> vertexScores(nVertices);
+    for(size_t v = 0; v < nVertices; v++) vertexScores[v] = vertexScore(-1, liveTriangles[v]);
+    vector<float> triangleScores(nTriangles);
+    for(size_t t = 0; t < nTriangles; t++) {
+        triangleScores[t] = vertexScores[indices[3*t]] + vertexScores[indices[3*t + 1]] + vertexScores[indices[3*t + 2]];
+    }
+    vector<bool> emitted(nTriangles, false);
+
+    // The cache can hold three vertices more than it scores while a triangle is added.
+    vector<unsigned int> cache, newCache;
+    cache.reserve(SCORING_CACHE_SIZE + 3);
+    newCache.reserve(SCORING_CACHE_SIZE + 3);
+
+    size_t best = max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+    size_t nextInput = 0;
+    while(order.size() < nTriangles) {
+        emitted[best] = true;
+        order.push_back(static_cast<unsigned int>(best));
+
+        // Remove the triangle from its vertices and put them first in the cache.
+        newCache.clear();
+        for(int k = 0; k < 3; k++) {
+            unsigned int v = indices[3*best + k];
+            unsigned int *triangles = &vertexTriangles[triangleStart[v]];
+            for(unsigned int i = 0; i < liveTriangles[v]; i++) {
+                if(triangles[i] == best) {
+                    swap(triangles[i], triangles[--liveTriangles[v]]);
+                    break;
+                }
+            }
+            if(find(newCache.begin(), newCache.end(), v) == newCache.end()) newCache.push_back(v);
+        }
+        for(unsigned int v : cache) {
+            if(find(newCache.begin(), newCache.end(), v) == newCache.end()) newCache.push_back(v);
+        }
+
+        // Score the vertices by their new place, the ones that fell out of the cache included.
+        for(size_t i = 0; i < newCache.size(); i++) {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < SCORING_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], liveTriangles[v]);
+        }
+        if(newCache.size() > SCORING_CACHE_SIZE) newCache.resize(SCORING_CACHE_SIZE);
+        swap(cache, newCache);
+
+        // The best triangle that uses a vertex in the cache is drawn next.
+        float bestScore = -1.0f;
+        best = nTriangles;
+        for(unsigned int v : cache) {
+            const unsigned int *triangles = &vertexTriangles[triangleStart[v]];
+            for(unsigned int i = 0; i < liveTriangles[v]; i++) {
+                unsigned int t = triangles[i];
+                float score = vertexScores[indices[3*t]] + vertexScores[indices[3*t + 1]] + vertexScores[indices[3*t + 2]];
+                if(score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+        if(best == nTriangles) {
+            while(nextInput < nTriangles && emitted[nextInput]) nextInput++;
+            best = nextInput;
+        }
+    }
+    return order;
+}
+
+/**
+ * Function for finding an order of the triangles that reduces overdraw,
+ * without losing much of the vertex cache order they already have. The
+ * triangles are split into clusters where the cache misses all three
+ * vertices, and those clusters are split again where the cache is doing
+ * at least as well as the threshold allows. The clusters are then sorted
+ * so that the ones facing away from the center of the mesh come first,
+ * since they are the most likely to hide other parts of the mesh.
+ *
+ * @param indices: Three vertex indices for each triangle, in vertex cache order.
+ * @param vertices: The vertices of the mesh.
+ * @param threshold: How much worse the ACMR may get, 1.05 allows it to get 5% worse.
+ *
+ * @return The index of the old triangle at each place of the new order.
+ */
+vector<unsigned int> MeshOptimizer::overdrawOrder(const vector<unsigned int> &indices, const vector<Vertex> &vertices, float threshold)
+{
+    size_t nTriangles = indices.size()/3;
+    vector<unsigned int> order(nTriangles);
+    for(size_t t = 0; t < nTriangles; t++) order[t] = static_cast<unsigned int>(t);
+    if(nTriangles == 0) return order;
+
+    // Hard boundaries, where the cache would be cold anyway.
+    FifoCache cache(vertices.size(), SIMULATED_CACHE_SIZE);
+    vector<size_t> hardStarts;
+    for(size_t t = 0; t < nTriangles; t++) {
+        unsigned int misses = cache.miss(indices[3*t]) + cache.miss(indices[3*t + 1]) + cache.miss(indices[3*t + 2]);
+        if(misses == 3) hardStarts.push_back(t);
+    }
+    if(hardStarts.empty() || hardStarts[0] != 0) hardStarts.insert(hardStarts.begin(), 0);
+    hardStarts.push_back(nTriangles);
+
+    // Soft boundaries, where the part since the last boundary is as good as the threshold allows.
+    vector<size_t> clusterStarts;
+    for(size_t h = 0; h + 1 < hardStarts.size(); h++) {
+        size_t first = hardStarts[h];
+        size_t last = hardStarts[h + 1];
+        float clusterACMR = float(countMisses(cache, indices, first, last))/(last - first);
+
+        cache.flush();
+        clusterStarts.push_back(first);
+        size_t start = first;
+        unsigned int misses = 0;
+        for(size_t t = first; t < last; t++) {
+            misses += cache.miss(indices[3*t]) + cache.miss(indices[3*t + 1]) + cache.miss(indices[3*t + 2]);
+            if(t + 1 < last && misses <= threshold*clusterACMR*(t + 1 - start)) {
+                clusterStarts.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    clusterStarts.push_back(nTriangles);
+
+    // The center of the mesh, and the center and direction of each cluster, weighted by area.
+    size_t nClusters = clusterStarts.size() - 1;
+    vector<glm::vec3> clusterCenters(nClusters, glm::vec3(0.0f));
+    vector<glm::vec3> clusterNormals(nClusters, glm::vec3(0.0f));
+    glm::vec3 meshCenter = glm::vec3(0.0f);
+    float meshArea = 0.0f;
+    for(size_t c = 0; c < nClusters; c++) {
+        float clusterArea = 0.0f;
+        for(size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            const glm::vec3 &a = vertices[indices[3*t]].position;
+            const glm::vec3 &b = vertices[indices[3*t + 1]].position;
+            const glm::vec3 &d = vertices[indices[3*t + 2]].position;
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            clusterCenters[c] += (a + b + d)*(area/3.0f);
+            clusterNormals[c] += normal;
+            clusterArea += area;
+        }
+        meshCenter += clusterCenters[c];
+        meshArea += clusterArea;
+        if(clusterArea > 0.0f) clusterCenters[c] /= clusterArea;
+    }
+    if(meshArea > 0.0f) meshCenter /= meshArea;
+
+    vector<float> sortKeys(nClusters);
+    for(size_t c = 0; c < nClusters; c++) {
+        float length = glm::length(clusterNormals[c]);
+        sortKeys[c] = length > 0.0f ? glm::dot(clusterCenters[c] - meshCenter, clusterNormals[c]/length) : 0.0f;
+    }
+    vector<unsigned int> clusterOrder(nClusters);
+    for(size_t c = 0; c < nClusters; c++) clusterOrder[c] = static_cast<unsigned int>(c);
+    stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+    order.clear();
+    for(unsigned int c : clusterOrder) {
+        for(size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) order.push_back(static_cast<unsigned int>(t));
+    }
+
+    // Keep the cache order if sorting the clusters made it too much worse.
+    vector<unsigned int> sorted(indices.size());
+    for(size_t t = 0; t < nTriangles; t++) copy(&indices[3*order[t]], &indices[3*order[t]] + 3, &sorted[3*t]);
+    float before = float(countMisses(cache, indices, 0, nTriangles));
+    float after = float(countMisses(cache, sorted, 0, nTriangles));
+    if(after > threshold*before) {
+        for(size_t t = 0; t < nTriangles; t++) order[t] = static_cast<unsigned int>(t);
+    }
+    return order;
+}
+
+/**
+ * Function for renumbering the vertices in the order that the triangles
+ * first use them, so the vertices are read from memory mostly in order.
+ * Vertices that no triangle uses are put last.
+ *
+ * @param indices: Three vertex indices for each triangle.
+ * @param nVertices: The number of vertices in the mesh.
+ *
+ * @return The new index of each old vertex.
+ */
+vector<unsigned int> MeshOptimizer::vertexFetchRemap(const vector<unsigned int> &indices, size_t nVertices)
+{
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(nVertices, unused);
+    unsigned int next = 0;
+    for(unsigned int v : indices) {
+        if(remap[v] == unused) remap[v] = next++;
+    }
+    for(size_t v = 0; v < nVertices; v++) {
+        if(remap[v] == unused) remap[v] = next++;
+    }
+    return remap;
+}
+
+/**
+ * Function for measuring how well a mesh uses a FIFO vertex cache.
+ *
+ * @param indices: Three vertex indices for each triangle.
+ * @param nVertices: The number of vertices in the mesh.
+ * @param cacheSize: The number of vertices in the cache.
+ *
+ * @return The ACMR and ATVR of the mesh.
+ */
+MeshOptimizer::VertexCacheStats MeshOptimizer::analyzeVertexCache(const vector<unsigned int> &indices, size_t nVertices, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    size_t nTriangles = indices.size()/3;
+    if(nTriangles == 0) return stats;
+
+    FifoCache cache(nVertices, cacheSize);
+    vector<bool> used(nVertices, false);
+    size_t misses = 0, nUsed = 0;
+    for(size_t i = 0; i < 3*nTriangles; i++) {
+        unsigned int v = indices[i];
+        misses += cache.miss(v);
+        if(!used[v]) {
+            used[v] = true;
+            nUsed++;
+        }
+    }
+    stats.acmr = float(misses)/nTriangles;
+    stats.atvr = float(misses)/nUsed;
+    return stats;
+}
+
+/**
+ * Function for scoring a vertex, following Tom Forsyth. The three vertices
+ * of the last triangle get a fixed score, so that the next triangle does
+ * not favour any edge of it, and the score falls with the place in the
+ * cache after that. Vertices with few triangles left get a boost.
+ *
+ * @param cachePosition: The place of the vertex in the cache, -1 if it is not in the cache.
+ * @param liveTriangles: The number of triangles that still use the vertex.
+ *
+ * @return The score of the vertex.
+ */
+float MeshOptimizer::vertexScore(int cachePosition, unsigned int liveTriangles)
+{
+    const float cacheDecayPower = 1.5f;
+    const float lastTriangleScore = 0.75f;
+    const float valenceBoostScale = 2.0f;
+    const float valenceBoostPower = 0.5f;
+
+    if(liveTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+    if(cachePosition >= 0) {
+        if(cachePosition < 3) {
+            score = lastTriangleScore;
+        } else {
+            float scaler = 1.0f/(SCORING_CACHE_SIZE - 3);
+            score = pow(1.0f - (cachePosition - 3)*scaler, cacheDecayPower);
+        }
+    }
+    unsigned int valence = liveTriangles < MAX_VALENCE ? liveTriangles : MAX_VALENCE;
+    score += valenceBoostScale*pow(float(valence), -valenceBoostPower);
+    return score;
+}
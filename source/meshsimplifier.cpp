@@ -0,0 +1,304 @@
+#include "meshsimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+/**
+ * This class simplifies a mesh by collapsing edges, with the quadric
+ * error metric of Garland and Heckbert.
+ */
+
+namespace
+{
+    // The bits of a position, so that equal positions can be found with a hash map.
+    struct PositionKey {
+        uint32_t x, y, z;
+        bool operator==(const PositionKey &o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey &k) const {
+            return (size_t(k.x)*73856093u) ^ (size_t(k.y)*19349663u) ^ (size_t(k.z)*83492791u);
+        }
+    };
+
+    PositionKey toKey(const glm::vec3 &p)
+    {
+        PositionKey key;
+        memcpy(&key.x, &p.x, sizeof(float));
+        memcpy(&key.y, &p.y, sizeof(float));
+        memcpy(&key.z, &p.z, sizeof(float));
+        return key;
+    }
+
+    uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    glm::vec3 triangleNormal(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+    {
+        return glm::cross(b - a, c - a);
+    }
+}
+
+/**
+ * Constructor of the simplifier. The quadrics of all vertices are made
+ * from the triangles of the full mesh, and the vertices that must never
+ * be removed are found.
+ *
+ * @param vertices: The vertices of the mesh.
+ * @param indices: Three vertex indices for each triangle.
+ * @param triangleGroups: The group of faces that each triangle belongs to.
+ */
+MeshSimplifier::MeshSimplifier(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<unsigned int> &triangleGroups)
+{
+    size_t nVertices = vertices.size();
+    size_t nTriangles = indices.size()/3;
+    positions.resize(nVertices);
+    for(size_t v = 0; v < nVertices; v++) positions[v] = vertices[v].position;
+    quadrics.assign(nVertices, Quadric());
+    locked.assign(nVertices, 0);
+
+    for(size_t t = 0; t < nTriangles; t++) {
+        const glm::vec3 &a = positions[indices[3*t]];
+        glm::vec3 normal = triangleNormal(a, positions[indices[3*t + 1]], positions[indices[3*t + 2]]);
+        double length = glm::length(normal);
+        if(length <= 0.0) continue;
+        double nx = normal.x/length, ny = normal.y/length, nz = normal.z/length;
+        double d = -(nx*a.x + ny*a.y + nz*a.z);
+        for(int k = 0; k < 3; k++) quadrics[indices[3*t + k]].addPlane(nx, ny, nz, d, 0.5*length);
+    }
+
+    // Seams, where several vertices share a position.
+    unordered_map<PositionKey, unsigned int, PositionKeyHash> firstAtPosition;
+    firstAtPosition.reserve(nVertices);
+    for(size_t v = 0; v < nVertices; v++) {
+        auto inserted = firstAtPosition.insert(make_pair(toKey(positions[v]), static_cast<unsigned int>(v)));
+        if(!inserted.second) {
+            locked[v] = 1;
+            locked[inserted.first->second] = 1;
+        }
+    }
+
+    // Vertices used by more than one group of faces.
+    const unsigned int noGroup = ~0u;
+    vector<unsigned int> vertexGroup(nVertices, noGroup);
+    for(size_t t = 0; t < nTriangles; t++) {
+        for(int k = 0; k < 3; k++) {
+            unsigned int v = indices[3*t + k];
+            if(vertexGroup[v] == noGroup) vertexGroup[v] = triangleGroups[t];
+            else if(vertexGroup[v] != triangleGroups[t]) locked[v] = 1;
+        }
+    }
+
+    // Borders and edges with more than two triangles.
+    unordered_map<uint64_t, unsigned int> edgeCounts;
+    edgeCounts.reserve(indices.size());
+    for(size_t t = 0; t < nTriangles; t++) {
+        for(int k = 0; k < 3; k++) edgeCounts[edgeKey(indices[3*t + k], indices[3*t + (k + 1)%3])]++;
+    }
+    for(const auto &edge : edgeCounts) {
+        if(edge.second == 2) continue;
+        locked[edge.first >> 32] = 1;
+        locked[edge.first & 0xffffffffu] = 1;
+    }
+}
+
+/**
+ * Function for simplifying a mesh until it has no more than a number of
+ * triangles, or until no more edges can be collapsed. The work is done
+ * in passes. Each pass finds the cheapest collapse of every edge, sorts
+ * them and applies the cheapest ones, but never two that touch the same
+ * triangles, so the mesh only has to be updated once per pass.
+ *
+ * @param indices: Three vertex indices for each triangle, replaced by the simplified mesh.
+ * @param triangleGroups: The group of faces of each triangle, kept in the same order as the triangles.
+ * @param targetTriangles: The number of triangles to simplify down to.
+ *
+ * @return The largest distance that the surface was moved, as the root mean square distance to the planes of the removed vertices.
+ */
+float MeshSimplifier::simplify(vector<unsigned int> &indices, vector<unsigned int> &triangleGroups, size_t targetTriangles)
+{
+    size_t nVertices = positions.size();
+    double maxError = 0.0;
+    vector<unsigned int> triangleStart(nVertices + 1);
+    vector<unsigned int> vertexTriangles;
+    vector<uint64_t> edges;
+    vector<Collapse> collapses;
+    vector<unsigned char> touched(nVertices);
+    vector<unsigned int> remap(nVertices);
+
+    while(indices.size()/3 > targetTriangles) {
+        size_t nTriangles = indices.size()/3;
+
+        // The triangles around each vertex.
+        fill(triangleStart.begin(), triangleStart.end(), 0);
+        for(unsigned int v : indices) triangleStart[v + 1]++;
+        for(size_t v = 0; v < nVertices; v++) triangleStart[v + 1] += triangleStart[v];
+        vertexTriangles.resize(indices.size());
+        vector<unsigned int> offsets(triangleStart.begin(), triangleStart.end() - 1);
+        for(size_t i = 0; i < indices.size(); i++) vertexTriangles[offsets[indices[i]]++] = static_cast<unsigned int>(i/3);
+
+        // The cheapest direction of every edge that can be collapsed.
+        edges.clear();
+        for(size_t t = 0; t < nTriangles; t++) {
+            for(int k = 0; k < 3; k++) edges.push_back(edgeKey(indices[3*t + k], indices[3*t + (k + 1)%3]));
+        }
+        sort(edges.begin(), edges.end());
+        edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for(uint64_t edge : edges) {
+            unsigned int a = static_cast<unsigned int>(edge >> 32);
+            unsigned int b = static_cast<unsigned int>(edge & 0xffffffffu);
+            if(locked[a] && locked[b]) continue;
+            Quadric q = quadrics[a];
+            q.add(quadrics[b]);
+            double weight = q.weight > 0.0 ? q.weight : 1.0;
+            Collapse collapse = { a, b, 1e30 };
+            if(!locked[a]) collapse.cost = q.error(positions[b])/weight;
+            if(!locked[b]) {
+                double cost = q.error(positions[a])/weight;
+                if(cost < collapse.cost) {
+                    collapse.from = b;
+                    collapse.to = a;
+                    collapse.cost = cost;
+                }
+            }
+            collapses.push_back(collapse);
+        }
+        if(collapses.empty()) break;
+        sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+
+        // Apply the cheapest collapses that do not touch each other.
+        size_t toRemove = nTriangles - targetTriangles;
+        size_t removed = 0;
+        size_t applied = 0;
+        fill(touched.begin(), touched.end(), 0);
+        for(size_t v = 0; v < nVertices; v++) remap[v] = static_cast<unsigned int>(v);
+        for(const Collapse &collapse : collapses) {
+            if(removed >= toRemove) break;
+            if(touched[collapse.from] || touched[collapse.to]) continue;
+            if(flips(indices, triangleStart, vertexTriangles, collapse.from, collapse.to)) continue;
+
+            for(unsigned int i = triangleStart[collapse.from]; i < triangleStart[collapse.from + 1]; i++) {
+                const unsigned int *triangle = &indices[3*vertexTriangles[i]];
+                for(int k = 0; k < 3; k++) {
+                    touched[triangle[k]] = 1;
+                    if(triangle[k] == collapse.to) removed++;
+                }
+            }
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxError = std::max(maxError, collapse.cost);
+            applied++;
+        }
+        if(applied == 0) break;
+
+        // Move the removed vertices and drop the triangles that became lines.
+        size_t kept = 0;
+        for(size_t t = 0; t < nTriangles; t++) {
+            unsigned int a = remap[indices[3*t]], b = remap[indices[3*t + 1]], c = remap[indices[3*t + 2]];
+            if(a == b || b == c || a == c) continue;
+            indices[3*kept] = a;
+            indices[3*kept + 1] = b;
+            indices[3*kept + 2] = c;
+            triangleGroups[kept] = triangleGroups[t];
+            kept++;
+        }
+        indices.resize(3*kept);
+        triangleGroups.resize(kept);
+    }
+    return static_cast<float>(sqrt(maxError));
+}
+
+/**
+ * Function for checking if moving a vertex onto another would turn any
+ * of the triangles around it over, or make them degenerate.
+ *
+ * @param indices: Three vertex indices for each triangle.
+ * @param triangleStart: Where the triangles of each vertex start in vertexTriangles.
+ * @param vertexTriangles: The triangles around each vertex.
+ * @param from: The vertex that is removed.
+ * @param to: The vertex that it is moved onto.
+ *
+ * @return True if the collapse would fold the surface.
+ */
+bool MeshSimplifier::flips(const vector<unsigned int> &indices, const vector<unsigned int> &triangleStart,
+                           const vector<unsigned int> &vertexTriangles, unsigned int from, unsigned int to) const
+{
+    for(unsigned int i = triangleStart[from]; i < triangleStart[from + 1]; i++) {
+        const unsigned int *triangle = &indices[3*vertexTriangles[i]];
+        if(triangle[0] == to || triangle[1] == to || triangle[2] == to) continue;
+
+        glm::vec3 corners[3];
+        for(int k = 0; k < 3; k++) corners[k] = positions[triangle[k]];
+        glm::vec3 before = triangleNormal(corners[0], corners[1], corners[2]);
+        for(int k = 0; k < 3; k++) {
+            if(triangle[k] == from) corners[k] = positions[to];
+        }
+        glm::vec3 after = triangleNormal(corners[0], corners[1], corners[2]);
+
+        // The normal of the triangle may not turn more than about 80 degrees.
+        float dot = glm::dot(before, after);
+        if(dot <= 0.0f || dot*dot < 0.04f*glm::dot(before, before)*glm::dot(after, after)) return true;
+    }
+    return false;
+}
+
+/**
+ * Function for counting the vertices that can never be removed.
+ *
+ * @return The number of locked vertices.
+ */
+size_t MeshSimplifier::lockedVertexCount() const
+{
+    size_t count = 0;
+    for(unsigned char l : locked) count += l;
+    return count;
+}
+
+/**
+ * Function for adding the plane of a triangle to a quadric.
+ *
+ * @param nx, ny, nz: The unit normal of the plane.
+ * @param d: The distance term of the plane, so that n.p + d = 0 on the plane.
+ * @param area: The area of the triangle, which the plane is weighted by.
+ */
+void MeshSimplifier::Quadric::addPlane(double nx, double ny, double nz, double d, double area)
+{
+    a00 += area*nx*nx; a01 += area*nx*ny; a02 += area*nx*nz; a03 += area*nx*d;
+    a11 += area*ny*ny; a12 += area*ny*nz; a13 += area*ny*d;
+    a22 += area*nz*nz; a23 += area*nz*d;
+    a33 += area*d*d;
+    weight += area;
+}
+
+/**
+ * Function for adding another quadric to this one.
+ */
+void MeshSimplifier::Quadric::add(const Quadric &q)
+{
+    a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+    a11 += q.a11; a12 += q.a12; a13 += q.a13;
+    a22 += q.a22; a23 += q.a23;
+    a33 += q.a33;
+    weight += q.weight;
+}
+
+/**
+ * Function for evaluating the quadric at a point, which is the area
+ * weighted sum of the squared distances from the point to the planes.
+ */
+double MeshSimplifier::Quadric::error(const glm::vec3 &p) const
+{
+    double x = p.x, y = p.y, z = p.z;
+    double result = a00*x*x + 2.0*a01*x*y + 2.0*a02*x*z + 2.0*a03*x
+                  + a11*y*y + 2.0*a12*y*z + 2.0*a13*y
+                  + a22*z*z + 2.0*a23*z
+                  + a33;
+    return std::max(0.0, result);
+}
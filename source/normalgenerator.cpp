@@ -0,0 +1,334 @@
+#include "normalgenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * This class generates vertex normals for meshes that have none.
+ */
+
+namespace
+{
+    /**
+     * Function for finding the angle between two edges from their dot
+     * product and squared lengths. Degenerate edges give the angle 0,
+     * so that they do not add anything to the normal.
+     */
+    float cornerAngle(float dot, float length2A, float length2B)
+    {
+        float denominator = length2A*length2B;
+        if(denominator <= 0.0f) return 0.0f;
+        float cosine = dot/sqrt(denominator);
+        return acos(std::max(-1.0f, std::min(1.0f, cosine)));
+    }
+}
+
+/**
+ * Constructor of the normal generator.
+ *
+ * @param pool: The thread pool that the passes run on.
+ */
+NormalGenerator::NormalGenerator(ThreadPool &pool) : pool(pool)
+{
+}
+
+/**
+ * Function for generating the normals of all vertices. Any normals
+ * that the vertices had before are replaced.
+ *
+ * @param vertices: The vertices of the mesh.
+ * @param triangles: Three vertex indices for each triangle.
+ * @param weighting: How the normals of the triangles are weighted.
+ */
+void NormalGenerator::generate(vector<Vertex> &vertices, const vector<unsigned int> &triangles, Weighting weighting)
+{
+    prepare(vertices, triangles, weighting);
+
+    parallelRanges(vertices.size(), [&](size_t first, size_t last) {
+        for(size_t v = first; v < last; v++) {
+            float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+            for(unsigned int a = adjacencyStart[v]; a < adjacencyStart[v + 1]; a++) {
+                unsigned int corner = adjacency[a];
+                unsigned int t = corner/3;
+                float weight = weighting == ANGLE_WEIGHTED ? cornerWeights[corner] : 1.0f;
+                sx += weight*nx[t];
+                sy += weight*ny[t];
+                sz += weight*nz[t];
+            }
+            float length2 = sx*sx + sy*sy + sz*sz;
+            float invLength = length2 > 0.0f ? 1.0f/sqrt(length2) : 0.0f;
+            vertices[v].normal = glm::vec3(sx*invLength, sy*invLength, sz*invLength);
+        }
+    });
+}
+
+/**
+ * Function for running the face normal and adjacency passes without
+ * writing any vertex normals. Afterwards the face normals, the corner
+ * weights and the adjacency can be read by other passes.
+ *
+ * @param vertices: The vertices of the mesh.
+ * @param triangles: Three vertex indices for each triangle.
+ * @param weighting: How the normals of the triangles are weighted.
+ */
+void NormalGenerator::prepare(const vector<Vertex> &vertices, const vector<unsigned int> &triangles, Weighting weighting)
+{
+    currentWeighting = weighting;
+    size_t nVertices = vertices.size();
+    size_t nTriangles = triangles.size()/3;
+
+    px.resize(nVertices);
+    py.resize(nVertices);
+    pz.resize(nVertices);
+    parallelRanges(nVertices, [&](size_t first, size_t last) {
+        for(size_t v = first; v < last; v++) {
+            px[v] = vertices[v].position.x;
+            py[v] = vertices[v].position.y;
+            pz[v] = vertices[v].position.z;
+        }
+    });
+
+    nx.resize(nTriangles);
+    ny.resize(nTriangles);
+    nz.resize(nTriangles);
+    if(weighting == ANGLE_WEIGHTED) cornerWeights.resize(3*nTriangles);
+    parallelRanges(nTriangles, [&](size_t first, size_t last) {
+        computeFaceNormals(triangles.data(), first, last, weighting);
+    });
+
+    buildAdjacency(triangles, nVertices);
+}
+
+/**
+ * Function for computing the normals of a range of triangles. For area
+ * weighting the cross product is kept as it is, since its length is
+ * twice the area of the triangle. For angle weighting the normal is
+ * normalized and the angle at each corner is stored as its weight.
+ *
+ * @param triangles: Three vertex indices for each triangle.
+ * @param first: The first triangle of the range.
+ * @param last: One past the last triangle of the range.
+ * @param weighting: How the normals of the triangles are weighted.
+ */
+void NormalGenerator::computeFaceNormals(const unsigned int *triangles, size_t first, size_t last, Weighting weighting)
+{
+    size_t t = first;
+
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    for(; t + 4 <= last; t += 4) {
+        // Gather the corners of four triangles into one register per component.
+        alignas(16) float corner[9][4];
+        for(int j = 0; j < 4; j++) {
+            const unsigned int *triangle = triangles + 3*(t + j);
+            for(int k = 0; k < 3; k++) {
+                corner[3*k][j] = px[triangle[k]];
+                corner[3*k + 1][j] = py[triangle[k]];
+                corner[3*k + 2][j] = pz[triangle[k]];
+            }
+        }
+        __m128 ax = _mm_load_ps(corner[0]), ay = _mm_load_ps(corner[1]), az = _mm_load_ps(corner[2]);
+        __m128 e1x = _mm_sub_ps(_mm_load_ps(corner[3]), ax);
+        __m128 e1y = _mm_sub_ps(_mm_load_ps(corner[4]), ay);
+        __m128 e1z = _mm_sub_ps(_mm_load_ps(corner[5]), az);
+        __m128 e2x = _mm_sub_ps(_mm_load_ps(corner[6]), ax);
+        __m128 e2y = _mm_sub_ps(_mm_load_ps(corner[7]), ay);
+        __m128 e2z = _mm_sub_ps(_mm_load_ps(corner[8]), az);
+
+        __m128 cx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+        __m128 cy = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+        __m128 cz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+        if(weighting == ANGLE_WEIGHTED) {
+            __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+            __m128 invLength = _mm_and_ps(_mm_cmpgt_ps(length2, zero), _mm_div_ps(one, _mm_sqrt_ps(length2)));
+            cx = _mm_mul_ps(cx, invLength);
+            cy = _mm_mul_ps(cy, invLength);
+            cz = _mm_mul_ps(cz, invLength);
+
+            // The third edge goes from the second corner to the third.
+            __m128 e3x = _mm_sub_ps(e2x, e1x), e3y = _mm_sub_ps(e2y, e1y), e3z = _mm_sub_ps(e2z, e1z);
+            alignas(16) float l1[4], l2[4], l3[4], d12[4], d13[4], d23[4];
+            _mm_store_ps(l1, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e1x), _mm_mul_ps(e1y, e1y)), _mm_mul_ps(e1z, e1z)));
+            _mm_store_ps(l2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e2x), _mm_mul_ps(e2y, e2y)), _mm_mul_ps(e2z, e2z)));
+            _mm_store_ps(l3, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e3x, e3x), _mm_mul_ps(e3y, e3y)), _mm_mul_ps(e3z, e3z)));
+            _mm_store_ps(d12, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e2x), _mm_mul_ps(e1y, e2y)), _mm_mul_ps(e1z, e2z)));
+            _mm_store_ps(d13, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, e3x), _mm_mul_ps(e1y, e3y)), _mm_mul_ps(e1z, e3z)));
+            _mm_store_ps(d23, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, e3x), _mm_mul_ps(e2y, e3y)), _mm_mul_ps(e2z, e3z)));
+            for(int j = 0; j < 4; j++) {
+                float *weights = &cornerWeights[3*(t + j)];
+                weights[0] = cornerAngle(d12[j], l1[j], l2[j]);
+                weights[1] = cornerAngle(-d13[j], l1[j], l3[j]);
+                weights[2] = cornerAngle(d23[j], l2[j], l3[j]);
+            }
+        }
+
+        _mm_storeu_ps(&nx[t], cx);
+        _mm_storeu_ps(&ny[t], cy);
+        _mm_storeu_ps(&nz[t], cz);
+    }
+#endif
+
+    // The triangles that are left, or all of them without SSE.
+    for(; t < last; t++) {
+        const unsigned int *triangle = triangles + 3*t;
+        glm::vec3 a = glm::vec3(px[triangle[0]], py[triangle[0]], pz[triangle[0]]);
+        glm::vec3 e1 = glm::vec3(px[triangle[1]], py[triangle[1]], pz[triangle[1]]) - a;
+        glm::vec3 e2 = glm::vec3(px[triangle[2]], py[triangle[2]], pz[triangle[2]]) - a;
+        glm::vec3 normal = glm::cross(e1, e2);
+
+        if(weighting == ANGLE_WEIGHTED) {
+            float length = glm::length(normal);
+            normal = length > 0.0f ? normal/length : glm::vec3(0.0f);
+            glm::vec3 e3 = e2 - e1;
+            float *weights = &cornerWeights[3*t];
+            weights[0] = cornerAngle(glm::dot(e1, e2), glm::dot(e1, e1), glm::dot(e2, e2));
+            weights[1] = cornerAngle(-glm::dot(e1, e3), glm::dot(e1, e1), glm::dot(e3, e3));
+            weights[2] = cornerAngle(glm::dot(e2, e3), glm::dot(e2, e2), glm::dot(e3, e3));
+        }
+
+        nx[t] = normal.x;
+        ny[t] = normal.y;
+        nz[t] = normal.z;
+    }
+}
+
+/**
+ * Function for building the list of corners that use each vertex. The
+ * triangles are split into one part per thread. Every part counts its
+ * own corners per vertex, which gives each part a fixed slot in the
+ * list of every vertex, so the parts can then fill the list at the
+ * same time without writing to the same place.
+ *
+ * @param triangles: Three vertex indices for each triangle.
+ * @param nVertices: The number of vertices in the mesh.
+ */
+void NormalGenerator::buildAdjacency(const vector<unsigned int> &triangles, size_t nVertices)
+{
+    size_t nCorners = triangles.size() - triangles.size()%3;
+    size_t nParts = std::max<size_t>(1, std::min(pool.size(), nCorners/(3*TASK_SIZE)));
+    size_t partSize = (nCorners + nParts - 1)/nParts;
+
+    vector<unsigned int> counts(nParts*nVertices, 0);
+    pool.parallelFor(nParts, [&](size_t p) {
+        unsigned int *partCounts = &counts[p*nVertices];
+        size_t last = std::min(nCorners, (p + 1)*partSize);
+        for(size_t c = p*partSize; c < last; c++) partCounts[triangles[c]]++;
+    });
+
+    // Turn the counts into the offset of each part within the list of each vertex.
+    adjacencyStart.resize(nVertices + 1);
+    parallelRanges(nVertices, [&](size_t first, size_t last) {
+        for(size_t v = first; v < last; v++) {
+            unsigned int total = 0;
+            for(size_t p = 0; p < nParts; p++) {
+                unsigned int count = counts[p*nVertices + v];
+                counts[p*nVertices + v] = total;
+                total += count;
+            }
+            adjacencyStart[v + 1] = total;
+        }
+    });
+    adjacencyStart[0] = 0;
+    for(size_t v = 0; v < nVertices; v++) adjacencyStart[v + 1] += adjacencyStart[v];
+
+    adjacency.resize(nCorners);
+    pool.parallelFor(nParts, [&](size_t p) {
+        unsigned int *partOffsets = &counts[p*nVertices];
+        size_t last = std::min(nCorners, (p + 1)*partSize);
+        for(size_t c = p*partSize; c < last; c++) {
+            unsigned int v = triangles[c];
+            adjacency[adjacencyStart[v] + partOffsets[v]++] = static_cast<unsigned int>(c);
+        }
+    });
+}
+
+/**
+ * Function for splitting a range of work into parts and running the
+ * parts on the thread pool.
+ *
+ * @param n: The number of elements in the range.
+ * @param task: The work to do for the elements from first up to last.
+ */
+void NormalGenerator::parallelRanges(size_t n, const function<void(size_t, size_t)> &task)
+{
+    size_t nTasks = (n + TASK_SIZE - 1)/TASK_SIZE;
+    pool.parallelFor(nTasks, [&](size_t t) {
+        task(t*TASK_SIZE, std::min(n, (t + 1)*TASK_SIZE));
+    });
+}
+
+/**
+ * Function for generating normals the way the program did before the
+ * normal generator existed. Every triangle adds its normalized normal
+ * to its three vertices, on a single thread. It is only kept to compare
+ * the speed of the generator against.
+ *
+ * @param vertices: The vertices of the mesh.
+ * @param triangles: Three vertex indices for each triangle.
+ */
+void NormalGenerator::generateReference(vector<Vertex> &vertices, const vector<unsigned int> &triangles)
+{
+    for(Vertex &vertex : vertices) vertex.normal = glm::vec3(0.0f);
+    for(size_t i = 0; i + 2 < triangles.size(); i += 3) {
+        Vertex v1 = vertices[triangles[i]];
+        Vertex v2 = vertices[triangles[i+1]];
+        Vertex v3 = vertices[triangles[i+2]];
+
+        glm::vec3 normal = glm::normalize(glm::cross(v2.position - v1.position, v3.position - v1.position));
+
+        vertices[triangles[i]].normal += normal;
+        vertices[triangles[i+1]].normal += normal;
+        vertices[triangles[i+2]].normal += normal;
+    }
+    for(size_t n = 0; n < vertices.size(); n++)
+        vertices[n].normal = glm::normalize(vertices[n].normal);
+}
+
+/**
+ * Function for comparing the speed of the generator against the
+ * implementation it replaced, on the given mesh. Every method is run
+ * a few times and the fastest run is reported.
+ *
+ * @param vertices: The vertices of the mesh.
+ * @param triangles: Three vertex indices for each triangle.
+ *
+ * @return A report of the timings.
+ */
+string NormalGenerator::benchmark(const vector<Vertex> &vertices, const vector<unsigned int> &triangles)
+{
+    const int nRuns = 5;
+    typedef chrono::steady_clock Clock;
+    NormalGenerator generator(ThreadPool::shared());
+    vector<Vertex> work;
+    double best[3] = { 1e30, 1e30, 1e30 };
+
+    for(int r = 0; r < nRuns; r++) {
+        work = vertices;
+        Clock::time_point start = Clock::now();
+        generateReference(work, triangles);
+        best[0] = std::min(best[0], chrono::duration<double, milli>(Clock::now() - start).count());
+
+        for(int w = 0; w < 2; w++) {
+            work = vertices;
+            start = Clock::now();
+            generator.generate(work, triangles, w == 0 ? AREA_WEIGHTED : ANGLE_WEIGHTED);
+            best[w + 1] = std::min(best[w + 1], chrono::duration<double, milli>(Clock::now() - start).count());
+        }
+    }
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "\nNormal generation benchmark, %zu vertices, %zu triangles, %zu threads:\n"
+             "\tPrevious implementation: %.2f ms\n"
+             "\tArea weighted:           %.2f ms\n"
+             "\tAngle weighted:          %.2f ms\n",
+             vertices.size(), triangles.size()/3, ThreadPool::shared().size(), best[0], best[1], best[2]);
+    return string(buffer);
+}
@@ -1,4 +1,9 @@
 #include "object.h"
+#include "meshsimplifier.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
 
 /**
  * This class represents an object in this program. An object
@@ -18,160 +23,412 @@
  */
 
 /**
- * Constructor of the Object class. It takes a file name and generates
- * both the objects vertex and index buffer.
+ * Constructor of the Object class. The vertex and index buffers of
+ * the object are not created until the data is sent to them, so an
+ * object can be constructed without an OpenGL context.
  * 
  * @param fileName: The name of the object file.
  */
 Object::Object(string fileName)
 {
     Object::fileName = fileName;
-    
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+}
 
-    glGenBuffers( 1, &vBuffer);
-    glBindBuffer( GL_ARRAY_BUFFER, vBuffer);
+/**
+ * Function for adding an instance of the object. The new instance is
+ * placed next to the last one along the x-axis, like objects placed
+ * along a street, and can then be moved with setInstanceTransform.
+ */
+void Object::addInstance()
+{
+    const float spacing = 2.0f;
+    InstanceTransform transform = instanceTransforms.back();
+    transform.translation.x += spacing;
+    instanceTransforms.push_back(transform);
+    instanceMatrices.push_back(transform.matrix());
+    instancesChanged = true;
+    transformRevision++;
+}
 
-    glGenBuffers(1, &iBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iBuffer);
+/**
+ * Function for removing the last added instance of the object. The
+ * first instance can not be removed.
+ */
+void Object::removeInstance()
+{
+    if(instanceMatrices.size() <= 1) return;
+    instanceTransforms.pop_back();
+    instanceMatrices.pop_back();
+    instancesChanged = true;
+    transformRevision++;
+}
 
-    glBindVertexArray(0);
+/**
+ * Function for placing an instance of the object.
+ * 
+ * @param instance: The index of the instance.
+ * @param transform: The placement of the instance, relative to the model matrix.
+ */
+void Object::setInstanceTransform(size_t instance, const InstanceTransform &transform)
+{
+    if(instance >= instanceTransforms.size()) return;
+    instanceTransforms[instance] = transform;
+    instanceMatrices[instance] = transform.matrix();
+    instancesChanged = true;
+    transformRevision++;
+}
+
+/**
+ * Function for making the matrix of an instance placement. The instance
+ * is scaled first, then rotated around x, y and z, and then moved.
+ * 
+ * @return The matrix of the placement.
+ */
+glm::mat4 Object::InstanceTransform::matrix() const
+{
+    glm::mat4 M = glm::translate(glm::mat4(1.0f), translation);
+    M = glm::rotate(M, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    M = glm::rotate(M, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    M = glm::rotate(M, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    return glm::scale(M, glm::vec3(scale));
 }
 
 /**
- * Function for sending the data of the object to the vertex shader. The data
- * that is sent for each vertex is:
+ * Function for producing vertex normals for the object. The objects vertex normals
+ * will be assigned after the function call. 
  * 
- *      -   The Vertex position.
- *      -   The Vertex Normal.
- *      -   The Texture Coordinate.
+ * The normal of each vertex is the weighted sum of the normals of the triangles that
+ * use it, see NormalGenerator. Triangles are only smoothed together if they are in
+ * the same smoothing group and meet at less than the crease angle of the object, so
+ * vertices on a hard edge are split into one vertex per side, see CreaseNormals.
  * 
- * After the call the objects vertex array object, array buffer and element
- * array buffer will be changed.
+ * @param weighting: If the triangles are weighted by their area or by their angle.
  */
-void Object::sendDataToBuffers()
+void Object::produceVertexNormals(NormalGenerator::Weighting weighting)
 {
-    glBindVertexArray(vao);
-    size_t vSize = vertices.size()*sizeof(Vertex);
-    size_t iSize = oInfo.nIndices*sizeof(unsigned int);
-
-    // Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-    glEnableVertexAttribArray(0);
-
-    // Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(1);
-
-    // Texture coordinates
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
-    glEnableVertexAttribArray(2);
-    
-    // Allocate memory for both buffers without inserting data.
-    glBufferData( GL_ARRAY_BUFFER, vSize, vertices.data(), GL_STATIC_DRAW );
-    glBufferData( GL_ELEMENT_ARRAY_BUFFER, iSize, NULL, GL_STATIC_DRAW );
-
-    int offset = 0;
-    int iFaceSize; 
-    for(Face face : faces) {
-        iFaceSize = face.indices.size()*sizeof(unsigned int);
-        glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, offset, iFaceSize, face.indices.data());
-        offset += iFaceSize;
-    }
-    glBindVertexArray(0);
+    creaseNormals.setMesh(vertices, getTriangles(), getSmoothingGroups(), weighting);
+    baseVertexIndices.clear();
+    oInfo.normalsGenerated = true;
+    oInfo.normalWeighting = weighting;
+    oInfo.hasSmoothingGroups = creaseNormals.hasGroups();
+    updateVertexNormals();
 }
 
 /**
- * Function for drawing the object to the frame buffer, using a specified shader
- * program.
+ * Function for making the generated normals again if the crease angle or
+ * the use of smoothing groups has changed. Only the vertices that are
+ * affected by the change are computed. The vertices and indices change,
+ * so the data must be sent to the buffers again afterwards.
  * 
- * @param program: The shader program to be used when drawing the object.
+ * @return True if the vertices and indices were changed.
  */
-void Object::drawObject(GLuint program)
+bool Object::updateVertexNormals()
 {
-    glBindVertexArray(vao);
-
-    oInfo.showWireFrame? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    oInfo.showTexture? glBindTexture(GL_TEXTURE_2D, texture) : glBindTexture(GL_TEXTURE_2D, 0);
-
-    GLuint locModel;
-    locModel = glGetUniformLocation( program, "M");
-    glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(matModel));
-
-    GLuint locHasTexture;
-    locHasTexture = glGetUniformLocation(program, "showTexture");
-    glUniform1i(locHasTexture, oInfo.showTexture);
-
-    GLuint locAlpha;
-    locAlpha = glGetUniformLocation(program, "alpha");
-    glUniform1f(locAlpha, (matAlpha));
-
-    int offset = 0;
-    for(Face face : faces) {
-        if(oInfo.useDefaultMat) {
-            glUniform3f(glGetUniformLocation(program, "ka"), defMat.ka.x, defMat.ka.y, defMat.ka.z);
-            glUniform3f(glGetUniformLocation(program, "kd"), defMat.kd.x, defMat.kd.y, defMat.kd.z);
-            glUniform3f(glGetUniformLocation(program, "ks"), defMat.ks.x, defMat.ks.y, defMat.ks.z);
-        } else {
-            glUniform3f(glGetUniformLocation(program, "ka"), face.mInfo.ka.x, face.mInfo.ka.y, face.mInfo.ka.z);
-            glUniform3f(glGetUniformLocation(program, "kd"), face.mInfo.kd.x, face.mInfo.kd.y, face.mInfo.kd.z);
-            glUniform3f(glGetUniformLocation(program, "ks"), face.mInfo.ks.x, face.mInfo.ks.y, face.mInfo.ks.z);
-        }
-        glDrawElements(GL_TRIANGLES, static_cast<int>(face.indices.size()), GL_UNSIGNED_INT, BUFFER_OFFSET(offset));
-        offset += face.indices.size()*sizeof(unsigned int);
+    if(!oInfo.normalsGenerated) return false;
+    if(creaseNormals.empty() && !baseVertexIndices.empty()) {
+        if(oInfo.creaseAngle == baseCreaseAngle && oInfo.useSmoothingGroups == baseUseSmoothingGroups) return false;
+        restoreCreaseNormals();
+    }
+    if(!creaseNormals.needsUpdate(oInfo.creaseAngle, oInfo.useSmoothingGroups)) return false;
+
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    oInfo.nNormalsUpdated = static_cast<int>(creaseNormals.update(oInfo.creaseAngle, oInfo.useSmoothingGroups));
+    vector<unsigned int> triangles;
+    creaseNormals.writeMesh(vertices, triangles);
+
+    // The triangles are in face order, so each face takes back its own range.
+    size_t offset = 0;
+    for(Face &face : faces) {
+        copy(triangles.begin() + offset, triangles.begin() + offset + face.indices.size(), face.indices.begin());
+        offset += face.indices.size();
+    }
+
+    // The levels of detail use the old vertices, so they must be built again.
+    if(getLodCount() > 1 || oInfo.generateLods) {
+        clearLods();
+        oInfo.lodsOutdated = true;
     }
 
-    glBindVertexArray(0);
+    // The split vertices are added last, so they are numbered by use again.
+    if(oInfo.meshOptimized) optimizeVertexFetch();
+
+    oInfo.nVertices = vertices.size();
+    oInfo.nVertexNormals = vertices.size();
+    oInfo.nSplitVertices = static_cast<int>(creaseNormals.splitVertexCount());
+    oInfo.normalUpdateTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    meshRevision++;
+    return true;
 }
 
 /**
- * Function for producing vertex normals for the object. The objects vertex normals
- * will be assigned after the function call. 
+ * Function for getting the vertex that each vertex of the object was
+ * split from when the normals were generated. Vertices that no triangle
+ * uses are given vertices of their own after the others.
  * 
- * It takes the three vertices of a face and adds the face normal to each of the
- * vertex normal. After iterating all faces, normalize each of the vertex normal to
- * produce the vertex normal for a vertex of the object.
+ * @return The index of the vertex before the split for each vertex, or nothing if the normals were not generated.
  */
-void Object::produceVertexNormals()
+vector<unsigned int> Object::getBaseVertexIndices() const
 {
-    // Calculate normals per triangle and add them to each vertex normal
-    for(Face face : faces) {
-        for(size_t i = 0; i < face.indices.size(); i+=3) {
-            Vertex v1 = vertices[face.indices[i]];
-            Vertex v2 = vertices[face.indices[i+1]];
-            Vertex v3 = vertices[face.indices[i+2]];
-
-            glm::vec3 normal = glm::normalize(glm::cross(v2.position - v1.position, v3.position - v1.position));
-
-            vertices[face.indices[i]].normal += normal;
-            vertices[face.indices[i+1]].normal += normal;
-            vertices[face.indices[i+2]].normal += normal;
-            oInfo.nVertexNormals += 3;
-        }
+    if(creaseNormals.empty()) return baseVertexIndices;
+
+    // The triangles keep the order of the mesh before the split, so the corners give the vertices.
+    const vector<unsigned int> &baseTriangles = creaseNormals.getBaseTriangles();
+    vector<unsigned int> triangles = getTriangles();
+    vector<unsigned int> indices(vertices.size(), UINT_MAX);
+    unsigned int nBaseVertices = 0;
+    for(size_t c = 0; c < triangles.size(); c++) {
+        indices[triangles[c]] = baseTriangles[c];
+        nBaseVertices = std::max(nBaseVertices, baseTriangles[c] + 1);
     }
+    for(unsigned int &index : indices) {
+        if(index == UINT_MAX) index = nBaseVertices++;
+    }
+    return indices;
+}
 
-    // Normalize each vertex normal (this effectively averages the normals)
-    for(size_t n = 0; n < vertices.size(); n++)
-        vertices[n].normal = glm::normalize(vertices[n].normal);
+/**
+ * Function for giving an object from the mesh cache the vertex that each
+ * of its vertices was split from. The hard edges are only found again when
+ * the crease angle or the use of smoothing groups is changed from the
+ * settings in the object info, which the normals were generated with.
+ * 
+ * @param indices: The index of the vertex before the split for each vertex.
+ */
+void Object::setBaseVertexIndices(vector<unsigned int> indices)
+{
+    baseVertexIndices.swap(indices);
+    baseCreaseAngle = oInfo.creaseAngle;
+    baseUseSmoothingGroups = oInfo.useSmoothingGroups;
+}
+
+/**
+ * Function for setting up the hard edges of an object from the mesh cache,
+ * by joining the vertices that were split from the same vertex again.
+ */
+void Object::restoreCreaseNormals()
+{
+    unsigned int nBaseVertices = 0;
+    for(unsigned int index : baseVertexIndices) nBaseVertices = std::max(nBaseVertices, index + 1);
+    vector<Vertex> baseVertices(nBaseVertices, Vertex(0.0f, 0.0f, 0.0f));
+    for(size_t v = 0; v < vertices.size(); v++) baseVertices[baseVertexIndices[v]] = vertices[v];
+
+    vector<unsigned int> baseTriangles = getTriangles();
+    for(unsigned int &index : baseTriangles) index = baseVertexIndices[index];
+    creaseNormals.setMesh(baseVertices, baseTriangles, getSmoothingGroups(),
+                          static_cast<NormalGenerator::Weighting>(oInfo.normalWeighting));
+    baseVertexIndices.clear();
 }
 
 /**
  * Function for creating texture coordinates that maps to a sphere. The
  * created coordinates will be mapped to each vertex. Should be called
- * if there are no texture already mapped to the vertices of the object.
+ * if there are no texture already mapped to the vertices of the object,
+ * or only to some of them, in which case those vertices keep theirs.
  * 
  * @param r: The radius of the sphere to be mapped to.
+ * @param hasTexCoords: Which vertices already have coordinates, none of them if null.
  */
-void Object::produceTextureCoords(float r)
+void Object::produceTextureCoords(float r, const vector<unsigned char> *hasTexCoords)
 {
-    for(Vertex &vertex : vertices)
+    for(size_t v = 0; v < vertices.size(); v++)
     {
+        if(hasTexCoords && (*hasTexCoords)[v]) continue;
+        Vertex &vertex = vertices[v];
         float s = acos(vertex.position.x / r) / 3.14159265;
         float t = (atan(vertex.position.z/vertex.position.y) / 3.14159265) + 0.5;
         vertex.setTexCoords(s, t);
         oInfo.nTexCoords++;
     }
+    meshRevision++;
+}
+
+/**
+ * Function for reordering the triangles and vertices of the object so that
+ * it is faster for the GPU to draw, see MeshOptimizer. The triangles of each
+ * group of faces are first ordered for the vertex cache and then for less
+ * overdraw, and the vertices are then numbered in the order they are used.
+ * The vertex cache statistics before and after are kept in the object info.
+ * 
+ * @param overdrawThreshold: How much worse the vertex cache may get to reduce overdraw.
+ */
+void Object::optimizeMesh(float overdrawThreshold)
+{
+    oInfo.cacheStatsBefore = MeshOptimizer::analyzeVertexCache(getTriangles(), vertices.size());
+
+    // Some files are already in a good order, which is then kept.
+    for(Face &face : faces) {
+        float inputACMR = MeshOptimizer::analyzeVertexCache(face.indices, vertices.size()).acmr;
+        Face optimized = face;
+        reorderTriangles(optimized, MeshOptimizer::vertexCacheOrder(face.indices, vertices.size()));
+        if(MeshOptimizer::analyzeVertexCache(optimized.indices, vertices.size()).acmr < inputACMR) {
+            face.indices.swap(optimized.indices);
+            face.smoothingGroups.swap(optimized.smoothingGroups);
+        }
+        reorderTriangles(face, MeshOptimizer::overdrawOrder(face.indices, vertices, overdrawThreshold));
+    }
+    optimizeVertexFetch();
+
+    oInfo.cacheStats = MeshOptimizer::analyzeVertexCache(getTriangles(), vertices.size());
+    oInfo.meshOptimized = true;
+    meshRevision++;
+}
+
+/**
+ * Function for building the levels of detail of the object with the
+ * quadric simplifier. Every level has about half the triangles of the
+ * level before it, and the levels stop when the simplifier can not remove
+ * enough triangles, which happens when most vertices are on seams or
+ * borders. Objects with few triangles get no levels of detail.
+ */
+void Object::buildLods()
+{
+    clearLods();
+    vector<unsigned int> indices = getTriangles();
+    if(indices.size()/3 < LOD_MIN_TRIANGLES) return;
+
+    vector<unsigned int> groups;
+    groups.reserve(indices.size()/3);
+    for(size_t f = 0; f < faces.size(); f++) groups.insert(groups.end(), faces[f].indices.size()/3, static_cast<unsigned int>(f));
+
+    MeshSimplifier simplifier(vertices, indices, groups);
+    float error = 0.0f;
+    for(size_t level = 0; level < MAX_LODS; level++) {
+        size_t nTriangles = indices.size()/3;
+        error = std::max(error, simplifier.simplify(indices, groups, nTriangles/2));
+        if(indices.size()/3 > nTriangles*4/5) break;
+
+        for(Face &face : faces) face.lodIndices.push_back(vector<unsigned int>());
+        for(size_t t = 0; t < groups.size(); t++) {
+            vector<unsigned int> &lodIndices = faces[groups[t]].lodIndices.back();
+            lodIndices.insert(lodIndices.end(), indices.begin() + 3*t, indices.begin() + 3*t + 3);
+        }
+        if(oInfo.meshOptimized) {
+            for(Face &face : faces) {
+                vector<unsigned int> &lodIndices = face.lodIndices.back();
+                vector<unsigned int> order = MeshOptimizer::vertexCacheOrder(lodIndices, vertices.size());
+                vector<unsigned int> ordered(lodIndices.size());
+                for(size_t t = 0; t < order.size(); t++) copy(&lodIndices[3*order[t]], &lodIndices[3*order[t]] + 3, &ordered[3*t]);
+                lodIndices.swap(ordered);
+            }
+        }
+        oInfo.lodErrors.push_back(error);
+        oInfo.lodTriangles.push_back(static_cast<int>(indices.size()/3));
+    }
+    oInfo.lodsOutdated = false;
+    meshRevision++;
+}
+
+/**
+ * Function for removing the levels of detail of the object, so that it
+ * is always drawn with all its triangles.
+ */
+void Object::clearLods()
+{
+    for(Face &face : faces) face.lodIndices.clear();
+    oInfo.lodErrors.clear();
+    oInfo.lodTriangles.assign(1, static_cast<int>(getTriangleCount(0)));
+    setLod(0);
+    meshRevision++;
+}
+
+/**
+ * Function for choosing the level of detail that the object is drawn with.
+ * 
+ * @param lod: The level of detail, 0 is the full mesh. Levels that do not exist are clamped to the coarsest.
+ */
+void Object::setLod(size_t lod)
+{
+    currentLod = lod < getLodCount() ? lod : getLodCount() - 1;
+    oInfo.currentLod = static_cast<int>(currentLod);
+}
+
+/**
+ * Function for getting the indices of a group of faces at a level of detail.
+ * 
+ * @param f: The index of the group of faces.
+ * @param lod: The level of detail, 0 is the full mesh.
+ * 
+ * @return Three vertex indices for each triangle.
+ */
+const vector<unsigned int>& Object::getFaceIndices(size_t f, size_t lod) const
+{
+    return lod == 0 ? faces[f].indices : faces[f].lodIndices[lod - 1];
+}
+
+/**
+ * Function for checking if indices can be stored in 16 bits when they are
+ * counted from the smallest of them. The largest 16 bit index is never used,
+ * since it restarts the primitive if primitive restart is turned on.
+ * 
+ * @param indices: The vertex indices.
+ * @param baseVertex: Set to the smallest index.
+ * 
+ * @return True if every index minus the smallest index is below 0xffff.
+ */
+bool Object::fitsShortIndices(const vector<unsigned int> &indices, unsigned int &baseVertex)
+{
+    if(indices.empty()) {
+        baseVertex = 0;
+        return true;
+    }
+    unsigned int minIndex = indices[0], maxIndex = indices[0];
+    for(unsigned int index : indices) {
+        minIndex = std::min(minIndex, index);
+        maxIndex = std::max(maxIndex, index);
+    }
+    baseVertex = minIndex;
+    return maxIndex - minIndex < 0xffff;
+}
+
+/**
+ * Function for counting the triangles of the object at a level of detail.
+ * 
+ * @param lod: The level of detail, 0 is the full mesh.
+ * 
+ * @return The number of triangles.
+ */
+size_t Object::getTriangleCount(size_t lod) const
+{
+    size_t nIndices = 0;
+    for(size_t f = 0; f < faces.size(); f++) nIndices += getFaceIndices(f, lod).size();
+    return nIndices/3;
+}
+
+/**
+ * Function for numbering the vertices in the order that the triangles
+ * first use them.
+ */
+void Object::optimizeVertexFetch()
+{
+    vector<unsigned int> remap = MeshOptimizer::vertexFetchRemap(getTriangles(), vertices.size());
+    vector<Vertex> reordered = vertices;
+    for(size_t v = 0; v < vertices.size(); v++) reordered[remap[v]] = vertices[v];
+    vertices.swap(reordered);
+    for(Face &face : faces) {
+        for(unsigned int &index : face.indices) index = remap[index];
+        for(vector<unsigned int> &lodIndices : face.lodIndices) {
+            for(unsigned int &index : lodIndices) index = remap[index];
+        }
+    }
+}
+
+/**
+ * Function for putting the triangles of a group of faces in a new order.
+ * The smoothing groups follow their triangles.
+ * 
+ * @param face: The group of faces.
+ * @param order: The index of the old triangle at each place of the new order.
+ */
+void Object::reorderTriangles(Face &face, const vector<unsigned int> &order)
+{
+    vector<unsigned int> indices(face.indices.size());
+    vector<unsigned int> groups(face.smoothingGroups.empty() ? 0 : order.size());
+    for(size_t t = 0; t < order.size(); t++) {
+        copy(face.indices.begin() + 3*order[t], face.indices.begin() + 3*order[t] + 3, indices.begin() + 3*t);
+        if(!groups.empty()) groups[t] = face.smoothingGroups[order[t]];
+    }
+    face.indices.swap(indices);
+    if(!groups.empty()) face.smoothingGroups.swap(groups);
 }
 
 /**
@@ -210,6 +467,39 @@ vector<glm::vec2> Object::getTextureCoords()
     return textureCoords;
 }
 
+/**
+ * Function for getting the indices of all triangles of the object,
+ * with the groups of faces after each other.
+ * 
+ * @return Three vertex indices for each triangle.
+ */
+vector<unsigned int> Object::getTriangles() const
+{
+    size_t nIndices = 0;
+    for(const Face &face : faces) nIndices += face.indices.size();
+
+    vector<unsigned int> triangles;
+    triangles.reserve(nIndices);
+    for(const Face &face : faces) triangles.insert(triangles.end(), face.indices.begin(), face.indices.end());
+    return triangles;
+}
+
+/**
+ * Function for getting the smoothing group of every triangle of the
+ * object, in the same order as getTriangles.
+ * 
+ * @return The smoothing group of each triangle, 0 if it has none.
+ */
+vector<unsigned int> Object::getSmoothingGroups() const
+{
+    vector<unsigned int> groups;
+    for(const Face &face : faces) {
+        size_t nTriangles = face.indices.size()/3;
+        for(size_t t = 0; t < nTriangles; t++) groups.push_back(t < face.smoothingGroups.size() ? face.smoothingGroups[t] : 0);
+    }
+    return groups;
+}
+
 /**
  * Function for finding the largest vertex length of all the objects
  * vertices. If there are no vertices in the object, 0 will be returned.
@@ -234,6 +524,29 @@ float Object::getLargestVertexLength()
     return largest_length;
 }
 
+/**
+ * Function for computing the bounding volumes of the object and of
+ * each group of faces. Must be called after the vertices have been
+ * normalized, since the volumes are in the coordinates of the object.
+ */
+void Object::computeBounds()
+{
+    bounds = BoundingVolume::fromVertices(vertices);
+    for(Face &face : faces) face.bounds = BoundingVolume::fromIndices(vertices, face.indices);
+}
+
+/**
+ * Function for building the triangle tree of the object, which is
+ * used to find where a ray hits the object. Like the bounding volumes
+ * it is in the coordinates of the object.
+ */
+void Object::buildMeshBVH()
+{
+    meshBVH.clear();
+    for(const Face &face : faces) meshBVH.addTriangles(vertices, face.indices);
+    meshBVH.build();
+}
+
 /**
  * Function for updating the model matrix that affects this particular object. Will
  * not perform the operation if the value of the input is 0. The function will alter
@@ -248,16 +561,22 @@ float Object::getLargestVertexLength()
 void Object::updateModelMatrix(glm::vec3 tVals, float scVal, glm::vec3 rVals, float rotSpeed, bool &reset)
 {
     // Check translation.
-    if(glm::compMax(tVals) != 0 || glm::compMin(tVals) != 0)
+    if(glm::compMax(tVals) != 0 || glm::compMin(tVals) != 0) {
         matModel = glm::translate(matModel, tVals);
+        transformRevision++;
+    }
 
     // Check scaling.
-    if(scVal != 0)
+    if(scVal != 0) {
         matModel = glm::scale(matModel, glm::vec3(scVal));
+        transformRevision++;
+    }
 
     // Check rotation.
-    if(glm::compMax(rVals) != 0 || glm::compMin(rVals) != 0)
+    if(glm::compMax(rVals) != 0 || glm::compMin(rVals) != 0) {
         matModel = glm::rotate(matModel, glm::radians(rotSpeed), rVals);
+        transformRevision++;
+    }
 
     // Check if object should be reset.
     resetModel(reset);
@@ -273,6 +592,7 @@ void Object::resetModel(bool &reset)
 {
     if(reset) {
         matModel = glm::mat4(1.0f);
+        transformRevision++;
         reset = false;
     }
 }
@@ -0,0 +1,200 @@
+#include "object.h"
+#include <GL/glew.h>
+#include <cstring>
+
+/**
+ * These are the functions of the object that send it to the GPU and
+ * draw it with OpenGL. They are kept apart from the rest of the object
+ * so that programs without OpenGL, like the mesh benchmark, can load
+ * and work on objects without linking OpenGL.
+ */
+
+/**
+ * Function for sending the data of the object to the vertex shader. The data
+ * that is sent for each vertex is:
+ * 
+ *      -   The Vertex position.
+ *      -   The Vertex Normal.
+ *      -   The Texture Coordinate.
+ * 
+ * If packed vertices are used, the vertices are packed into half their
+ * size first and the quantization error of the object is updated.
+ * 
+ * The materials of all faces are also sent to the material uniform buffer.
+ * 
+ * After the call the objects vertex array object, array buffer and element
+ * array buffer will be changed. The buffers are created on the first call.
+ */
+void Object::sendDataToBuffers()
+{
+    if(!vao.valid()) {
+        vao.create();
+        vBuffer.create();
+        iBuffer.create();
+        instanceBuffer.create();
+    }
+    glBindVertexArray(vao.id());
+    glBindBuffer(GL_ARRAY_BUFFER, vBuffer.id());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iBuffer.id());
+    // The indices of every level of detail follow each other. A group of
+    // faces whose vertices are close enough together is stored with 16 bit
+    // indices, counted from its first vertex.
+    size_t nLods = getLodCount();
+    indexRanges.resize(nLods*faces.size());
+    size_t iSize = 0;
+    oInfo.fullIndexBufferSize = 0;
+    for(size_t lod = 0; lod < nLods; lod++) {
+        for(size_t f = 0; f < faces.size(); f++) {
+            const vector<unsigned int> &indices = getFaceIndices(f, lod);
+            IndexRange &range = indexRanges[lod*faces.size() + f];
+            unsigned int baseVertex = 0;
+            bool useShort = oInfo.shortIndices && fitsShortIndices(indices, baseVertex);
+            range.type = useShort ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            range.baseVertex = static_cast<GLint>(baseVertex);
+            range.count = static_cast<GLsizei>(indices.size());
+            // 32 bit indices must start at a multiple of four bytes.
+            iSize = (iSize + 3) & ~static_cast<size_t>(3);
+            range.offset = iSize;
+            iSize += indices.size()*(useShort ? sizeof(unsigned short) : sizeof(unsigned int));
+            oInfo.fullIndexBufferSize += indices.size()*sizeof(unsigned int);
+        }
+    }
+    oInfo.indexBufferSize = iSize;
+
+    // Position, normal and texture coordinates, either as they are or packed.
+    PackedVertex::setAttributes(oInfo.packedVertices);
+    if(oInfo.packedVertices) {
+        vector<PackedVertex> packed = PackedVertex::pack(vertices, &oInfo.quantizationError);
+        glBufferData( GL_ARRAY_BUFFER, packed.size()*sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW );
+    } else {
+        oInfo.quantizationError = PackedVertex::QuantizationError();
+        glBufferData( GL_ARRAY_BUFFER, vertices.size()*sizeof(Vertex), vertices.data(), GL_STATIC_DRAW );
+    }
+
+    // All ranges are put together in one staging array and uploaded by a
+    // single call. Every range starts at an even byte, so the array is
+    // kept as 16 bit values and 32 bit ranges are copied in bytewise.
+    vector<unsigned short> staging(iSize/sizeof(unsigned short));
+    for(size_t lod = 0; lod < nLods; lod++) {
+        for(size_t f = 0; f < faces.size(); f++) {
+            const vector<unsigned int> &indices = getFaceIndices(f, lod);
+            const IndexRange &range = indexRanges[lod*faces.size() + f];
+            unsigned short *target = staging.data() + range.offset/sizeof(unsigned short);
+            if(range.type == GL_UNSIGNED_SHORT) {
+                for(size_t i = 0; i < indices.size(); i++) target[i] = static_cast<unsigned short>(indices[i] - range.baseVertex);
+            } else if(!indices.empty()) {
+                memcpy(target, indices.data(), indices.size()*sizeof(unsigned int));
+            }
+        }
+    }
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, iSize, staging.data(), GL_STATIC_DRAW );
+
+    // Instance matrix, one column per attribute location.
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.id());
+    for(int c = 0; c < 4; c++) {
+        glVertexAttribPointer(3 + c, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), BUFFER_OFFSET(c*sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + c, 1);
+        glEnableVertexAttribArray(3 + c);
+    }
+    instancesChanged = true;
+    uploadInstances();
+    glBindVertexArray(0);
+
+    // The material buffer is padded to whole blocks so that any block can be bound.
+    size_t nMaterials = faces.size() + 1;
+    size_t nBlocks = (nMaterials + ShaderProgram::MAX_MATERIALS - 1)/ShaderProgram::MAX_MATERIALS;
+    vector<ShaderProgram::MaterialData> materials(nBlocks*ShaderProgram::MAX_MATERIALS);
+    materials[0] = toMaterialData(defMat);
+    for(size_t f = 0; f < faces.size(); f++) materials[f + 1] = toMaterialData(faces[f].mInfo);
+    uploadedDefMat = defMat;
+
+    if(!materialBuffer.valid()) materialBuffer.create();
+    glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer.id());
+    glBufferData(GL_UNIFORM_BUFFER, materials.size()*sizeof(ShaderProgram::MaterialData), materials.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/**
+ * Function for drawing the object to the frame buffer, using a specified shader
+ * program. The uniform locations are taken from the shader program and the
+ * materials are read from the material buffer of the object, so each group of
+ * faces only needs to set which material it uses. All instances of the object
+ * are drawn by the same draw call. Groups of faces that are outside the view
+ * can be skipped.
+ * 
+ * @param program: The shader program to be used when drawing the object.
+ * @param visibleFaces: Which groups of faces to draw, all of them if null.
+ * 
+ * @return The number of draw calls that were made.
+ */
+int Object::drawObject(const ShaderProgram &program, const vector<unsigned char> *visibleFaces)
+{
+    glBindVertexArray(vao.id());
+
+    oInfo.showWireFrame? glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    oInfo.showTexture? glBindTexture(GL_TEXTURE_2D, texture.id()) : glBindTexture(GL_TEXTURE_2D, 0);
+
+    glUniformMatrix4fv(program.location(ShaderProgram::MODEL), 1, GL_FALSE, glm::value_ptr(matModel));
+    glUniform1i(program.location(ShaderProgram::SHOW_TEXTURE), oInfo.showTexture);
+    glUniform1f(program.location(ShaderProgram::ALPHA), matAlpha);
+    uploadInstances();
+
+    // The default material can be changed from the gui.
+    if(defMat.ka != uploadedDefMat.ka || defMat.kd != uploadedDefMat.kd || defMat.ks != uploadedDefMat.ks) {
+        ShaderProgram::MaterialData data = toMaterialData(defMat);
+        glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer.id());
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        uploadedDefMat = defMat;
+    }
+
+    int boundBlock = -1;
+    int nDraws = 0;
+    for(size_t f = 0; f < faces.size(); f++) {
+        const IndexRange &range = indexRanges[currentLod*faces.size() + f];
+        if((visibleFaces && !(*visibleFaces)[f]) || range.count == 0) continue;
+        int matIndex = oInfo.useDefaultMat ? 0 : f + 1;
+        int block = matIndex/ShaderProgram::MAX_MATERIALS;
+        if(block != boundBlock) {
+            size_t blockSize = ShaderProgram::MAX_MATERIALS*sizeof(ShaderProgram::MaterialData);
+            glBindBufferRange(GL_UNIFORM_BUFFER, ShaderProgram::MATERIALS_BINDING, materialBuffer.id(), block*blockSize, blockSize);
+            boundBlock = block;
+        }
+        glUniform1i(program.location(ShaderProgram::MATERIAL_INDEX), matIndex%ShaderProgram::MAX_MATERIALS);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.count, range.type, BUFFER_OFFSET(range.offset), instanceMatrices.size(), range.baseVertex);
+        nDraws++;
+    }
+
+    glBindVertexArray(0);
+    return nDraws;
+}
+
+/**
+ * Function for sending the instance matrices to the instance buffer,
+ * if they have changed since they were last sent.
+ */
+void Object::uploadInstances()
+{
+    if(!instancesChanged || !instanceBuffer.valid()) return;
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.id());
+    glBufferData(GL_ARRAY_BUFFER, instanceMatrices.size()*sizeof(glm::mat4), instanceMatrices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    instancesChanged = false;
+}
+
+/**
+ * Function for converting a material to the layout that is
+ * used in the material uniform buffer.
+ * 
+ * @param mInfo: The material to convert.
+ * 
+ * @return The material in the uniform buffer layout.
+ */
+ShaderProgram::MaterialData Object::toMaterialData(const MaterialInfo &mInfo)
+{
+    ShaderProgram::MaterialData data;
+    data.ka = glm::vec4(mInfo.ka, 1.0f);
+    data.kd = glm::vec4(mInfo.kd, 1.0f);
+    data.ks = glm::vec4(mInfo.ks, 1.0f);
+    return data;
+}
@@ -0,0 +1,673 @@
+#include "objparser.h"
+
+#include <fstream>
+#include <map>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+/**
+ * This class is a multithreaded front end for parsing object files.
+ * It produces the same attributes, shapes and materials as the
+ * tinyobj::ObjReader so that the loader can build its objects in the
+ * same way regardless of which front end that was used.
+ */
+
+namespace
+{
+    // Chunks smaller than this are not worth handing to another thread.
+    const size_t MIN_CHUNK_SIZE = 256*1024;
+
+    inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+    inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    inline const char* skipSpace(const char *p, const char *end)
+    {
+        while(p < end && isSpace(*p)) p++;
+        return p;
+    }
+
+    inline const char* findLineEnd(const char *p, const char *end)
+    {
+        const char *lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+        return lineEnd ? lineEnd : end;
+    }
+
+    /**
+     * Parses a decimal number with optional sign, fraction and exponent.
+     * The number is accumulated in double precision which is more than
+     * enough for the single precision values that are stored.
+     */
+    bool parseReal(const char *&p, const char *end, tinyobj::real_t &value)
+    {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+        const char *start = p;
+        bool negative = false;
+        if(p < end && (*p == '+' || *p == '-')) {
+            negative = *p == '-';
+            p++;
+        }
+
+        double mantissa = 0.0;
+        int exponent = 0;
+        int nDigits = 0;
+        while(p < end && isDigit(*p)) {
+            mantissa = mantissa*10.0 + (*p - '0');
+            nDigits++;
+            p++;
+        }
+        if(p < end && *p == '.') {
+            p++;
+            while(p < end && isDigit(*p)) {
+                mantissa = mantissa*10.0 + (*p - '0');
+                exponent--;
+                nDigits++;
+                p++;
+            }
+        }
+        if(nDigits == 0) {
+            p = start;
+            return false;
+        }
+
+        if(p < end && (*p == 'e' || *p == 'E')) {
+            const char *expStart = p++;
+            bool expNegative = false;
+            if(p < end && (*p == '+' || *p == '-')) {
+                expNegative = *p == '-';
+                p++;
+            }
+            if(p < end && isDigit(*p)) {
+                int expValue = 0;
+                while(p < end && isDigit(*p)) {
+                    if(expValue < 10000) expValue = expValue*10 + (*p - '0');
+                    p++;
+                }
+                exponent += expNegative ? -expValue : expValue;
+            } else {
+                p = expStart;
+            }
+        }
+
+        double result = mantissa;
+        if(exponent < 0) {
+            result = -exponent <= 22 ? result/powers[-exponent] : result*pow(10.0, exponent);
+        } else if(exponent > 0) {
+            result = exponent <= 22 ? result*powers[exponent] : result*pow(10.0, exponent);
+        }
+        value = static_cast<tinyobj::real_t>(negative ? -result : result);
+        return true;
+    }
+
+    bool parseInt(const char *&p, const char *end, int &value)
+    {
+        bool negative = false;
+        const char *start = p;
+        if(p < end && (*p == '+' || *p == '-')) {
+            negative = *p == '-';
+            p++;
+        }
+        if(p >= end || !isDigit(*p)) {
+            p = start;
+            return false;
+        }
+        int result = 0;
+        while(p < end && isDigit(*p)) {
+            result = result*10 + (*p - '0');
+            p++;
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+
+    /**
+     * Parses the given number of reals from a line, missing values are
+     * set to zero just like tinyobj does.
+     */
+    void parseReals(const char *p, const char *end, tinyobj::real_t *values, int n)
+    {
+        for(int i = 0; i < n; i++) {
+            p = skipSpace(p, end);
+            if(!parseReal(p, end, values[i])) values[i] = 0.0f;
+        }
+    }
+
+    /**
+     * Converts an index in an object file to a zero based index. Positive
+     * indices start at 1 and negative indices are relative to the number
+     * of elements that were defined before the face.
+     *
+     * @return False if the index is zero, which is not allowed.
+     */
+    inline bool resolveIndex(int index, size_t nBefore, int &resolved)
+    {
+        if(index > 0) {
+            resolved = index - 1;
+        } else if(index < 0) {
+            resolved = static_cast<int>(nBefore) + index;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    enum AttributeType { ATTRIB_NONE, ATTRIB_V, ATTRIB_VN, ATTRIB_VT };
+
+    /**
+     * Classifies a line as one of the vertex attribute records. Both
+     * passes use this so that the counts always match the parsing.
+     */
+    inline AttributeType attributeType(const char *token, const char *lineEnd)
+    {
+        size_t length = lineEnd - token;
+        if(length < 2 || token[0] != 'v') return ATTRIB_NONE;
+        if(isSpace(token[1])) return ATTRIB_V;
+        if(length < 3 || !isSpace(token[2])) return ATTRIB_NONE;
+        if(token[1] == 'n') return ATTRIB_VN;
+        if(token[1] == 't') return ATTRIB_VT;
+        return ATTRIB_NONE;
+    }
+
+    /**
+     * Checks if a point lies inside a triangle in 2D, using the crossing
+     * test from https://wrf.ecse.rpi.edu//Research/Short_Notes/pnpoly.html
+     */
+    bool pointInTriangle(const tinyobj::real_t *vx, const tinyobj::real_t *vy, tinyobj::real_t x, tinyobj::real_t y)
+    {
+        bool inside = false;
+        for(int i = 0, j = 2; i < 3; j = i++) {
+            if(((vy[i] > y) != (vy[j] > y)) &&
+               (x < (vx[j] - vx[i])*(y - vy[i])/(vy[j] - vy[i]) + vx[i])) {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    string trimLine(const char *p, const char *end)
+    {
+        while(end > p && (end[-1] == '\r' || isSpace(end[-1]))) end--;
+        return string(p, end);
+    }
+}
+
+/**
+ * Constructor of the parser.
+ *
+ * @param pool: The thread pool that the chunks are parsed on.
+ */
+ObjParser::ObjParser(ThreadPool &pool) : pool(pool)
+{
+}
+
+/**
+ * Function for parsing an object file. After a successful call the
+ * attributes, shapes and materials can be fetched from the parser.
+ *
+ * @param objFile: The path to the object file.
+ * @param mtlSearchPath: The directory where material files are searched for.
+ * @param progress: Where the parsed bytes are reported and cancelling is read, if not null.
+ *
+ * @return True if the file was parsed.
+ */
+bool ObjParser::parseFile(string objFile, string mtlSearchPath, LoadProgress *progress)
+{
+    attrib = tinyobj::attrib_t();
+    shapes.clear();
+    materials.clear();
+    warning.clear();
+    error.clear();
+
+    ifstream fs(objFile, ios::in | ios::binary);
+    if(!fs) {
+        error = "Cannot open file [" + objFile + "]\n";
+        return false;
+    }
+    fs.seekg(0, ios::end);
+    size_t fileSize = static_cast<size_t>(fs.tellg());
+    fs.seekg(0, ios::beg);
+    if(progress) {
+        progress->stage = LoadProgress::READING_FILE;
+        progress->totalBytes = fileSize;
+        progress->bytesParsed = 0;
+    }
+    vector<char> text(fileSize);
+    if(fileSize != 0) fs.read(&text[0], fileSize);
+    if(!fs) {
+        error = "Failed to read file [" + objFile + "]\n";
+        return false;
+    }
+
+    // Split the file into line aligned chunks, a few per thread for load balancing.
+    const char *data = text.data();
+    const char *dataEnd = data + fileSize;
+    size_t chunkSize = max(MIN_CHUNK_SIZE, fileSize/(pool.size()*4) + 1);
+    vector<Chunk> chunks;
+    const char *chunkBegin = data;
+    while(chunkBegin < dataEnd) {
+        const char *chunkEnd = chunkBegin + min(chunkSize, size_t(dataEnd - chunkBegin));
+        if(chunkEnd < dataEnd) {
+            chunkEnd = findLineEnd(chunkEnd, dataEnd);
+            if(chunkEnd < dataEnd) chunkEnd++;
+        }
+        Chunk chunk;
+        chunk.begin = chunkBegin;
+        chunk.end = chunkEnd;
+        chunks.push_back(chunk);
+        chunkBegin = chunkEnd;
+    }
+
+    // Pass 1: count the attributes of each chunk.
+    pool.parallelFor(chunks.size(), [this, &chunks](size_t c) { countChunk(chunks[c]); });
+
+    // The prefix sum gives each chunk the offset of its attributes.
+    size_t nV = 0, nVn = 0, nVt = 0;
+    for(Chunk &chunk : chunks) {
+        chunk.vOffset = nV;
+        chunk.vnOffset = nVn;
+        chunk.vtOffset = nVt;
+        nV += chunk.nV;
+        nVn += chunk.nVn;
+        nVt += chunk.nVt;
+    }
+    attrib.vertices.resize(nV*3);
+    attrib.normals.resize(nVn*3);
+    attrib.texcoords.resize(nVt*2);
+
+    // Pass 2: parse every chunk directly into the final arrays.
+    if(progress) progress->stage = LoadProgress::PARSING;
+    pool.parallelFor(chunks.size(), [this, &chunks, progress](size_t c) {
+        if(progress && progress->cancelled) return;
+        parseChunk(chunks[c]);
+        if(progress) progress->bytesParsed += chunks[c].end - chunks[c].begin;
+    });
+    if(progress && progress->cancelled) {
+        error = "Cancelled\n";
+        return false;
+    }
+
+    for(Chunk &chunk : chunks) error += chunk.error;
+    if(!error.empty()) return false;
+
+    mergeChunks(chunks, mtlSearchPath);
+    return true;
+}
+
+/**
+ * Function for counting the v, vn and vt records of a chunk.
+ *
+ * @param chunk: The chunk to be counted.
+ */
+void ObjParser::countChunk(Chunk &chunk) const
+{
+    const char *p = chunk.begin;
+    while(p < chunk.end) {
+        const char *lineEnd = findLineEnd(p, chunk.end);
+        switch(attributeType(skipSpace(p, lineEnd), lineEnd)) {
+            case ATTRIB_V: chunk.nV++; break;
+            case ATTRIB_VN: chunk.nVn++; break;
+            case ATTRIB_VT: chunk.nVt++; break;
+            default: break;
+        }
+        p = lineEnd + 1;
+    }
+}
+
+/**
+ * Function for parsing all records of a chunk. Vertex attributes are
+ * written directly into the attribute arrays at the offsets of the
+ * chunk. Faces and state changing records are stored in the chunk
+ * and merged afterwards.
+ *
+ * @param chunk: The chunk to be parsed.
+ */
+void ObjParser::parseChunk(Chunk &chunk)
+{
+    size_t iV = 0, iVn = 0, iVt = 0;
+    const char *p = chunk.begin;
+
+    while(p < chunk.end) {
+        const char *lineEnd = findLineEnd(p, chunk.end);
+        const char *token = skipSpace(p, lineEnd);
+        p = lineEnd + 1;
+        size_t length = lineEnd - token;
+        if(length < 2) continue;
+
+        AttributeType type = attributeType(token, lineEnd);
+        if(type == ATTRIB_V) {
+            parseReals(token + 2, lineEnd, &attrib.vertices[(chunk.vOffset + iV++)*3], 3);
+        } else if(type == ATTRIB_VN) {
+            parseReals(token + 3, lineEnd, &attrib.normals[(chunk.vnOffset + iVn++)*3], 3);
+        } else if(type == ATTRIB_VT) {
+            parseReals(token + 3, lineEnd, &attrib.texcoords[(chunk.vtOffset + iVt++)*2], 2);
+        } else if(token[0] == 'f' && isSpace(token[1])) {
+            const char *q = skipSpace(token + 2, lineEnd);
+            unsigned int nCorners = 0;
+            while(q < lineEnd && *q != '\r') {
+                Corner corner = { -1, -1, -1 };
+                int index;
+                bool valid = parseInt(q, lineEnd, index) &&
+                             resolveIndex(index, chunk.vOffset + iV, corner.v);
+                if(valid && q < lineEnd && *q == '/') {
+                    q++;
+                    if(q < lineEnd && *q != '/') {
+                        valid = parseInt(q, lineEnd, index) &&
+                                resolveIndex(index, chunk.vtOffset + iVt, corner.vt);
+                    }
+                    if(valid && q < lineEnd && *q == '/') {
+                        q++;
+                        valid = parseInt(q, lineEnd, index) &&
+                                resolveIndex(index, chunk.vnOffset + iVn, corner.vn);
+                    }
+                }
+                if(!valid) {
+                    chunk.error += "Failed to parse `f' line (e.g. a zero value for vertex index or invalid relative vertex index): " +
+                                   trimLine(token, lineEnd) + "\n";
+                    return;
+                }
+                chunk.corners.push_back(corner);
+                nCorners++;
+                q = skipSpace(q, lineEnd);
+            }
+            chunk.faceSizes.push_back(nCorners);
+        } else if((token[0] == 'o' || token[0] == 'g') && isSpace(token[1])) {
+            Event event;
+            event.type = token[0] == 'o' ? Event::OBJECT : Event::GROUP;
+            event.faceIndex = chunk.faceSizes.size();
+            event.name = trimLine(skipSpace(token + 2, lineEnd), lineEnd);
+            event.value = 0;
+            if(event.type == Event::GROUP) {
+                // Multiple group names are joined by a single space.
+                string joined;
+                const char *q = skipSpace(token + 2, lineEnd);
+                while(q < lineEnd && *q != '\r') {
+                    const char *nameEnd = q;
+                    while(nameEnd < lineEnd && !isSpace(*nameEnd) && *nameEnd != '\r') nameEnd++;
+                    if(!joined.empty()) joined += " ";
+                    joined.append(q, nameEnd);
+                    q = skipSpace(nameEnd, lineEnd);
+                }
+                event.name = joined;
+            }
+            chunk.events.push_back(event);
+        } else if(length > 6 && strncmp(token, "usemtl", 6) == 0 && isSpace(token[6])) {
+            const char *q = skipSpace(token + 7, lineEnd);
+            const char *nameEnd = q;
+            while(nameEnd < lineEnd && !isSpace(*nameEnd) && *nameEnd != '\r') nameEnd++;
+            Event event;
+            event.type = Event::USEMTL;
+            event.faceIndex = chunk.faceSizes.size();
+            event.name = string(q, nameEnd);
+            event.value = 0;
+            chunk.events.push_back(event);
+        } else if(length > 6 && strncmp(token, "mtllib", 6) == 0 && isSpace(token[6])) {
+            Event event;
+            event.type = Event::MTLLIB;
+            event.faceIndex = chunk.faceSizes.size();
+            event.name = trimLine(skipSpace(token + 7, lineEnd), lineEnd);
+            event.value = 0;
+            chunk.events.push_back(event);
+        } else if(token[0] == 's' && isSpace(token[1])) {
+            const char *q = skipSpace(token + 2, lineEnd);
+            int smoothingId = 0;
+            if(!(lineEnd - q >= 3 && strncmp(q, "off", 3) == 0)) {
+                if(!parseInt(q, lineEnd, smoothingId) || smoothingId < 0) smoothingId = 0;
+            }
+            Event event;
+            event.type = Event::SMOOTHING;
+            event.faceIndex = chunk.faceSizes.size();
+            event.value = static_cast<unsigned int>(smoothingId);
+            chunk.events.push_back(event);
+        }
+    }
+}
+
+/**
+ * Function for merging the faces of all chunks into shapes. The
+ * records that change the current shape, material and smoothing
+ * group are replayed in file order, just like tinyobj reads them.
+ * Normal and texture coordinate indices are kept as they are, but
+ * a warning is given if any of them are out of bounds.
+ *
+ * @param chunks: The parsed chunks, in file order.
+ * @param mtlSearchPath: The directory where material files are searched for.
+ */
+void ObjParser::mergeChunks(vector<Chunk> &chunks, string mtlSearchPath)
+{
+    // Material files are loaded before any faces are given a material.
+    map<string, int> materialMap;
+    tinyobj::MaterialFileReader materialReader(mtlSearchPath);
+    for(Chunk &chunk : chunks) {
+        for(Event &event : chunk.events) {
+            if(event.type != Event::MTLLIB) continue;
+
+            bool found = false;
+            size_t start = 0;
+            while(!found && start < event.name.size()) {
+                size_t nameEnd = event.name.find(' ', start);
+                if(nameEnd == string::npos) nameEnd = event.name.size();
+                string mtlName = event.name.substr(start, nameEnd - start);
+                start = nameEnd + 1;
+                if(mtlName.empty()) continue;
+
+                string mtlError;
+                found = materialReader(mtlName, &materials, &materialMap, &warning, &mtlError);
+                warning += mtlError;
+            }
+            if(!found) warning += "Failed to load material file(s). Use default material.\n";
+        }
+    }
+
+    int materialId = -1;
+    unsigned int smoothingId = 0;
+    tinyobj::shape_t shape;
+    int greatestVn = -1, greatestVt = -1;
+
+    for(Chunk &chunk : chunks) {
+        size_t nextEvent = 0;
+        size_t cornerOffset = 0;
+        for(size_t f = 0; f <= chunk.faceSizes.size(); f++) {
+            // Replay all records that come before this face.
+            while(nextEvent < chunk.events.size() && chunk.events[nextEvent].faceIndex == f) {
+                Event &event = chunk.events[nextEvent++];
+                if(event.type == Event::OBJECT || event.type == Event::GROUP) {
+                    if(shape.mesh.indices.size() > 0) shapes.push_back(shape);
+                    shape = tinyobj::shape_t();
+                    shape.name = event.name;
+                    if(event.type == Event::GROUP && event.name.empty()) warning += "Empty group name.\n";
+                } else if(event.type == Event::USEMTL) {
+                    map<string, int>::const_iterator it = materialMap.find(event.name);
+                    if(it != materialMap.end()) {
+                        materialId = it->second;
+                    } else {
+                        warning += "material [ '" + event.name + "' ] not found in .mtl\n";
+                        materialId = -1;
+                    }
+                } else if(event.type == Event::SMOOTHING) {
+                    smoothingId = event.value;
+                }
+            }
+            if(f == chunk.faceSizes.size()) break;
+
+            for(size_t i = cornerOffset; i < cornerOffset + chunk.faceSizes[f]; i++) {
+                greatestVn = max(greatestVn, chunk.corners[i].vn);
+                greatestVt = max(greatestVt, chunk.corners[i].vt);
+            }
+
+            addFace(shape, &chunk.corners[cornerOffset], chunk.faceSizes[f], materialId, smoothingId);
+            cornerOffset += chunk.faceSizes[f];
+        }
+
+        // The chunk data is not needed anymore.
+        vector<Corner>().swap(chunk.corners);
+        vector<unsigned int>().swap(chunk.faceSizes);
+    }
+    if(shape.mesh.indices.size() > 0) shapes.push_back(shape);
+
+    if(greatestVn >= static_cast<int>(attrib.normals.size()/3)) {
+        warning += "Vertex normal indices out of bounds.\n";
+    }
+    if(greatestVt >= static_cast<int>(attrib.texcoords.size()/2)) {
+        warning += "Vertex texcoord indices out of bounds.\n";
+    }
+}
+
+/**
+ * Function for adding a face to a shape. Faces with invalid vertex
+ * indices are skipped and polygons are triangulated. Quads are split
+ * along the shortest diagonal and larger polygons are ear clipped,
+ * both in the same way as tinyobj.
+ *
+ * @param shape: The shape to add the face to.
+ * @param corners: The corners of the face.
+ * @param nCorners: The number of corners of the face.
+ * @param materialId: The material of the face.
+ * @param smoothingId: The smoothing group of the face.
+ */
+void ObjParser::addFace(tinyobj::shape_t &shape, const Corner *corners, size_t nCorners, int materialId, unsigned int smoothingId)
+{
+    if(nCorners < 3) {
+        warning += "Degenerated face found\n.";
+        return;
+    }
+
+    int nV = static_cast<int>(attrib.vertices.size()/3);
+    vector<tinyobj::index_t> polygon(nCorners);
+    for(size_t i = 0; i < nCorners; i++) {
+        if(corners[i].v < 0 || corners[i].v >= nV) {
+            warning += "Face with invalid vertex index found.\n";
+            return;
+        }
+        polygon[i].vertex_index = corners[i].v;
+        polygon[i].normal_index = corners[i].vn;
+        polygon[i].texcoord_index = corners[i].vt;
+    }
+
+    vector<tinyobj::index_t> &indices = shape.mesh.indices;
+    size_t nTriangles = nCorners - 2;
+    if(nCorners == 4) {
+        // Split the quad along its shortest diagonal, like tinyobj.
+        const tinyobj::real_t *v = attrib.vertices.data();
+        tinyobj::real_t sqr02 = 0, sqr13 = 0;
+        for(int k = 0; k < 3; k++) {
+            tinyobj::real_t e02 = v[polygon[2].vertex_index*3 + k] - v[polygon[0].vertex_index*3 + k];
+            tinyobj::real_t e13 = v[polygon[3].vertex_index*3 + k] - v[polygon[1].vertex_index*3 + k];
+            sqr02 += e02*e02;
+            sqr13 += e13*e13;
+        }
+        if(sqr02 < sqr13) {
+            indices.push_back(polygon[0]); indices.push_back(polygon[1]); indices.push_back(polygon[2]);
+            indices.push_back(polygon[0]); indices.push_back(polygon[2]); indices.push_back(polygon[3]);
+        } else {
+            indices.push_back(polygon[0]); indices.push_back(polygon[1]); indices.push_back(polygon[3]);
+            indices.push_back(polygon[1]); indices.push_back(polygon[2]); indices.push_back(polygon[3]);
+        }
+    } else {
+        nTriangles = clipEars(polygon, indices);
+    }
+
+    for(size_t t = 0; t < nTriangles; t++) {
+        shape.mesh.num_face_vertices.push_back(3);
+        shape.mesh.material_ids.push_back(materialId);
+        shape.mesh.smoothing_group_ids.push_back(smoothingId);
+    }
+}
+
+/**
+ * Function for triangulating a polygon with more than four corners by
+ * ear clipping. This follows the built in triangulation of tinyobj so
+ * that both front ends give the same triangles. The polygon is projected
+ * onto the two axes that are closest to its plane, and ears are cut
+ * until only a triangle is left. If no ear can be found the rest of
+ * the polygon is dropped, just like tinyobj does.
+ *
+ * @param polygon: The corners of the polygon.
+ * @param indices: The indices that the triangles are appended to.
+ *
+ * @return The number of triangles that were added.
+ */
+size_t ObjParser::clipEars(vector<tinyobj::index_t> polygon, vector<tinyobj::index_t> &indices) const
+{
+    const vector<tinyobj::real_t> &v = attrib.vertices;
+    const tinyobj::real_t epsilon = numeric_limits<tinyobj::real_t>::epsilon();
+    size_t nCorners = polygon.size();
+
+    // Find the two axes to work in from the first corner that is not flat.
+    size_t axes[2] = {1, 2};
+    for(size_t k = 0; k < nCorners; k++) {
+        const tinyobj::real_t *v0 = &v[polygon[k].vertex_index*3];
+        const tinyobj::real_t *v1 = &v[polygon[(k + 1) % nCorners].vertex_index*3];
+        const tinyobj::real_t *v2 = &v[polygon[(k + 2) % nCorners].vertex_index*3];
+        tinyobj::real_t e0[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+        tinyobj::real_t e1[3] = { v2[0] - v1[0], v2[1] - v1[1], v2[2] - v1[2] };
+        tinyobj::real_t cx = fabs(e0[1]*e1[2] - e0[2]*e1[1]);
+        tinyobj::real_t cy = fabs(e0[2]*e1[0] - e0[0]*e1[2]);
+        tinyobj::real_t cz = fabs(e0[0]*e1[1] - e0[1]*e1[0]);
+        if(cx > epsilon || cy > epsilon || cz > epsilon) {
+            if(!(cx > cy && cx > cz)) {
+                axes[0] = 0;
+                if(cz > cx && cz > cy) axes[1] = 1;
+            }
+            break;
+        }
+    }
+
+    size_t nTriangles = 0;
+    size_t guess = 0;
+    size_t remainingIterations = nCorners;
+    size_t previousRemaining = nCorners;
+    tinyobj::real_t vx[3], vy[3];
+
+    while(polygon.size() > 3 && remainingIterations > 0) {
+        size_t nRemaining = polygon.size();
+        if(guess >= nRemaining) guess -= nRemaining;
+
+        // Only give up when a full lap has passed without cutting an ear.
+        if(previousRemaining != nRemaining) {
+            previousRemaining = nRemaining;
+            remainingIterations = nRemaining;
+        } else {
+            remainingIterations--;
+        }
+
+        for(size_t k = 0; k < 3; k++) {
+            int vi = polygon[(guess + k) % nRemaining].vertex_index;
+            vx[k] = v[vi*3 + axes[0]];
+            vy[k] = v[vi*3 + axes[1]];
+        }
+
+        // Skip the corner if its internal angle is reflex.
+        tinyobj::real_t cross = (vx[1] - vx[0])*(vy[2] - vy[1]) - (vy[1] - vy[0])*(vx[2] - vx[1]);
+        tinyobj::real_t area = (vx[0]*vy[1] - vy[0]*vx[1])*0.5f;
+        if(cross*area < 0.0f) {
+            guess++;
+            continue;
+        }
+
+        // Skip the corner if any other corner lies inside the triangle.
+        bool overlap = false;
+        for(size_t other = 3; other < nRemaining && !overlap; other++) {
+            int vi = polygon[(guess + other) % nRemaining].vertex_index;
+            overlap = pointInTriangle(vx, vy, v[vi*3 + axes[0]], v[vi*3 + axes[1]]);
+        }
+        if(overlap) {
+            guess++;
+            continue;
+        }
+
+        // The triangle is an ear, cut it off by removing its middle corner.
+        for(size_t k = 0; k < 3; k++) indices.push_back(polygon[(guess + k) % nRemaining]);
+        nTriangles++;
+        polygon.erase(polygon.begin() + (guess + 1) % nRemaining);
+    }
+
+    if(polygon.size() == 3) {
+        indices.insert(indices.end(), polygon.begin(), polygon.end());
+        nTriangles++;
+    }
+    return nTriangles;
+}
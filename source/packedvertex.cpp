@@ -0,0 +1,226 @@
+#include "packedvertex.h"
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+/**
+ * This class is a compressed copy of a vertex that is only used in the
+ * vertex buffers of the GPU.
+ */
+
+/**
+ * Function for packing vertices. Each packed vertex is unpacked again
+ * the same way as the shader does it, to measure the error.
+ *
+ * @param vertices: The vertices to pack.
+ * @param error: Set to the error of the packed vertices, if not null.
+ *
+ * @return The packed vertices, in the same order.
+ */
+vector<PackedVertex> PackedVertex::pack(const vector<Vertex> &vertices, QuantizationError *error)
+{
+    vector<PackedVertex> packed(vertices.size());
+    double sumSquared = 0.0;
+    float maxPosition = 0.0f, minNormalCosine = 1.0f, maxTexCoord = 0.0f;
+
+    for(size_t v = 0; v < vertices.size(); v++) {
+        const Vertex &vertex = vertices[v];
+        PackedVertex &p = packed[v];
+        for(int c = 0; c < 3; c++) p.position[c] = toSnorm16(vertex.position[c]);
+        p.position[3] = 0;
+        encodeNormal(vertex.normal, p.normal);
+        p.texCoords[0] = toHalf(vertex.texCoords.x);
+        p.texCoords[1] = toHalf(vertex.texCoords.y);
+
+        if(!error) continue;
+        glm::vec3 position(fromSnorm16(p.position[0]), fromSnorm16(p.position[1]), fromSnorm16(p.position[2]));
+        float distance = glm::length(position - vertex.position);
+        maxPosition = std::max(maxPosition, distance);
+        sumSquared += distance*distance;
+
+        float length = glm::length(vertex.normal);
+        if(length > 0.0f) minNormalCosine = std::min(minNormalCosine, glm::dot(decodeNormal(p.normal), vertex.normal/length));
+
+        maxTexCoord = std::max(maxTexCoord, std::abs(fromHalf(p.texCoords[0]) - vertex.texCoords.x));
+        maxTexCoord = std::max(maxTexCoord, std::abs(fromHalf(p.texCoords[1]) - vertex.texCoords.y));
+    }
+
+    if(error) {
+        error->maxPosition = maxPosition;
+        error->rmsPosition = vertices.empty() ? 0.0f : static_cast<float>(sqrt(sumSquared/vertices.size()));
+        error->maxNormalDegrees = acos(std::max(-1.0f, std::min(1.0f, minNormalCosine)))*180.0f/3.14159265f;
+        error->maxTexCoord = maxTexCoord;
+    }
+    return packed;
+}
+
+/**
+ * Function for setting the vertex attributes of positions, normals and
+ * texture coordinates for the bound array buffer. The attributes must
+ * match the vertex shader, with PACKED_VERTICES defined if packed.
+ *
+ * @param packed: If the buffer holds packed vertices instead of vertices.
+ */
+void PackedVertex::setAttributes(bool packed)
+{
+    if(packed) {
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+}
+
+/**
+ * Function for turning a value in [-1, 1] into a 16 bit normalized integer.
+ * Values outside the range are clamped.
+ *
+ * @param value: The value.
+ *
+ * @return The integer that OpenGL reads as the nearest value.
+ */
+int16_t PackedVertex::toSnorm16(float value)
+{
+    value = std::max(-1.0f, std::min(1.0f, value));
+    return static_cast<int16_t>(floor(value*32767.0f + 0.5f));
+}
+
+/**
+ * Function for reading a 16 bit normalized integer the way OpenGL does.
+ *
+ * @param value: The integer.
+ *
+ * @return The value in [-1, 1].
+ */
+float PackedVertex::fromSnorm16(int16_t value)
+{
+    return std::max(-1.0f, value/32767.0f);
+}
+
+/**
+ * Function for turning a float into a half float, rounded to the nearest
+ * half float. Values too large for a half float become infinite.
+ *
+ * @param value: The float.
+ *
+ * @return The bits of the half float.
+ */
+uint16_t PackedVertex::toHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if(floatExponent == 0xff) return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+    int exponent = static_cast<int>(floatExponent) - 127 + 15;
+    if(exponent >= 31) return static_cast<uint16_t>(sign | 0x7c00);
+
+    uint32_t half, rest, halfway;
+    if(exponent <= 0) {
+        // Too small for a normal half float, so it becomes subnormal or zero.
+        if(exponent < -10) return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        half = mantissa >> shift;
+        rest = mantissa & ((1u << shift) - 1);
+        halfway = 1u << (shift - 1);
+    } else {
+        half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+        rest = mantissa & 0x1fff;
+        halfway = 0x1000;
+    }
+    // Ties go to even. A carry out of the mantissa correctly moves to the next exponent.
+    if(rest > halfway || (rest == halfway && (half & 1))) half++;
+    return static_cast<uint16_t>(sign | half);
+}
+
+/**
+ * Function for turning a half float into a float.
+ *
+ * @param value: The bits of the half float.
+ *
+ * @return The float.
+ */
+float PackedVertex::fromHalf(uint16_t value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    if(exponent == 0) {
+        float subnormal = mantissa*5.9604645e-8f;
+        return sign ? -subnormal : subnormal;
+    }
+    uint32_t bits = exponent == 31 ? sign | 0x7f800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/**
+ * Function for folding a normal onto an octahedron and storing the two
+ * coordinates as 16 bit normalized integers. Each coordinate is rounded
+ * both down and up, and the pair that decodes closest to the normal is
+ * kept. A zero normal is stored as pointing along z.
+ *
+ * @param normal: The normal, it does not have to be of unit length.
+ * @param encoded: Set to the two coordinates.
+ */
+void PackedVertex::encodeNormal(const glm::vec3 &normal, int16_t encoded[2])
+{
+    float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if(sum == 0.0f) {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+    glm::vec3 n = normal/sum;
+    float x = n.x, y = n.y;
+    if(n.z < 0.0f) {
+        x = (1.0f - std::abs(n.y))*(n.x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::abs(n.x))*(n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    glm::vec3 unit = normal/glm::length(normal);
+    float bestCosine = -2.0f;
+    for(int i = 0; i < 4; i++) {
+        float ex = (i & 1) ? ceil(x*32767.0f) : floor(x*32767.0f);
+        float ey = (i & 2) ? ceil(y*32767.0f) : floor(y*32767.0f);
+        int16_t candidate[2] = {
+            static_cast<int16_t>(std::max(-32767.0f, std::min(32767.0f, ex))),
+            static_cast<int16_t>(std::max(-32767.0f, std::min(32767.0f, ey)))
+        };
+        float cosine = glm::dot(decodeNormal(candidate), unit);
+        if(cosine > bestCosine) {
+            bestCosine = cosine;
+            encoded[0] = candidate[0];
+            encoded[1] = candidate[1];
+        }
+    }
+}
+
+/**
+ * Function for unfolding a normal from the octahedron, the same way as
+ * the vertex shader does it.
+ *
+ * @param encoded: The two coordinates.
+ *
+ * @return The normal, of unit length.
+ */
+glm::vec3 PackedVertex::decodeNormal(const int16_t encoded[2])
+{
+    glm::vec3 n(fromSnorm16(encoded[0]), fromSnorm16(encoded[1]), 0.0f);
+    n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return n/glm::length(n);
+}
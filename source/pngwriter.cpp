@@ -0,0 +1,320 @@
+#include "pngwriter.h"
+#include <cstdlib>
+#include <fstream>
+
+/**
+ * This class writes 8 bit images as PNG files, without any library.
+ */
+
+// The lengths and distances of deflate, with how many extra bits each code has.
+static const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                     35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                       8193, 12289, 16385, 24577 };
+static const int DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static const int WINDOW_SIZE = 32768;
+static const int MAX_MATCH = 258;
+static const int HASH_BITS = 15;
+// How many earlier positions with the same hash are tried for each match.
+static const int MAX_CHAIN = 16;
+
+// Writes bits with the first bit in the lowest bit of each byte, as deflate wants them.
+struct BitWriter {
+    vector<unsigned char> &out;
+    uint32_t buffer = 0;
+    int nBits = 0;
+
+    BitWriter(vector<unsigned char> &out) : out(out) {}
+
+    void bits(uint32_t value, int count)
+    {
+        buffer |= value << nBits;
+        nBits += count;
+        while(nBits >= 8) {
+            out.push_back(static_cast<unsigned char>(buffer & 0xff));
+            buffer >>= 8;
+            nBits -= 8;
+        }
+    }
+
+    // Huffman codes are stored with their first bit as the highest bit.
+    void code(uint32_t value, int count)
+    {
+        uint32_t reversed = 0;
+        for(int i = 0; i < count; i++) reversed |= ((value >> i) & 1) << (count - 1 - i);
+        bits(reversed, count);
+    }
+
+    void literal(int value)
+    {
+        if(value <= 143) code(0x30 + value, 8);
+        else if(value <= 255) code(0x190 + value - 144, 9);
+        else if(value <= 279) code(value - 256, 7);
+        else code(0xc0 + value - 280, 8);
+    }
+
+    void flush()
+    {
+        if(nBits > 0) out.push_back(static_cast<unsigned char>(buffer & 0xff));
+        buffer = 0;
+        nBits = 0;
+    }
+};
+
+/**
+ * Function for writing an image to a PNG file.
+ *
+ * @param fileName: The file to write.
+ * @param width: The width of the image in pixels.
+ * @param height: The height of the image in pixels.
+ * @param nChannels: 1 for grey, 2 for grey and alpha, 3 for RGB and 4 for RGBA.
+ * @param pixels: The rows of the image, without any padding.
+ * @param bottomUp: If the first row is the bottom of the image, as OpenGL reads it.
+ *
+ * @return True if the file was written.
+ */
+bool PngWriter::write(const string &fileName, int width, int height, int nChannels,
+                      const unsigned char *pixels, bool bottomUp)
+{
+    vector<unsigned char> png = encode(width, height, nChannels, pixels, bottomUp);
+    if(png.empty()) return false;
+    ofstream file(fileName, ios::binary);
+    file.write(reinterpret_cast<const char*>(png.data()), png.size());
+    return static_cast<bool>(file);
+}
+
+/**
+ * Function for encoding an image as a PNG file in memory.
+ *
+ * @param width: The width of the image in pixels.
+ * @param height: The height of the image in pixels.
+ * @param nChannels: 1 for grey, 2 for grey and alpha, 3 for RGB and 4 for RGBA.
+ * @param pixels: The rows of the image, without any padding.
+ * @param bottomUp: If the first row is the bottom of the image.
+ *
+ * @return The bytes of the file, empty if the image can not be encoded.
+ */
+vector<unsigned char> PngWriter::encode(int width, int height, int nChannels,
+                                        const unsigned char *pixels, bool bottomUp)
+{
+    static const unsigned char COLOR_TYPES[] = { 0, 4, 2, 6 };
+    vector<unsigned char> png;
+    if(width <= 0 || height <= 0 || nChannels < 1 || nChannels > 4 || !pixels) return png;
+
+    static const unsigned char SIGNATURE[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    png.assign(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+
+    vector<unsigned char> header(13, 0);
+    for(int i = 0; i < 4; i++) {
+        header[i] = static_cast<unsigned char>(width >> (24 - 8*i));
+        header[4 + i] = static_cast<unsigned char>(height >> (24 - 8*i));
+    }
+    header[8] = 8;
+    header[9] = COLOR_TYPES[nChannels - 1];
+    addChunk(png, "IHDR", header);
+
+    vector<unsigned char> filtered;
+    filterRows(width, height, nChannels, pixels, bottomUp, filtered);
+    addChunk(png, "IDAT", deflate(filtered));
+    addChunk(png, "IEND", vector<unsigned char>());
+    return png;
+}
+
+/**
+ * Function for filtering the rows of an image. Each row is tried with
+ * the None, Sub, Up and Paeth filters, and the one whose bytes are
+ * closest to zero is kept, since those compress best.
+ *
+ * @param width: The width of the image in pixels.
+ * @param height: The height of the image in pixels.
+ * @param nChannels: The number of bytes per pixel.
+ * @param pixels: The rows of the image.
+ * @param bottomUp: If the first row is the bottom of the image.
+ * @param filtered: Set to the filtered rows, each starting with its filter type.
+ */
+void PngWriter::filterRows(int width, int height, int nChannels, const unsigned char *pixels,
+                           bool bottomUp, vector<unsigned char> &filtered)
+{
+    size_t rowBytes = static_cast<size_t>(width)*nChannels;
+    filtered.resize((rowBytes + 1)*height);
+    vector<unsigned char> candidate[4];
+    for(int f = 0; f < 4; f++) candidate[f].resize(rowBytes);
+    static const unsigned char FILTER_TYPES[] = { 0, 1, 2, 4 };
+
+    const unsigned char *prior = NULL;
+    for(int y = 0; y < height; y++) {
+        const unsigned char *row = pixels + rowBytes*(bottomUp ? height - 1 - y : y);
+        long bestSum = -1;
+        int best = 0;
+        for(int f = 0; f < 4; f++) {
+            long sum = 0;
+            for(size_t i = 0; i < rowBytes; i++) {
+                int a = i >= static_cast<size_t>(nChannels) ? row[i - nChannels] : 0;
+                int b = prior ? prior[i] : 0;
+                int c = prior && i >= static_cast<size_t>(nChannels) ? prior[i - nChannels] : 0;
+                int predicted = 0;
+                if(f == 1) predicted = a;
+                else if(f == 2) predicted = b;
+                else if(f == 3) {
+                    int p = a + b - c;
+                    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+                    predicted = pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+                }
+                unsigned char value = static_cast<unsigned char>(row[i] - predicted);
+                candidate[f][i] = value;
+                sum += value < 128 ? value : 256 - value;
+            }
+            if(bestSum < 0 || sum < bestSum) {
+                bestSum = sum;
+                best = f;
+            }
+        }
+        unsigned char *out = &filtered[(rowBytes + 1)*y];
+        out[0] = FILTER_TYPES[best];
+        copy(candidate[best].begin(), candidate[best].end(), out + 1);
+        prior = row;
+    }
+}
+
+/**
+ * Function for compressing data as a zlib stream with a single deflate
+ * block that uses the fixed Huffman codes.
+ *
+ * @param data: The data to compress.
+ *
+ * @return The zlib stream.
+ */
+vector<unsigned char> PngWriter::deflate(const vector<unsigned char> &data)
+{
+    vector<unsigned char> out;
+    out.reserve(data.size()/4 + 64);
+    out.push_back(0x78);
+    out.push_back(0x01);
+
+    BitWriter writer(out);
+    writer.bits(1, 1);
+    writer.bits(1, 2);
+
+    const int n = static_cast<int>(data.size());
+    vector<int> head(1 << HASH_BITS, -1);
+    vector<int> previous(WINDOW_SIZE, -1);
+    auto hash = [&data](int i) {
+        uint32_t h = (static_cast<uint32_t>(data[i]) << 16) | (data[i + 1] << 8) | data[i + 2];
+        return static_cast<int>((h*2654435761u) >> (32 - HASH_BITS));
+    };
+    auto insert = [&](int i) {
+        int h = hash(i);
+        previous[i % WINDOW_SIZE] = head[h];
+        head[h] = i;
+    };
+
+    int i = 0;
+    while(i < n) {
+        int bestLength = 0, bestDistance = 0;
+        if(i + 2 < n) {
+            int candidate = head[hash(i)];
+            int maxLength = std::min(MAX_MATCH, n - i);
+            for(int chain = 0; candidate >= 0 && i - candidate <= WINDOW_SIZE && chain < MAX_CHAIN; chain++) {
+                int length = 0;
+                while(length < maxLength && data[candidate + length] == data[i + length]) length++;
+                if(length > bestLength) {
+                    bestLength = length;
+                    bestDistance = i - candidate;
+                    if(length == maxLength) break;
+                }
+                int next = previous[candidate % WINDOW_SIZE];
+                if(next >= candidate) break;
+                candidate = next;
+            }
+            insert(i);
+        }
+
+        if(bestLength >= 3) {
+            int code = 28;
+            while(LENGTH_BASE[code] > bestLength) code--;
+            writer.literal(257 + code);
+            writer.bits(bestLength - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+            int distanceCode = 29;
+            while(DISTANCE_BASE[distanceCode] > bestDistance) distanceCode--;
+            writer.code(distanceCode, 5);
+            writer.bits(bestDistance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+            for(int j = i + 1; j < i + bestLength && j + 2 < n; j++) insert(j);
+            i += bestLength;
+        } else {
+            writer.literal(data[i]);
+            i++;
+        }
+    }
+    writer.literal(256);
+    writer.flush();
+
+    uint32_t adler = adler32(data);
+    for(int b = 3; b >= 0; b--) out.push_back(static_cast<unsigned char>(adler >> (8*b)));
+    return out;
+}
+
+/**
+ * Function for computing the CRC that ends each PNG chunk.
+ *
+ * @param data: The bytes.
+ * @param size: The number of bytes.
+ * @param crc: The CRC of the bytes before these, to continue from.
+ *
+ * @return The CRC.
+ */
+uint32_t PngWriter::crc32(const unsigned char *data, size_t size, uint32_t crc)
+{
+    static uint32_t table[256];
+    static bool tableBuilt = false;
+    if(!tableBuilt) {
+        for(uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for(int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        tableBuilt = true;
+    }
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+/**
+ * Function for computing the checksum that ends a zlib stream.
+ *
+ * @param data: The uncompressed bytes.
+ *
+ * @return The checksum.
+ */
+uint32_t PngWriter::adler32(const vector<unsigned char> &data)
+{
+    uint32_t a = 1, b = 0;
+    for(size_t i = 0; i < data.size(); i++) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+/**
+ * Function for adding a chunk to a PNG file.
+ *
+ * @param png: The file so far.
+ * @param type: The four letter type of the chunk.
+ * @param data: The contents of the chunk.
+ */
+void PngWriter::addChunk(vector<unsigned char> &png, const char *type, const vector<unsigned char> &data)
+{
+    uint32_t size = static_cast<uint32_t>(data.size());
+    for(int b = 3; b >= 0; b--) png.push_back(static_cast<unsigned char>(size >> (8*b)));
+    size_t typeStart = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    uint32_t crc = crc32(&png[typeStart], png.size() - typeStart);
+    for(int b = 3; b >= 0; b--) png.push_back(static_cast<unsigned char>(crc >> (8*b)));
+}
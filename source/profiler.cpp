@@ -0,0 +1,247 @@
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+
+/**
+ * This class measures where the time of each frame goes, on the CPU
+ * and on the GPU.
+ */
+
+/**
+ * Creates a profiler with room for MAX_FRAMES frames.
+ */
+Profiler::Profiler() : epoch(chrono::steady_clock::now()), frames(MAX_FRAMES) {}
+
+/**
+ * Function for getting the profiler that the whole program shares.
+ *
+ * @return The shared profiler.
+ */
+Profiler& Profiler::shared()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+/**
+ * Function for starting a new frame on the calling thread. The oldest
+ * frame is overwritten once MAX_FRAMES frames are kept. The results of
+ * earlier GPU passes are read first, if the GPU has them ready.
+ */
+void Profiler::beginFrame()
+{
+    readQueries();
+    if(paused) return;
+
+    Frame &frame = frames[nFrames % MAX_FRAMES];
+    for(GpuPass &pass : frame.gpuPasses) {
+        if(pass.query != NO_QUERY) freeQueries.push_back(pass.query);
+    }
+    frame.number = nFrames;
+    frame.scopes.clear();
+    frame.gpuPasses.clear();
+    frameThread = this_thread::get_id();
+    depth = 0;
+    inFrame = true;
+    frame.start = now();
+}
+
+/**
+ * Function for ending the current frame, which is then kept.
+ */
+void Profiler::endFrame()
+{
+    if(!inFrame) return;
+    Frame &frame = frames[nFrames % MAX_FRAMES];
+    frame.duration = now() - frame.start;
+    nFrames++;
+    inFrame = false;
+}
+
+/**
+ * Function for starting a scope in the current frame. Scopes that
+ * are started while another scope is open are nested inside it.
+ *
+ * @param name: The name of the scope, it must outlive the profiler.
+ *
+ * @return The index of the scope, or NO_SCOPE if it is not recorded.
+ */
+size_t Profiler::beginScope(const char *name)
+{
+    if(!recording()) return NO_SCOPE;
+    Frame &frame = frames[nFrames % MAX_FRAMES];
+    Scope scope = { name, now() - frame.start, -1, depth++ };
+    frame.scopes.push_back(scope);
+    return frame.scopes.size() - 1;
+}
+
+/**
+ * Function for ending a scope of the current frame.
+ *
+ * @param scope: The index that beginScope returned.
+ */
+void Profiler::endScope(size_t scope)
+{
+    if(scope == NO_SCOPE || !recording()) return;
+    Frame &frame = frames[nFrames % MAX_FRAMES];
+    if(scope >= frame.scopes.size()) return;
+    frame.scopes[scope].end = now() - frame.start;
+    depth--;
+}
+
+/**
+ * Function for starting to time the GPU commands of a pass. GPU
+ * passes can not be nested, since only one GL_TIME_ELAPSED query
+ * can be active at a time.
+ *
+ * @param name: The name of the pass, it must outlive the profiler.
+ *
+ * @return True if the pass is timed and endGpuPass must be called.
+ */
+bool Profiler::beginGpuPass(const char *name)
+{
+    if(!recording() || gpuPassActive) return false;
+    size_t query;
+    if(freeQueries.empty()) {
+        queries.push_back(GLQuery());
+        queries.back().create();
+        query = queries.size() - 1;
+    } else {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    }
+    Frame &frame = frames[nFrames % MAX_FRAMES];
+    GpuPass pass = { name, now() - frame.start, -1, query };
+    frame.gpuPasses.push_back(pass);
+    glBeginQuery(GL_TIME_ELAPSED, queries[query].id());
+    gpuPassActive = true;
+    return true;
+}
+
+/**
+ * Function for ending the GPU pass that is being timed.
+ */
+void Profiler::endGpuPass()
+{
+    if(!gpuPassActive) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuPassActive = false;
+}
+
+/**
+ * Function for deleting all queries. Must be called before the
+ * OpenGL context is destroyed, GPU passes that are not read yet are
+ * left without a time.
+ */
+void Profiler::releaseQueries()
+{
+    for(Frame &frame : frames) {
+        for(GpuPass &pass : frame.gpuPasses) pass.query = NO_QUERY;
+    }
+    queries.clear();
+    freeQueries.clear();
+    gpuPassActive = false;
+}
+
+/**
+ * Function for getting the number of frames that are kept.
+ *
+ * @return The number of frames, at most MAX_FRAMES.
+ */
+size_t Profiler::frameCount() const
+{
+    return static_cast<size_t>(std::min<uint64_t>(nFrames, MAX_FRAMES));
+}
+
+/**
+ * Function for getting a kept frame.
+ *
+ * @param age: How many frames before the last finished frame, 0 is the last one.
+ *
+ * @return The frame, the age must be less than frameCount.
+ */
+const Profiler::Frame& Profiler::frame(size_t age) const
+{
+    return frames[(nFrames - 1 - age) % MAX_FRAMES];
+}
+
+/**
+ * Function for writing all kept frames as a Chrome trace. The CPU
+ * scopes are on one thread and the GPU passes on another, each GPU
+ * pass placed where the CPU started it.
+ *
+ * @param fileName: The file to write.
+ *
+ * @return True if the file was written.
+ */
+bool Profiler::writeChromeTrace(const string &fileName) const
+{
+    ofstream file(fileName);
+    if(!file) return false;
+
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    char event[256];
+    for(size_t age = frameCount(); age-- > 0;) {
+        const Frame &f = frame(age);
+        snprintf(event, sizeof(event), ",\n{\"name\":\"Frame %llu\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+                 static_cast<unsigned long long>(f.number), f.start/1000.0, f.duration/1000.0);
+        file << event;
+        for(const Scope &scope : f.scopes) {
+            int64_t end = scope.end < 0 ? f.duration : scope.end;
+            snprintf(event, sizeof(event), ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+                     scope.name, (f.start + scope.start)/1000.0, (end - scope.start)/1000.0);
+            file << event;
+        }
+        for(const GpuPass &pass : f.gpuPasses) {
+            if(pass.time < 0) continue;
+            snprintf(event, sizeof(event), ",\n{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":2}",
+                     pass.name, (f.start + pass.cpuStart)/1000.0, pass.time/1000.0);
+            file << event;
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+/**
+ * Function for getting the time since the profiler was created.
+ *
+ * @return The time in nanoseconds.
+ */
+int64_t Profiler::now() const
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+/**
+ * Function for checking if scopes on the calling thread are recorded.
+ *
+ * @return True if a frame is being recorded on this thread.
+ */
+bool Profiler::recording() const
+{
+    return inFrame && this_thread::get_id() == frameThread;
+}
+
+/**
+ * Function for reading the GPU passes whose results are ready, without
+ * waiting for the ones that are not. Their queries can then be reused.
+ */
+void Profiler::readQueries()
+{
+    for(Frame &frame : frames) {
+        for(GpuPass &pass : frame.gpuPasses) {
+            if(pass.query == NO_QUERY) continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[pass.query].id(), GL_QUERY_RESULT_AVAILABLE, &available);
+            if(!available) continue;
+            GLuint64 time = 0;
+            glGetQueryObjectui64v(queries[pass.query].id(), GL_QUERY_RESULT, &time);
+            pass.time = static_cast<int64_t>(time);
+            freeQueries.push_back(pass.query);
+            pass.query = NO_QUERY;
+        }
+    }
+}
@@ -0,0 +1,249 @@
+#include "regressionreport.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+/**
+ * This class checks headless renders for regressions against golden
+ * images and the history of earlier runs.
+ */
+
+// How much a blurred pixel may differ, from 0 to 1, before it counts as different.
+static const float PIXEL_THRESHOLD = 0.05f;
+// The smallest changes that are flagged, below these the measurements are mostly noise.
+static const double TIME_NOISE_FLOOR = 0.5;
+static const double RSS_NOISE_FLOOR = 4.0;
+
+/**
+ * Function for turning an RGB image into blurred luma and chroma
+ * planes. Each pixel becomes the mean of the 3x3 pixels around it.
+ *
+ * @param pixels: The RGB image.
+ * @param width: The width of the image.
+ * @param height: The height of the image.
+ * @param planes: Set to the luma, blue chroma and red chroma, from 0 to 1.
+ */
+static void toBlurredLumaChroma(const unsigned char *pixels, int width, int height, vector<float> planes[3])
+{
+    vector<float> sharp[3];
+    for(int c = 0; c < 3; c++) {
+        sharp[c].resize(static_cast<size_t>(width)*height);
+        planes[c].resize(sharp[c].size());
+    }
+    for(size_t i = 0; i < sharp[0].size(); i++) {
+        float r = pixels[3*i]/255.0f, g = pixels[3*i + 1]/255.0f, b = pixels[3*i + 2]/255.0f;
+        sharp[0][i] = 0.299f*r + 0.587f*g + 0.114f*b;
+        sharp[1][i] = -0.1687f*r - 0.3313f*g + 0.5f*b;
+        sharp[2][i] = 0.5f*r - 0.4187f*g - 0.0813f*b;
+    }
+    for(int c = 0; c < 3; c++) {
+        for(int y = 0; y < height; y++) {
+            for(int x = 0; x < width; x++) {
+                float sum = 0.0f;
+                int n = 0;
+                for(int dy = -1; dy <= 1; dy++) {
+                    for(int dx = -1; dx <= 1; dx++) {
+                        int sx = x + dx, sy = y + dy;
+                        if(sx < 0 || sy < 0 || sx >= width || sy >= height) continue;
+                        sum += sharp[c][static_cast<size_t>(sy)*width + sx];
+                        n++;
+                    }
+                }
+                planes[c][static_cast<size_t>(y)*width + x] = sum/n;
+            }
+        }
+    }
+}
+
+/**
+ * Function for comparing a rendered image to its golden image. Chroma
+ * counts half as much as luma, since the eye sees it less sharply.
+ *
+ * @param imageFile: The rendered image.
+ * @param goldenFile: The golden image.
+ *
+ * @return The difference, not compared if either image could not be read.
+ */
+RegressionReport::ImageDifference RegressionReport::compareImages(const string &imageFile, const string &goldenFile)
+{
+    ImageDifference difference;
+    int width, height, goldenWidth, goldenHeight, nChannels;
+    unsigned char *image = stbi_load(imageFile.c_str(), &width, &height, &nChannels, 3);
+    unsigned char *golden = stbi_load(goldenFile.c_str(), &goldenWidth, &goldenHeight, &nChannels, 3);
+    if(image && golden) {
+        difference.compared = true;
+        if(width == goldenWidth && height == goldenHeight) {
+            vector<float> imagePlanes[3], goldenPlanes[3];
+            toBlurredLumaChroma(image, width, height, imagePlanes);
+            toBlurredLumaChroma(golden, width, height, goldenPlanes);
+            size_t nDiffering = 0;
+            float maxDifference = 0.0f;
+            for(size_t i = 0; i < imagePlanes[0].size(); i++) {
+                float dY = imagePlanes[0][i] - goldenPlanes[0][i];
+                float dCb = imagePlanes[1][i] - goldenPlanes[1][i];
+                float dCr = imagePlanes[2][i] - goldenPlanes[2][i];
+                float d = sqrt(dY*dY + 0.5f*(dCb*dCb + dCr*dCr));
+                if(d > PIXEL_THRESHOLD) nDiffering++;
+                maxDifference = std::max(maxDifference, d);
+            }
+            difference.differingFraction = static_cast<double>(nDiffering)/imagePlanes[0].size();
+            difference.maxDifference = maxDifference;
+        }
+    }
+    if(image) stbi_image_free(image);
+    if(golden) stbi_image_free(golden);
+    return difference;
+}
+
+/**
+ * Function for starting a new measurement of the peak memory use, so
+ * that peakRss only covers what happens after this call. Only possible
+ * on Linux, elsewhere the peak of the whole program is measured.
+ */
+void RegressionReport::resetPeakRss()
+{
+#ifdef __linux__
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+#endif
+}
+
+/**
+ * Function for getting the largest amount of memory that the program
+ * has had in RAM since resetPeakRss was called.
+ *
+ * @return The peak resident set size in MB, 0 if it can not be measured.
+ */
+double RegressionReport::peakRss()
+{
+#ifdef __linux__
+    ifstream status("/proc/self/status");
+    string line;
+    while(getline(status, line)) {
+        if(line.compare(0, 6, "VmHWM:") == 0) return atof(line.c_str() + 6)/1024.0;
+    }
+#endif
+    return 0.0;
+}
+
+/**
+ * Function for comparing the measurements of this run to the earlier
+ * runs in the history file. Every regression is added to the problems.
+ *
+ * @param historyFile: The CSV file with the earlier runs.
+ * @param maxSlowdown: How much slower or larger than before a value may be, 0.2 is 20%.
+ *
+ * @return The number of regressions that were found.
+ */
+size_t RegressionReport::checkHistory(const string &historyFile, double maxSlowdown)
+{
+    vector<Record> history = readHistory(historyFile);
+    size_t nProblems = problems.size();
+    for(const Record &record : records) {
+        vector<double> loadTimes, cpuFrameTimes, gpuFrameTimes, peakRsses;
+        for(size_t i = history.size(); i-- > 0 && loadTimes.size() < HISTORY_RUNS;) {
+            if(history[i].model != record.model) continue;
+            loadTimes.push_back(history[i].loadTime);
+            cpuFrameTimes.push_back(history[i].cpuFrameTime);
+            gpuFrameTimes.push_back(history[i].gpuFrameTime);
+            peakRsses.push_back(history[i].peakRss);
+        }
+        checkValue(record.model, "load time", "ms", record.loadTime, loadTimes, maxSlowdown, TIME_NOISE_FLOOR);
+        checkValue(record.model, "cpu frame time", "ms", record.cpuFrameTime, cpuFrameTimes, maxSlowdown, TIME_NOISE_FLOOR);
+        checkValue(record.model, "gpu frame time", "ms", record.gpuFrameTime, gpuFrameTimes, maxSlowdown, TIME_NOISE_FLOOR);
+        checkValue(record.model, "peak memory", "MB", record.peakRss, peakRsses, maxSlowdown, RSS_NOISE_FLOOR);
+    }
+    return problems.size() - nProblems;
+}
+
+/**
+ * Function for adding the measurements of this run to the history file.
+ * The file is created with a header if it does not exist.
+ *
+ * @param historyFile: The CSV file with the earlier runs.
+ *
+ * @return True if the run was added.
+ */
+bool RegressionReport::appendHistory(const string &historyFile) const
+{
+    bool exists = ifstream(historyFile).good();
+    ofstream file(historyFile, ios::app);
+    if(!file) return false;
+    if(!exists) file << "run,model,load_ms,cpu_frame_ms,gpu_frame_ms,peak_rss_mb,image_difference\n";
+
+    char run[32];
+    time_t now = time(NULL);
+    strftime(run, sizeof(run), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    char row[512];
+    for(const Record &record : records) {
+        string model = record.model;
+        replace(model.begin(), model.end(), ',', '_');
+        snprintf(row, sizeof(row), "%s,%s,%.3f,%.3f,%.3f,%.1f,%.5f\n", run, model.c_str(), record.loadTime,
+                 record.cpuFrameTime, record.gpuFrameTime, record.peakRss, record.imageDifference);
+        file << row;
+    }
+    return static_cast<bool>(file);
+}
+
+/**
+ * Function for reading the earlier runs from the history file.
+ *
+ * @param historyFile: The CSV file with the earlier runs.
+ *
+ * @return The records of the earlier runs, oldest first.
+ */
+vector<RegressionReport::Record> RegressionReport::readHistory(const string &historyFile)
+{
+    vector<Record> history;
+    ifstream file(historyFile);
+    string line;
+    while(getline(file, line)) {
+        if(line.empty() || line.compare(0, 4, "run,") == 0) continue;
+        vector<string> fields;
+        stringstream stream(line);
+        string field;
+        while(getline(stream, field, ',')) fields.push_back(field);
+        if(fields.size() < 7) continue;
+
+        Record record;
+        record.model = fields[1];
+        record.loadTime = atof(fields[2].c_str());
+        record.cpuFrameTime = atof(fields[3].c_str());
+        record.gpuFrameTime = atof(fields[4].c_str());
+        record.peakRss = atof(fields[5].c_str());
+        record.imageDifference = atof(fields[6].c_str());
+        history.push_back(record);
+    }
+    return history;
+}
+
+/**
+ * Function for flagging a value that has grown compared to the median
+ * of its earlier values. Values that were never measured are skipped.
+ *
+ * @param model: The model the value belongs to.
+ * @param name: What the value is.
+ * @param unit: The unit of the value.
+ * @param value: The value of this run.
+ * @param previous: The values of the earlier runs.
+ * @param maxSlowdown: How much larger than the median the value may be, 0.2 is 20%.
+ * @param noiseFloor: How much larger the value must at least be to be flagged.
+ */
+void RegressionReport::checkValue(const string &model, const char *name, const char *unit, double value,
+                                  vector<double> previous, double maxSlowdown, double noiseFloor)
+{
+    if(previous.empty()) return;
+    sort(previous.begin(), previous.end());
+    double median = previous[previous.size()/2];
+    if(median <= 0.0 || value <= median*(1.0 + maxSlowdown) || value - median <= noiseFloor) return;
+
+    char problem[256];
+    snprintf(problem, sizeof(problem), "Regression in %s: %s is %.2f %s, the median of the last %zu runs is %.2f %s (+%.0f%%)",
+             model.c_str(), name, value, unit, previous.size(), median, unit, 100.0*(value/median - 1.0));
+    problems.push_back(problem);
+}
@@ -1,4 +1,7 @@
 #include "renderer.h"
+#include "regressionreport.h"
+#include "threadpool.h"
+#include <ctime>
 
 using namespace std;
 
@@ -14,6 +17,16 @@ using namespace std;
  *      2024-01-08: v1.0, first version.
  */
 
+// The fixed cameras that each object is rendered from in headless mode.
+static const struct {
+    const char *name;
+    glm::vec3 position;
+} CAPTURE_VIEWS[] = {
+    { "front", glm::vec3(0.0f, 0.0f, 2.0f) },
+    { "side", glm::vec3(2.0f, 0.0f, 0.0f) },
+    { "above", glm::vec3(1.2f, 1.4f, 1.2f) }
+};
+
 /**
  * Initialize the renderer with depth test and
  * loads the two shader files.
@@ -24,28 +37,29 @@ void Renderer::initialize()
     glEnable(GL_DEPTH_TEST);
 
     // Create and initialize a program object with shaders
-    program = initProgram("./source/shaders/vshader.glsl", "./source/shaders/fshader.glsl");
-
-    Loader loader;
-}
+    program = ShaderProgram(initProgram("./source/shaders/vshader.glsl", "./source/shaders/fshader.glsl"));
+    packedProgram = ShaderProgram(initProgram("./source/shaders/vshader.glsl", "./source/shaders/fshader.glsl", "#define PACKED_VERTICES\n"));
 
-/**
- * Loads the object data to the arraybuffer and indices to the index array
- * to prepare the object to be shown.
- * 
- * @param fileName The name of the *.obj file to load the geometry from.
- */
-void Renderer::loadGeometry(string filePath, string fileName)
-{
-    Object newObject = loader.parseFile(objectParseSuccess, fileName, filePath + "/");
-    
-    // Only load the object if it successfully parsed the object file.
-    if(newObject.oInfo.objectLoaded) {
-        glUseProgram(program);
-        newObject.sendDataToBuffers();
-        glUseProgram(0);
-        wContext.objects.push_back(newObject);
+    // The multi draw variant of the shaders needs OpenGL 4.3.
+    wContext.rInfo.multiDrawSupported = GLEW_VERSION_4_3;
+    if(wContext.rInfo.multiDrawSupported) {
+        multiDrawProgram = ShaderProgram(initProgram("./source/shaders/vshader.glsl", "./source/shaders/fshader.glsl", "#define MULTI_DRAW\n"));
+        packedMultiDrawProgram = ShaderProgram(initProgram("./source/shaders/vshader.glsl", "./source/shaders/fshader.glsl", "#define MULTI_DRAW\n#define PACKED_VERTICES\n"));
+    } else {
+        wContext.rInfo.useMultiDraw = false;
     }
+
+    packedVertices = wContext.rInfo.usePackedVertices;
+    shortIndices = wContext.rInfo.useShortIndices;
+
+    // The per frame values are shared by all objects through a uniform buffer.
+    frameBuffer.create();
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer.id());
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ShaderProgram::FrameData), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, ShaderProgram::FRAME_DATA_BINDING, frameBuffer.id());
+
+    Loader loader;
 }
 
 /**
@@ -55,11 +69,11 @@ void Renderer::loadGeometry(string filePath, string fileName)
 void Renderer::debugShader(void) const
 {
     GLint  logSize;
-    glGetProgramiv( program, GL_INFO_LOG_LENGTH, &logSize );
+    glGetProgramiv( program.id(), GL_INFO_LOG_LENGTH, &logSize );
     if (logSize > 0) {
         std::cerr << "Failure in shader "  << std::endl;
         char logMsg[logSize+1];
-        glGetProgramInfoLog( program, logSize, nullptr, &(logMsg[0]) );
+        glGetProgramInfoLog( program.id(), logSize, nullptr, &(logMsg[0]) );
         std::cerr << "Shader info log: " << logMsg << std::endl;
     }
 }
@@ -67,15 +81,58 @@ void Renderer::debugShader(void) const
 /**
  * Function for rendering all the loaded objects in the
  * scene. If no objects has been loaded nohting will 
- * happen.
+ * happen. The camera and light values of the frame are
+ * uploaded once, before any object is drawn.
+ * 
+ * If multi draw is enabled, all objects that can share
+ * the same state are drawn by the scene batch in a
+ * single draw call, and only the remaining objects are
+ * drawn one by one.
  */
 void Renderer::display()
 {
-    glUseProgram(program);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    for(Object &object : wContext.objects) {
-        object.drawObject(program);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer.id());
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ShaderProgram::FrameData), &frameData);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    {
+        PROFILE_SCOPE("Update buffers");
+        updateBufferFormat();
+    }
+    {
+        PROFILE_SCOPE("Cull scene");
+        cullScene();
+    }
+    {
+        PROFILE_SCOPE("Select LODs");
+        selectLods();
+    }
+
+    wContext.rInfo.nDrawCalls = 0;
+    bool multiDraw = wContext.rInfo.useMultiDraw;
+    if(multiDraw) {
+        PROFILE_SCOPE("Batched draw");
+        unsigned int geometryRevision = wContext.getSceneSummary().geometryRevision;
+        if(!sceneBatch.isBuiltFor(geometryRevision, packedVertices, shortIndices)) {
+            sceneBatch.rebuild(wContext.objects, geometryRevision, packedVertices, shortIndices);
+        } else {
+            sceneBatch.update(wContext.objects);
+        }
+        glUseProgram(packedVertices ? packedMultiDrawProgram.id() : multiDrawProgram.id());
+        wContext.rInfo.nDrawCalls += sceneBatch.draw(wContext.objects, visibleFaces);
+    }
+
+    const ShaderProgram &objectProgram = packedVertices ? packedProgram : program;
+    glUseProgram(objectProgram.id());
+    {
+        PROFILE_SCOPE("Object draws");
+        for(size_t o = 0; o < wContext.objects.size(); o++) {
+            Object &object = wContext.objects[o];
+            if(!visibleObjects[o] || (multiDraw && SceneBatch::canBatch(object))) continue;
+            wContext.rInfo.nDrawCalls += object.drawObject(objectProgram, &visibleFaces[o]);
+        }
     }
     // Not to be called in release...
     debugShader();
@@ -83,6 +140,179 @@ void Renderer::display()
     glUseProgram(0);
 }
 
+/**
+ * Function for uploading the buffers of all objects again when the
+ * setting for packed vertices or 16 bit indices is changed. The scene
+ * batch follows on its own, since it is built for one format.
+ */
+void Renderer::updateBufferFormat()
+{
+    const WorldContext::RenderInfo &rInfo = wContext.rInfo;
+    if(packedVertices == rInfo.usePackedVertices && shortIndices == rInfo.useShortIndices) return;
+    packedVertices = rInfo.usePackedVertices;
+    shortIndices = rInfo.useShortIndices;
+    for(Object &object : wContext.objects) {
+        object.oInfo.packedVertices = packedVertices;
+        object.oInfo.shortIndices = shortIndices;
+        object.sendDataToBuffers();
+    }
+}
+
+/**
+ * Function for finding which objects and material groups that are
+ * inside the view frustum. The visible instances are found with the
+ * scene BVH, or without it by testing the bounding sphere of every
+ * instance in one pass over the spheres and then the bounding box of
+ * the instances that pass. The material groups of the visible instances
+ * are tested with spheres and boxes in the same way. An object or group
+ * is visible if any of its instances is.
+ */
+void Renderer::cullScene()
+{
+    const vector<Object> &objects = wContext.objects;
+    WorldContext::RenderInfo &rInfo = wContext.rInfo;
+    visibleObjects.assign(objects.size(), 1);
+    visibleFaces.resize(objects.size());
+    rInfo.nObjectsCulled = rInfo.nGroupsCulled = 0;
+    rInfo.nObjectsDrawn = static_cast<int>(objects.size());
+    rInfo.nGroupsDrawn = 0;
+    for(size_t o = 0; o < objects.size(); o++) {
+        visibleFaces[o].assign(objects[o].faces.size(), 1);
+        rInfo.nGroupsDrawn += objects[o].faces.size();
+    }
+    if(!rInfo.useFrustumCulling) return;
+
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    frustum.extract(frameData.P*frameData.V);
+    visibleObjects.assign(objects.size(), 0);
+    vector<CullEntry> visibleInstances;
+
+    if(rInfo.useSceneBVH) {
+        const SceneBVH &sceneBVH = wContext.getSceneBVH();
+        sceneBVH.queryFrustum(frustum, visibleItems);
+        for(size_t i : visibleItems) {
+            const SceneBVH::Item &item = sceneBVH.item(i);
+            CullEntry entry = { item.objectIndex, 0, item.M };
+            visibleObjects[item.objectIndex] = 1;
+            visibleInstances.push_back(entry);
+        }
+    } else {
+        // One sphere for each instance of each object.
+        cullSpheres.clear();
+        cullEntries.clear();
+        for(size_t o = 0; o < objects.size(); o++) {
+            for(const glm::mat4 &instance : objects[o].getInstanceMatrices()) {
+                CullEntry entry = { o, 0, objects[o].matModel*instance };
+                glm::vec3 center = glm::vec3(entry.M*glm::vec4(objects[o].bounds.center, 1.0f));
+                cullSpheres.add(center, objects[o].bounds.radius*Frustum::maxScale(entry.M));
+                cullEntries.push_back(entry);
+            }
+        }
+        frustum.cullSpheres(cullSpheres, sphereVisible);
+
+        for(size_t i = 0; i < cullEntries.size(); i++) {
+            const CullEntry &entry = cullEntries[i];
+            if(!sphereVisible[i] || !frustum.intersects(objects[entry.objectIndex].bounds, entry.M)) continue;
+            visibleObjects[entry.objectIndex] = 1;
+            visibleInstances.push_back(entry);
+        }
+    }
+
+    // One sphere for each material group of the visible instances. The
+    // group of an object with a single group has the same volume as the
+    // object, so it is visible exactly when the object is. The groups of
+    // culled objects are cleared too, since the batch only reads the groups.
+    cullSpheres.clear();
+    cullEntries.clear();
+    for(size_t o = 0; o < objects.size(); o++) {
+        if(!visibleObjects[o] || objects[o].faces.size() > 1) visibleFaces[o].assign(objects[o].faces.size(), 0);
+    }
+    for(const CullEntry &instance : visibleInstances) {
+        const Object &object = objects[instance.objectIndex];
+        if(object.faces.size() <= 1) continue;
+        float scale = Frustum::maxScale(instance.M);
+        for(size_t f = 0; f < object.faces.size(); f++) {
+            CullEntry entry = { instance.objectIndex, f, instance.M };
+            glm::vec3 center = glm::vec3(entry.M*glm::vec4(object.faces[f].bounds.center, 1.0f));
+            cullSpheres.add(center, object.faces[f].bounds.radius*scale);
+            cullEntries.push_back(entry);
+        }
+    }
+    frustum.cullSpheres(cullSpheres, sphereVisible);
+
+    for(size_t i = 0; i < cullEntries.size(); i++) {
+        const CullEntry &entry = cullEntries[i];
+        unsigned char &visible = visibleFaces[entry.objectIndex][entry.faceIndex];
+        if(visible || !sphereVisible[i]) continue;
+        visible = frustum.intersects(objects[entry.objectIndex].faces[entry.faceIndex].bounds, entry.M);
+    }
+
+    rInfo.nObjectsDrawn = rInfo.nGroupsDrawn = 0;
+    for(size_t o = 0; o < objects.size(); o++) {
+        int nFaces = static_cast<int>(objects[o].faces.size());
+        if(!visibleObjects[o]) {
+            rInfo.nObjectsCulled++;
+            rInfo.nGroupsCulled += nFaces;
+            continue;
+        }
+        rInfo.nObjectsDrawn++;
+        for(unsigned char visible : visibleFaces[o]) visible ? rInfo.nGroupsDrawn++ : rInfo.nGroupsCulled++;
+    }
+
+    double cullFrameTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    rInfo.cullTime = 0.95*rInfo.cullTime + 0.05*cullFrameTime;
+}
+
+/**
+ * Function for picking the level of detail that each visible object is
+ * drawn with. The error of a level is the largest distance it moves the
+ * surface, and it is projected to pixels at the nearest point of the
+ * bounding sphere of each instance. The coarsest level whose projected
+ * error is within the allowed pixel error is used, and an object with
+ * several instances uses the finest level that any instance needs. The
+ * triangles that are drawn are counted at the same time.
+ */
+void Renderer::selectLods()
+{
+    vector<Object> &objects = wContext.objects;
+    WorldContext::RenderInfo &rInfo = wContext.rInfo;
+    const WorldContext::CameraInfo &cInfo = wContext.cInfo;
+    float viewHeight = static_cast<float>(std::max(1, height()));
+    float tanHalfFov = tan(glm::radians(cInfo.fov)*0.5f);
+
+    rInfo.nTrianglesDrawn = 0;
+    for(size_t o = 0; o < objects.size(); o++) {
+        Object &object = objects[o];
+        if(!visibleObjects[o]) continue;
+
+        size_t lod = 0;
+        if(rInfo.useLods && object.getLodCount() > 1) {
+            lod = object.getLodCount() - 1;
+            for(const glm::mat4 &instance : object.getInstanceMatrices()) {
+                glm::mat4 M = object.matModel*instance;
+                float scale = Frustum::maxScale(M);
+                float pixelsPerUnit;
+                if(cInfo.perspProj) {
+                    float depth = -(frameData.V*M*glm::vec4(object.bounds.center, 1.0f)).z;
+                    float nearest = std::max(depth - object.bounds.radius*scale, cInfo.nearPlane);
+                    pixelsPerUnit = viewHeight/(2.0f*tanHalfFov*nearest);
+                } else {
+                    pixelsPerUnit = viewHeight/(2.0f*cInfo.top);
+                }
+                while(lod > 0 && object.getLodError(lod)*scale*pixelsPerUnit > rInfo.lodPixelError) lod--;
+                if(lod == 0) break;
+            }
+        }
+        object.setLod(lod);
+
+        long long nTriangles = 0;
+        for(size_t f = 0; f < object.faces.size(); f++) {
+            if(visibleFaces[o][f]) nTriangles += object.getFaceIndices(f, lod).size()/3;
+        }
+        rInfo.nTrianglesDrawn += nTriangles*object.getInstanceCount();
+    }
+}
+
 /**
  * Updates the information regarding the object in the program. 
  * 
@@ -92,6 +322,7 @@ void Renderer::display()
  *      - Rotations
  *      - Resetting the model matrix
  *      - Load a new object in the program
+ *      - Generated normals after a new crease angle
  * 
  * The object that where these updates occurs are the selected
  * object only.
@@ -100,60 +331,39 @@ void Renderer::display()
  */
 void Renderer::updateObject(int objIndex)
 {
-    glUseProgram(program);
-
+    if(wContext.updateVertexNormals(objIndex)) wContext.objects[objIndex].sendDataToBuffers();
     wContext.updateMatrices();
-    
-    GLuint locView;
-    locView = glGetUniformLocation( program, "V");
-    glUniformMatrix4fv(locView, 1, GL_FALSE, glm::value_ptr(wContext.matView));
-    GLuint locProj;
-    locProj = glGetUniformLocation( program, "P");
-    glUniformMatrix4fv(locProj, 1, GL_FALSE, glm::value_ptr(wContext.matProj));
-    glUseProgram(0);    
+    frameData.V = wContext.matView;
+    frameData.P = wContext.matProj;
 }
 
 /**
  * Function for updating the camera values
- * in the shader files.
+ * that are sent to the shader files.
  */
 void Renderer::updateCamera()
 {
-    glUseProgram(program);
-    GLuint locCam;
-    locCam = glGetUniformLocation(program, "camPos");
-    glUniform3fv(locCam, 1, glm::value_ptr(wContext.cInfo.pZero));
-    glUseProgram(0);
+    frameData.camPos = glm::vec4(wContext.cInfo.pZero, 1.0f);
 }
 
 /**
  * Functoin for updating the values of the
- * light in the shader files.
+ * light that are sent to the shader files.
  */
 void Renderer::updateLight()
 {
-    glUseProgram(program);
-    
-    GLuint locAmbi;
-    locAmbi = glGetUniformLocation(program, "la");
-    glUniform4fv(locAmbi, 1, glm::value_ptr(wContext.ambientLight));
-
-    GLuint locLightPos;
-    locLightPos = glGetUniformLocation(program, "lsPos");
-    glUniform4fv(locLightPos, 1, glm::value_ptr(wContext.light.position));
-
-    GLuint locLightColor;
-    locLightColor = glGetUniformLocation(program, "lsColor");
-    glUniform4fv(locLightColor, 1, glm::value_ptr(wContext.light.color));
-    glUseProgram(0);
+    frameData.la = wContext.ambientLight;
+    frameData.lsPos = wContext.light.position;
+    frameData.lsColor = wContext.light.color;
 }
 
 /**
- * Loads the object with the specified object file name.
- * If any errors are occurs these will be added to the 
- * output of the function and later displayed in the 
- * logger.
+ * Starts loading the object with the specified object file name in
+ * the background. The object is added to the scene by
+ * finishLoads once it has been loaded, so the program keeps
+ * rendering in the meantime.
  * 
+ * @param objPath: The directory of the object file.
  * @param objName: The name of the object file.
  * 
  * @return The output string.
@@ -161,39 +371,118 @@ void Renderer::updateLight()
 string Renderer::loadObjectFromGui(string objPath, string objName)
 {
     if(!objName.empty()) {
-        loader.outputString += "\nLoading " + objName + "...\n";
-        loadGeometry(objPath, objName);
-        if(objectParseSuccess) {
-            loader.outputString += "\nSuccessfully loaded \"" + objName + "\"\n\n";
-        } else {
-            loader.outputString += "\nFailed to load \"" + objName + "\" at path: " + objPath + "/" + objName + " \n returning...\n";
+        loadOutput += "\nLoading " + objName + "...\n";
+        objectLoads.start(objName, objPath + "/", wContext.lInfo);
+    } else {
+        loadOutput += "\nNo file specified, returning.\n\n";
+    }
+    return loadOutput;
+}
+
+/**
+ * Finishes the loads that have been running in the background. The
+ * textures get their share of the upload budget every frame, and at
+ * most one object and one texture are added to the scene.
+ * 
+ * @return The output string if a load was finished, otherwise an empty string.
+ */
+string Renderer::finishLoads()
+{
+    textureLoads.upload(static_cast<size_t>(wContext.rInfo.textureUploadBudget*1048576.0f));
+    string objectOutput = finishObjectLoad();
+    string textureOutput = finishTextureLoad();
+    return objectOutput.empty() && textureOutput.empty() ? "" : loadOutput;
+}
+
+/**
+ * Takes an object that has been loaded in the background, sends it to
+ * the GPU and adds it to the scene. At most one object is taken each
+ * frame, so that the uploads of several objects are spread over frames.
+ * Any errors are added to the output and later displayed in the logger.
+ * 
+ * @return The output string if an object was taken, otherwise an empty string.
+ */
+string Renderer::finishObjectLoad()
+{
+    Object newObject("");
+    bool success;
+    string output;
+    if(!objectLoads.takeFinished(newObject, success, output)) return "";
+
+    string objName = newObject.fileName;
+    loadOutput += "\n" + objName + ":\n" + output;
+    if(success && newObject.oInfo.objectLoaded) {
+        newObject.oInfo.packedVertices = packedVertices;
+        newObject.oInfo.shortIndices = shortIndices;
+        newObject.sendDataToBuffers();
+        if(newObject.oInfo.indexBufferSize < newObject.oInfo.fullIndexBufferSize) {
+            char sizeBuffer[128];
+            snprintf(sizeBuffer, sizeof(sizeBuffer), "\tIndex buffer is %.1f KB with 16 bit indices, saved %.1f KB\n",
+                     newObject.oInfo.indexBufferSize/1024.0, (newObject.oInfo.fullIndexBufferSize - newObject.oInfo.indexBufferSize)/1024.0);
+            loadOutput += sizeBuffer;
         }
+        wContext.addObject(move(newObject));
+        loadOutput += "\nSuccessfully loaded \"" + objName + "\"\n\n";
     } else {
-        loader.outputString += "\nNo file specified, returning.\n\n";
+        loadOutput += "\nFailed to load \"" + objName + "\", returning...\n";
+    }
+    return loadOutput;
+}
+
+/**
+ * Takes a texture that has been loaded in the background and gives it
+ * to the object it was loaded for. The old texture of the object is
+ * deleted. If the object has been removed since, the texture is dropped.
+ * 
+ * @return The output string if a texture was taken, otherwise an empty string.
+ */
+string Renderer::finishTextureLoad()
+{
+    TextureLoader::Result result;
+    if(!textureLoads.takeFinished(result)) return "";
+
+    loadOutput += "\n" + result.fileName + ":\n" + result.output;
+    if(!result.success) {
+        loadOutput += "\nFailed to load texture \"" + result.fileName + "\", returning...\n";
+        return loadOutput;
+    }
+    if(result.objectIndex < 0 || result.objectIndex >= (int)wContext.objects.size() ||
+       wContext.objects[result.objectIndex].fileName != result.objectName) {
+        loadOutput += "\nThe object \"" + result.objectName + "\" is gone, texture not used.\n";
+        return loadOutput;
     }
-    return loader.getOutputString();
+    Object &object = wContext.objects[result.objectIndex];
+    object.texture = move(result.texture);
+    object.oInfo.hasTexture = true;
+    object.oInfo.showTexture = true;
+    wContext.dirty.objects = true;
+    loadOutput += "\nSuccessfully loaded texture \"" + result.fileName + "\"\n";
+    return loadOutput;
 }
 
 /**
- * Attempts to load the specified texture for the currently
- * selected object. If any errors occurs when trying to
- * load the texture it will be displayed in the output string.
+ * Starts loading the specified texture for the currently selected
+ * object in the background. The texture is given to the object by
+ * finishLoads once it has been uploaded, until then the object keeps
+ * its old texture.
  * 
- * @param textureName: The name of the texture file.
+ * @param texName: The name of the texture file.
+ * @param texPath: The directory of the texture file.
  * @param objIndex: The index of the selected object.
  * 
  * @return The output string.
  */
 string Renderer::loadTextureFromGui(string texName, string texPath, int objIndex)
 {
-    string outputString = "";
-    if(!texName.empty()) {
-        outputString += "\nLoading " + texName + "...\n";
-        outputString += loadTexture(texName, texPath, wContext.objects[objIndex].texture, objIndex);
+    if(texName.empty()) {
+        loadOutput += "\nNo texture specified, returning.\n\n";
+    } else if(objIndex < 0 || objIndex >= (int)wContext.objects.size()) {
+        loadOutput += "\nNo object to put the texture on, returning.\n\n";
     } else {
-        outputString += "\nNo texture specified, returning.\n\n";
+        loadOutput += "\nLoading texture " + texName + "...\n";
+        textureLoads.start(texName, texPath, objIndex, wContext.objects[objIndex].fileName);
     }
-    return outputString;
+    return loadOutput;
 }
 
 /**
@@ -205,50 +494,444 @@ string Renderer::loadTextureFromGui(string texName, string texPath, int objIndex
  */
 void Renderer::resetTransformations(int objIndex) 
 {
-    glUseProgram(program);
-
     // Reset the model matrix to the identity matrix.
     wContext.objects[objIndex].resetModel(wContext.tInfo.reset);
+}
+
+/**
+ * Function for rendering object files to PNG files without showing
+ * them. Each object is rendered alone from the fixed cameras in
+ * CAPTURE_VIEWS, by the same shaders as in the window, and every view
+ * is written to <name>_<view>.png in the output directory.
+ * 
+ * Objects are loaded in the background while others are rendered, and
+ * the frames are read back and written while the next objects are
+ * rendered. When everything is written the throughput is printed and
+ * compared to the target.
+ * 
+ * The images can be compared to golden images, and the load time,
+ * frame times and peak memory of each model can be compared to, and
+ * added to, a history file. The peak memory of a model also includes
+ * the loads that run at the same time, unless one object is loaded
+ * at a time.
+ * 
+ * @param objFiles: The paths of the object files.
+ * @param hInfo: Where to write the images, and what to check.
+ * 
+ * @return 0 on success, 1 if any model failed, 3 if a regression was
+ *         found and 2 if the throughput target was missed.
+ */
+int Renderer::renderToFiles(const vector<string> &objFiles, const HeadlessInfo &hInfo)
+{
+    FrameCapture capture;
+    if(!capture.create(width(), height())) {
+        cerr << "Could not create a framebuffer to render into." << endl;
+        return 1;
+    }
+    wContext.lInfo.useMeshCache = hInfo.useMeshCache;
+
+    const size_t nViews = sizeof(CAPTURE_VIEWS)/sizeof(CAPTURE_VIEWS[0]);
+    size_t maxLoads = hInfo.maxLoads > 0 ? hInfo.maxLoads : std::max(1u, thread::hardware_concurrency());
+    size_t nStarted = 0;
+    size_t nFailed = 0;
+    RegressionReport report;
+    vector<RegressionReport::Record> records;
+    vector<string> imageFiles;
+    vector<GLQuery> gpuQueries;
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+
+    while(nStarted < objFiles.size() || !objectLoads.empty()) {
+        while(nStarted < objFiles.size() && objectLoads.size() < maxLoads) {
+            const string &objFile = objFiles[nStarted++];
+            size_t slash = objFile.find_last_of('/');
+            string objPath = slash == string::npos ? "." : objFile.substr(0, slash);
+            string objName = slash == string::npos ? objFile : objFile.substr(slash + 1);
+            RegressionReport::resetPeakRss();
+            objectLoads.start(objName, objPath + "/", wContext.lInfo);
+        }
+
+        Object newObject("");
+        bool success;
+        string output;
+        if(!objectLoads.takeFinished(newObject, success, output)) {
+            capture.collect(false);
+            this_thread::sleep_for(chrono::milliseconds(1));
+            continue;
+        }
+        string objName = newObject.fileName;
+        if(!success || !newObject.oInfo.objectLoaded) {
+            cerr << "Failed to load \"" << objName << "\":" << output << endl;
+            nFailed++;
+            continue;
+        }
+
+        RegressionReport::Record record;
+        record.model = objName;
+        record.loadTime = newObject.oInfo.loadTime;
+        wContext.clearObjects();
+        newObject.oInfo.packedVertices = packedVertices;
+        newObject.oInfo.shortIndices = shortIndices;
+        newObject.sendDataToBuffers();
+        wContext.addObject(move(newObject));
+        updateLight();
+
+        string stem = objName.substr(0, objName.find_last_of('.'));
+        double cpuTime = 0.0;
+        for(size_t v = 0; v < nViews; v++) {
+            wContext.cInfo.pZero = CAPTURE_VIEWS[v].position;
+            wContext.cInfo.pRef = glm::vec3(0.0f, 0.0f, 0.0f);
+            wContext.cInfo.camDir = wContext.cInfo.pRef - wContext.cInfo.pZero;
+            wContext.dirty.camera = true;
+            updateObject(0);
+            updateCamera();
 
-    GLuint locModel;
-    locModel = glGetUniformLocation( program, "M");
-    glUniformMatrix4fv(locModel, 1, GL_FALSE, glm::value_ptr(wContext.objects[objIndex].matModel));
-    glUseProgram(0); 
+            capture.bind();
+            gpuQueries.push_back(GLQuery());
+            gpuQueries.back().create();
+            chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, gpuQueries.back().id());
+            display();
+            glEndQuery(GL_TIME_ELAPSED);
+            cpuTime += chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+            wContext.dirty.clear();
+
+            imageFiles.push_back(stem + "_" + CAPTURE_VIEWS[v].name + ".png");
+            capture.readBack(hInfo.outputDir + "/" + imageFiles.back());
+            capture.collect(false);
+        }
+        record.cpuFrameTime = cpuTime/nViews;
+        record.peakRss = RegressionReport::peakRss();
+        records.push_back(record);
+    }
+    capture.finish();
+    capture.unbind();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    double modelsPerSecond = seconds > 0.0 ? records.size()/seconds : 0.0;
+    nFailed += capture.failedCount();
+
+    for(size_t r = 0; r < records.size(); r++) {
+        GLuint64 gpuTime = 0;
+        for(size_t v = 0; v < nViews; v++) {
+            GLuint64 viewTime = 0;
+            glGetQueryObjectui64v(gpuQueries[r*nViews + v].id(), GL_QUERY_RESULT, &viewTime);
+            gpuTime += viewTime;
+        }
+        records[r].gpuFrameTime = gpuTime/1.0e6/nViews;
+    }
+
+    // The images are compared in parallel, each view on its own.
+    if(!hInfo.goldenDir.empty()) {
+        vector<RegressionReport::ImageDifference> differences(imageFiles.size());
+        ThreadPool::shared().parallelFor(imageFiles.size(), [&](size_t i) {
+            differences[i] = RegressionReport::compareImages(hInfo.outputDir + "/" + imageFiles[i], hInfo.goldenDir + "/" + imageFiles[i]);
+        });
+        char problem[256];
+        for(size_t i = 0; i < imageFiles.size(); i++) {
+            RegressionReport::Record &record = records[i/nViews];
+            if(!differences[i].compared) {
+                snprintf(problem, sizeof(problem), "No golden image %s/%s", hInfo.goldenDir.c_str(), imageFiles[i].c_str());
+                if(hInfo.allowMissingGolden) cout << problem << endl;
+                else report.addProblem(problem);
+                continue;
+            }
+            record.imageDifference = std::max(record.imageDifference, differences[i].differingFraction);
+            if(differences[i].differingFraction <= hInfo.imageTolerance) continue;
+            snprintf(problem, sizeof(problem), "Image %s differs from the golden image in %.2f%% of the pixels, at most %.2f%% may differ",
+                     imageFiles[i].c_str(), 100.0*differences[i].differingFraction, 100.0*hInfo.imageTolerance);
+            report.addProblem(problem);
+        }
+    }
+
+    char line[256];
+    cout << "Model                      Load ms    CPU ms    GPU ms    RSS MB   Differs" << endl;
+    for(const RegressionReport::Record &record : records) {
+        report.add(record);
+        snprintf(line, sizeof(line), "%-24s %9.2f %9.3f %9.3f %9.1f", record.model.c_str(), record.loadTime,
+                 record.cpuFrameTime, record.gpuFrameTime, record.peakRss);
+        cout << line;
+        if(record.imageDifference >= 0.0) {
+            snprintf(line, sizeof(line), " %8.2f%%", 100.0*record.imageDifference);
+            cout << line;
+        }
+        cout << endl;
+    }
+    if(!hInfo.historyFile.empty()) {
+        report.checkHistory(hInfo.historyFile, hInfo.maxSlowdown);
+        if(!report.appendHistory(hInfo.historyFile)) cerr << "Could not write " << hInfo.historyFile << endl;
+    }
+    for(const string &problem : report.getProblems()) cout << problem << endl;
+
+    snprintf(line, sizeof(line), "Rendered %zu models in %.2f s, %.2f models/s, %zu images written to %s, %zu failed",
+             records.size(), seconds, modelsPerSecond, capture.writtenCount(), hInfo.outputDir.c_str(), nFailed);
+    cout << line << endl;
+
+    if(nFailed > 0) return 1;
+    if(!report.getProblems().empty()) return 3;
+    if(hInfo.targetModelsPerSecond > 0.0) {
+        bool met = modelsPerSecond >= hInfo.targetModelsPerSecond;
+        snprintf(line, sizeof(line), "Target of %.2f models/s %s", hInfo.targetModelsPerSecond, met ? "met" : "missed");
+        cout << line << endl;
+        if(!met) return 2;
+    }
+    return 0;
 }
 
 /**
- * Function for loading a texture for the currently
- * selected object. It will overwrite the texture value
- * of the selected object which will cause the texture
- * to change.
+ * Function for checking that the scene frees everything it has on the
+ * GPU. The buffers, vertex arrays and textures that are alive with an
+ * empty scene are counted, the files are loaded and drawn, and after the
+ * scene is cleared the counts must be back where they were. Image files
+ * are put as textures on the object before them.
  * 
- * @param texName: The name of the texture file.
- * @param texPath: The path to the texture file.
- * @param texture: The actual texture values for the selected object.
- * @param selectedObject: The index of the selected object.
+ * Moving a loaded object must also keep its vertices and its GPU
+ * objects, since an object is only ever moved and never copied.
  * 
- * @return The output string.
+ * @param files: The paths of the object and image files.
+ * 
+ * @return 0 if everything was freed and moved, 1 otherwise.
  */
-string Renderer::loadTexture(string texName, string texPath,  GLuint &texture, int selectedObject)
+int Renderer::checkResources(const vector<string> &files)
 {
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // The renderer keeps some buffers of its own, also for an empty scene.
+    display();
+    const size_t baseline[3] = { GLBuffer::aliveCount(), GLVertexArray::aliveCount(), GLTexture::aliveCount() };
+    vector<string> problems;
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    for(const string &file : files) {
+        if(!loadAndWait(file)) problems.push_back("Could not load " + file);
+    }
+    display();
+    display();
+    char line[256];
+    snprintf(line, sizeof(line), "%zu objects loaded: %zu buffers, %zu vertex arrays, %zu textures (empty scene: %zu, %zu, %zu)",
+             wContext.objects.size(), GLBuffer::aliveCount(), GLVertexArray::aliveCount(), GLTexture::aliveCount(),
+             baseline[0], baseline[1], baseline[2]);
+    cout << line << endl;
 
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load((texPath + "/" + texName).c_str(), &width, &height, &nrChannels, 0);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        return "\nFailed to load texture \"" + texName + "\" at path: " + texPath + "/" + texName + " \n returning...\n";
+    if(!wContext.objects.empty()) {
+        Object &object = wContext.objects[0];
+        const Vertex *vertices = object.vertices.data();
+        GLuint vao = object.vao.id();
+        size_t nBuffers = GLBuffer::aliveCount();
+        Object moved(move(object));
+        bool kept = moved.vertices.data() == vertices && moved.vao.id() == vao && !object.vao.valid();
+        object = move(moved);
+        kept = kept && object.vertices.data() == vertices && object.vao.id() == vao;
+        if(!kept || GLBuffer::aliveCount() != nBuffers) problems.push_back("Moving " + object.fileName + " copied or lost its data");
+    }
+
+    wContext.clearObjects();
+    display();
+    const size_t alive[3] = { GLBuffer::aliveCount(), GLVertexArray::aliveCount(), GLTexture::aliveCount() };
+    const char *names[3] = { "buffers", "vertex arrays", "textures" };
+    for(int r = 0; r < 3; r++) {
+        if(alive[r] == baseline[r]) continue;
+        snprintf(line, sizeof(line), "%zu %s are alive after the scene was cleared, %zu were alive before loading",
+                 alive[r], names[r], baseline[r]);
+        problems.push_back(line);
+    }
+
+    for(const string &problem : problems) cout << problem << endl;
+    cout << (problems.empty() ? "All GPU objects were freed" : "The check failed") << endl;
+    return problems.empty() ? 0 : 1;
+}
+
+/**
+ * Function for measuring how long it takes to build the gui with every
+ * window open. Each object file is loaded alone and selected, so the
+ * windows that show the object show it, and DrawGui is timed over the
+ * given number of frames after a few frames to warm up.
+ * 
+ * @param objFiles: The paths of the object files, such as a small and a large one.
+ * @param nFrames: How many frames are measured for each object.
+ * 
+ * @return 0 if every object was loaded, 1 otherwise.
+ */
+int Renderer::benchmarkGui(const vector<string> &objFiles, int nFrames)
+{
+    const int nWarmupFrames = 10;
+    wInfo.showOverlay = wInfo.showObjInfWindow = wInfo.showCamWindow = wInfo.showKeyRefWindow = true;
+    wInfo.showLogWindow = wInfo.showLightSourcesWindow = wInfo.showObjMatWindow = true;
+    wInfo.showSettingsWindow = wInfo.showSceneWindow = wInfo.showProfilerWindow = true;
+
+    int status = 0;
+    char line[256];
+    for(const string &objFile : objFiles) {
+        wContext.clearObjects();
+        if(!loadAndWait(objFile)) {
+            cerr << "Could not load " << objFile << endl;
+            status = 1;
+            continue;
+        }
+
+        double totalTime = 0.0, fastestTime = 1e30;
+        for(int f = -nWarmupFrames; f < nFrames; f++) {
+            glfwPollEvents();
+            double guiTime = drawFrame();
+            if(f < 0) continue;
+            totalTime += guiTime;
+            fastestTime = std::min(fastestTime, guiTime);
+        }
+        const Object &object = wContext.objects[0];
+        snprintf(line, sizeof(line), "DrawGui with %s (%zu triangles, %zu vertices): %.3f ms mean, %.3f ms fastest, %d frames",
+                 object.fileName.c_str(), object.getTriangleCount(0), object.vertices.size(),
+                 totalTime/std::max(nFrames, 1), fastestTime, nFrames);
+        cout << line << endl;
+    }
+    return status;
+}
+
+/**
+ * Function for measuring how long it takes to draw many instances of
+ * one object. The object is drawn with 1 and with 1,000 instances, laid
+ * out on a grid with the instance transforms, and frustum culling is
+ * turned off so every instance is drawn. Each frame is timed on the CPU
+ * and on the GPU after a few frames to warm up.
+ * 
+ * @param objFile: The path of the object file.
+ * @param nFrames: How many frames are measured for each instance count.
+ * 
+ * @return 0 if the object was loaded and drawn, 1 otherwise.
+ */
+int Renderer::benchmarkInstances(const string &objFile, int nFrames)
+{
+    const int nWarmupFrames = 10;
+    const size_t instanceCounts[] = { 1, 1000 };
+    FrameCapture capture;
+    if(!capture.create(width(), height())) {
+        cerr << "Could not create a framebuffer to render into." << endl;
+        return 1;
+    }
+    if(!loadAndWait(objFile)) {
+        cerr << "Could not load " << objFile << endl;
+        return 1;
+    }
+    wContext.rInfo.useFrustumCulling = false;
+    wContext.selectObject(0);
+    updateLight();
+
+    char line[256];
+    vector<GLQuery> gpuQueries(nFrames);
+    for(size_t nInstances : instanceCounts) {
+        while(wContext.objects[0].getInstanceCount() < nInstances) wContext.addInstance(0);
+
+        // A square grid in the space of the object, centered on the origin.
+        const Object &object = wContext.objects[0];
+        int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(nInstances))));
+        float spacing = 2.5f*object.bounds.radius;
+        for(size_t i = 0; i < nInstances; i++) {
+            Object::InstanceTransform transform;
+            transform.translation = glm::vec3(((int)i%side - 0.5f*(side - 1))*spacing,
+                                              ((int)i/side - 0.5f*(side - 1))*spacing, 0.0f) - object.bounds.center;
+            wContext.selectInstance(static_cast<int>(i));
+            wContext.setInstanceTransform(transform);
+        }
+
+        // The camera looks at the grid from far enough away to see all of it.
+        float extent = Frustum::maxScale(object.matModel)*spacing*side;
+        wContext.cInfo.pRef = glm::vec3(0.0f, 0.0f, 0.0f);
+        wContext.cInfo.pZero = glm::vec3(0.0f, 0.0f, 1.5f*extent);
+        wContext.cInfo.camDir = wContext.cInfo.pRef - wContext.cInfo.pZero;
+        wContext.dirty.camera = true;
+        updateObject(0);
+        updateCamera();
+
+        capture.bind();
+        double totalTime = 0.0, fastestTime = 1e30;
+        for(int f = -nWarmupFrames; f < nFrames; f++) {
+            chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+            if(f >= 0) {
+                gpuQueries[f].create();
+                glBeginQuery(GL_TIME_ELAPSED, gpuQueries[f].id());
+            }
+            display();
+            if(f >= 0) glEndQuery(GL_TIME_ELAPSED);
+            double frameTime = chrono::duration<double, milli>(chrono::steady_clock::now() - frameStart).count();
+            // Frames are not queued up, so each one is timed on its own.
+            glFinish();
+            wContext.dirty.clear();
+            if(f < 0) continue;
+            totalTime += frameTime;
+            fastestTime = std::min(fastestTime, frameTime);
+        }
+        capture.unbind();
+
+        GLuint64 gpuTime = 0;
+        for(int f = 0; f < nFrames; f++) {
+            GLuint64 frameTime = 0;
+            glGetQueryObjectui64v(gpuQueries[f].id(), GL_QUERY_RESULT, &frameTime);
+            gpuTime += frameTime;
+        }
+        snprintf(line, sizeof(line), "%s with %zu instances (%zu draw calls): CPU %.3f ms mean, %.3f ms fastest, GPU %.3f ms mean, %d frames",
+                 object.fileName.c_str(), nInstances, static_cast<size_t>(wContext.rInfo.nDrawCalls),
+                 totalTime/std::max(nFrames, 1), fastestTime, gpuTime/1.0e6/std::max(nFrames, 1), nFrames);
+        cout << line << endl;
+    }
+    return 0;
+}
+
+/**
+ * Function for measuring how much cpu time the studio uses while
+ * nothing happens, once when it only redraws when something changes
+ * and once when it redraws every frame. The main loop runs untouched
+ * for the given time in each mode, after a second to settle.
+ * 
+ * @param objFiles: The object files to show in the scene, can be empty.
+ * @param duration: Seconds to measure each mode for.
+ * 
+ * @return 0 if every object was loaded, 1 otherwise.
+ */
+int Renderer::measureIdle(const vector<string> &objFiles, double duration)
+{
+    const double settleTime = 1.0;
+    int status = 0;
+    for(const string &objFile : objFiles) {
+        if(loadAndWait(objFile)) continue;
+        cerr << "Could not load " << objFile << endl;
+        status = 1;
     }
-    stbi_image_free(data);
-    wContext.objects[selectedObject].oInfo.hasTexture = true;
-    wContext.objects[selectedObject].oInfo.showTexture = true;
-    return "\nSuccessfully loaded texture \"" + texName + "\"\n";
-}
\ No newline at end of file
+
+    char line[256];
+    const bool modes[] = { true, false };
+    for(bool renderOnDemand : modes) {
+        wContext.rInfo.renderOnDemand = renderOnDemand;
+        start(settleTime);
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        clock_t cpuStart = clock();
+        start(duration);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        double cpuUsage = 100.0*(clock() - cpuStart)/CLOCKS_PER_SEC/seconds;
+        snprintf(line, sizeof(line), "Idle with %s: %.1f%% cpu over %.1f s",
+                 renderOnDemand ? "redraw on demand" : "redraw every frame", cpuUsage, seconds);
+        cout << line << endl;
+    }
+    return status;
+}
+
+/**
+ * Function for loading a file into the scene, and waiting until it has
+ * been added. An object file is added as a new object, and any other
+ * file is loaded as a texture for the last object.
+ * 
+ * @param file: The path of the object or image file.
+ * 
+ * @return True if the object or the texture was added to the scene.
+ */
+bool Renderer::loadAndWait(const string &file)
+{
+    size_t slash = file.find_last_of('/');
+    string path = slash == string::npos ? "." : file.substr(0, slash);
+    string name = slash == string::npos ? file : file.substr(slash + 1);
+    bool isObject = name.size() > 4 && name.compare(name.size() - 4, 4, ".obj") == 0;
+    size_t nObjects = wContext.objects.size();
+    if(isObject) loadObjectFromGui(path, name);
+    else if(nObjects > 0) loadTextureFromGui(name, path, static_cast<int>(nObjects) - 1);
+    else return false;
+
+    while(!objectLoads.empty() || !textureLoads.empty()) {
+        finishLoads();
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return isObject ? wContext.objects.size() > nObjects : wContext.objects.back().texture.valid();
+}
@@ -0,0 +1,272 @@
+#include "scenebatch.h"
+#include <algorithm>
+
+/**
+ * This class packs the geometry of all loaded objects into a single
+ * vertex buffer and a single index buffer, so that the whole scene
+ * can be drawn with one glMultiDrawElementsIndirect call.
+ */
+
+namespace
+{
+    // The number of indices of every level of detail of an object.
+    GLuint countIndices(const Object &object)
+    {
+        size_t nIndices = 0;
+        for(size_t lod = 0; lod < object.getLodCount(); lod++) nIndices += 3*object.getTriangleCount(lod);
+        return static_cast<GLuint>(nIndices);
+    }
+}
+
+/**
+ * Function for rebuilding the shared buffers from the objects in the
+ * scene. Each object is given its own range of the buffers, with a
+ * quarter of its size again as room to grow, and each material group
+ * of each object gets its own command.
+ *
+ * @param objects: The objects in the scene.
+ * @param sceneRevision: The geometry revision of the scene the batch is built for.
+ * @param packedVertices: If the vertex buffer holds packed vertices.
+ * @param shortIndices: If 16 bit indices are used when every range fits them.
+ */
+void SceneBatch::rebuild(const vector<Object> &objects, unsigned int sceneRevision, bool packedVertices, bool shortIndices)
+{
+    sources.clear();
+    commands.clear();
+    slots.assign(objects.size(), ObjectSlot());
+
+    // A multi draw call has one index type, so 16 bit indices are only
+    // used if every range fits them when counted from its first vertex.
+    bool useShort = shortIndices;
+    for(size_t o = 0; o < objects.size() && useShort; o++) useShort = fitsShortIndices(objects[o]);
+
+    GLuint nVertices = 0, nIndices = 0;
+    for(size_t o = 0; o < objects.size(); o++) {
+        ObjectSlot &slot = slots[o];
+        GLuint objectVertices = static_cast<GLuint>(objects[o].vertices.size());
+        GLuint objectIndices = countIndices(objects[o]);
+        slot.firstVertex = nVertices;
+        slot.vertexCapacity = objectVertices + objectVertices/4;
+        slot.firstIndex = nIndices;
+        slot.indexCapacity = objectIndices + objectIndices/4;
+        nVertices += slot.vertexCapacity;
+        nIndices += slot.indexCapacity;
+
+        // The ranges of the command are set when it is drawn.
+        for(size_t f = 0; f < objects[o].faces.size(); f++) {
+            DrawSource source = { o, f };
+            sources.push_back(source);
+            DrawCommand command = { 0, 0, 0, 0, static_cast<GLuint>(commands.size()) };
+            commands.push_back(command);
+        }
+    }
+    drawData.resize(commands.size());
+
+    // The draw id of instance i is i, the base instance of a command selects it.
+    vector<GLuint> drawIds(commands.size());
+    for(size_t d = 0; d < drawIds.size(); d++) drawIds[d] = static_cast<GLuint>(d);
+
+    if(!vao.valid()) {
+        vao.create();
+        vertexBuffer.create();
+        indexBuffer.create();
+        drawIdBuffer.create();
+        commandBuffer.create();
+        drawDataBuffer.create();
+    }
+    packed = packedVertices;
+    shortIndicesAllowed = shortIndices;
+    indexType = useShort ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    glBindVertexArray(vao.id());
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.id());
+    glBufferData(GL_ARRAY_BUFFER, nVertices*(packedVertices ? sizeof(PackedVertex) : sizeof(Vertex)), NULL, GL_STATIC_DRAW);
+    PackedVertex::setAttributes(packedVertices);
+
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer.id());
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size()*sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), BUFFER_OFFSET(0));
+    glVertexAttribDivisor(3, 1);
+    glEnableVertexAttribArray(3);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.id());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, nIndices*(useShort ? sizeof(unsigned short) : sizeof(unsigned int)), NULL, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for(size_t o = 0; o < objects.size(); o++) writeObject(objects[o], slots[o]);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id());
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size()*sizeof(DrawCommand), commands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer.id());
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawData.size()*sizeof(DrawData), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    revision = sceneRevision;
+    built = true;
+}
+
+/**
+ * Function for writing the objects whose mesh has changed since they
+ * were written into their own ranges of the shared buffers, so that
+ * editing one object does not upload the whole scene again. An object
+ * that has outgrown its range, or that no longer fits 16 bit indices
+ * when they are used, makes the whole batch be built again.
+ *
+ * @param objects: The objects in the scene, the same as the batch was built from.
+ */
+void SceneBatch::update(const vector<Object> &objects)
+{
+    if(slots.size() != objects.size()) {
+        rebuild(objects, revision, packed, shortIndicesAllowed);
+        return;
+    }
+    for(size_t o = 0; o < objects.size(); o++) {
+        const Object &object = objects[o];
+        ObjectSlot &slot = slots[o];
+        if(object.getMeshRevision() == slot.meshRevision) continue;
+        bool fits = object.vertices.size() <= slot.vertexCapacity && countIndices(object) <= slot.indexCapacity;
+        if(!fits || (indexType == GL_UNSIGNED_SHORT && !fitsShortIndices(object))) {
+            rebuild(objects, revision, packed, shortIndicesAllowed);
+            return;
+        }
+        writeObject(object, slot);
+    }
+}
+
+/**
+ * Function for writing the vertices and the indices of every level of
+ * detail of an object into its range of the shared buffers. Each index
+ * range is counted from its own first vertex when 16 bit indices are used.
+ *
+ * @param object: The object to write.
+ * @param slot: The range of the object, which is given the new index ranges.
+ */
+void SceneBatch::writeObject(const Object &object, ObjectSlot &slot)
+{
+    bool useShort = indexType == GL_UNSIGNED_SHORT;
+    slot.nLods = object.getLodCount();
+    slot.ranges.resize(object.faces.size()*slot.nLods);
+    slot.meshRevision = object.getMeshRevision();
+
+    vector<unsigned int> indices;
+    indices.reserve(countIndices(object));
+    for(size_t f = 0; f < object.faces.size(); f++) {
+        for(size_t lod = 0; lod < slot.nLods; lod++) {
+            const vector<unsigned int> &faceIndices = object.getFaceIndices(f, lod);
+            unsigned int rangeBase = 0;
+            if(useShort) Object::fitsShortIndices(faceIndices, rangeBase);
+            IndexRange range = { slot.firstIndex + static_cast<GLuint>(indices.size()), static_cast<GLuint>(faceIndices.size()),
+                                 static_cast<GLint>(slot.firstVertex + rangeBase) };
+            slot.ranges[f*slot.nLods + lod] = range;
+            for(unsigned int index : faceIndices) indices.push_back(index - rangeBase);
+        }
+    }
+
+    // The copy target is used so that the element buffer of the bound vertex array is left alone.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer.id());
+    if(packed) {
+        vector<PackedVertex> packedData = PackedVertex::pack(object.vertices);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, slot.firstVertex*sizeof(PackedVertex), packedData.size()*sizeof(PackedVertex), packedData.data());
+    } else {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, slot.firstVertex*sizeof(Vertex), object.vertices.size()*sizeof(Vertex), object.vertices.data());
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer.id());
+    if(useShort) {
+        vector<unsigned short> packedIndices(indices.begin(), indices.end());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, slot.firstIndex*sizeof(unsigned short), packedIndices.size()*sizeof(unsigned short), packedIndices.data());
+    } else {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, slot.firstIndex*sizeof(unsigned int), indices.size()*sizeof(unsigned int), indices.data());
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * Function for drawing all batched objects with a single multi draw
+ * call. The model matrix and material of every draw are uploaded
+ * first, the commands are pointed at the level of detail of their
+ * object, and the commands of objects that can not be batched this
+ * frame, or that are not visible, are given zero instances so that
+ * they are skipped.
+ *
+ * The multi draw shader program must be in use when this is called.
+ *
+ * @param objects: The objects in the scene, the same as the batch was built from.
+ * @param visibleFaces: Which material groups of each object that are visible.
+ *
+ * @return The number of draw calls that were made.
+ */
+int SceneBatch::draw(const vector<Object> &objects, const vector<vector<unsigned char>> &visibleFaces)
+{
+    if(commands.empty()) return 0;
+
+    for(size_t d = 0; d < sources.size(); d++) {
+        const Object &object = objects[sources[d].objectIndex];
+        const Object::MaterialInfo &mInfo = object.oInfo.useDefaultMat ? object.defMat : object.faces[sources[d].faceIndex].mInfo;
+        drawData[d].M = object.matModel*object.getInstanceMatrices()[0];
+        drawData[d].ka = glm::vec4(mInfo.ka, 1.0f);
+        drawData[d].kd = glm::vec4(mInfo.kd, 1.0f);
+        drawData[d].ks = glm::vec4(mInfo.ks, 1.0f);
+        drawData[d].params = glm::vec4(object.matAlpha, 0.0f, 0.0f, 0.0f);
+        bool visible = visibleFaces[sources[d].objectIndex][sources[d].faceIndex];
+        commands[d].instanceCount = canBatch(object) && visible ? 1 : 0;
+        const ObjectSlot &slot = slots[sources[d].objectIndex];
+        size_t lod = std::min(object.getLod(), slot.nLods - 1);
+        const IndexRange &range = slot.ranges[sources[d].faceIndex*slot.nLods + lod];
+        commands[d].firstIndex = range.firstIndex;
+        commands[d].count = range.count;
+        commands[d].baseVertex = range.baseVertex;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer.id());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, drawData.size()*sizeof(DrawData), drawData.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer.id());
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id());
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size()*sizeof(DrawCommand), commands.data());
+
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(vao.id());
+    glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, BUFFER_OFFSET(0), static_cast<GLsizei>(commands.size()), 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return 1;
+}
+
+/**
+ * Function for checking if an object can be drawn by the batch. Objects
+ * that show a texture or are drawn as a wireframe need their own state
+ * and are drawn on their own. Objects with several instances are also
+ * drawn on their own, with one instanced draw call per material group.
+ *
+ * @param object: The object to check.
+ *
+ * @return True if the object can be drawn by the batch.
+ */
+bool SceneBatch::canBatch(const Object &object)
+{
+    return !object.oInfo.showTexture && !object.oInfo.showWireFrame && object.getInstanceCount() == 1;
+}
+
+/**
+ * Function for checking if every index range of an object fits 16 bit
+ * indices when counted from its own first vertex.
+ *
+ * @param object: The object to check.
+ *
+ * @return True if every range of every level of detail fits.
+ */
+bool SceneBatch::fitsShortIndices(const Object &object)
+{
+    for(size_t f = 0; f < object.faces.size(); f++) {
+        for(size_t lod = 0; lod < object.getLodCount(); lod++) {
+            unsigned int rangeBase;
+            if(!Object::fitsShortIndices(object.getFaceIndices(f, lod), rangeBase)) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,488 @@
+#include "scenebvh.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <random>
+
+/**
+ * This class is a bounding volume hierarchy over the world space
+ * bounding boxes of all object instances in the scene.
+ */
+
+namespace
+{
+    /**
+     * Function for intersecting a ray with a box using the slab method.
+     *
+     * @param origin: The origin of the ray.
+     * @param invDirection: One divided by each component of the ray direction.
+     * @param min: The smallest corner of the box.
+     * @param max: The largest corner of the box.
+     * @param t: Set to the distance where the ray enters the box.
+     *
+     * @return True if the ray hits the box in front of its origin.
+     */
+    bool rayBox(const glm::vec3 &origin, const glm::vec3 &invDirection, const glm::vec3 &min, const glm::vec3 &max, float &t)
+    {
+        glm::vec3 t0 = (min - origin)*invDirection;
+        glm::vec3 t1 = (max - origin)*invDirection;
+        glm::vec3 tSmall = glm::min(t0, t1);
+        glm::vec3 tLarge = glm::max(t0, t1);
+        float tNear = std::max(std::max(tSmall.x, tSmall.y), std::max(tSmall.z, 0.0f));
+        float tFar = std::min(std::min(tLarge.x, tLarge.y), tLarge.z);
+        t = tNear;
+        return tNear <= tFar;
+    }
+
+    /**
+     * Function for finding the world space box that contains a box
+     * in object space after it has been transformed by a matrix.
+     */
+    void transformBox(const BoundingVolume &volume, const glm::mat4 &M, glm::vec3 &min, glm::vec3 &max)
+    {
+        glm::vec3 center = glm::vec3(M*glm::vec4(0.5f*(volume.min + volume.max), 1.0f));
+        glm::vec3 halfSize = 0.5f*(volume.max - volume.min);
+        glm::mat3 absM = glm::mat3(M);
+        for(int c = 0; c < 3; c++) absM[c] = glm::abs(absM[c]);
+        glm::vec3 extent = absM*halfSize;
+        min = center - extent;
+        max = center + extent;
+    }
+}
+
+/**
+ * Function for keeping the tree up to date with the objects. The tree
+ * is rebuilt if the number of instances has changed and refitted if
+ * any object has been moved since the last update.
+ *
+ * @param objects: The objects in the scene.
+ */
+void SceneBVH::update(const vector<Object> &objects)
+{
+    size_t nItems = 0;
+    for(const Object &object : objects) nItems += object.getInstanceCount();
+    if(nItems != items.size() || transformRevisions.size() != objects.size()) {
+        build(objects);
+        return;
+    }
+
+    for(size_t o = 0; o < objects.size(); o++) {
+        if(objects[o].getTransformRevision() != transformRevisions[o]) {
+            refit(objects);
+            return;
+        }
+    }
+}
+
+/**
+ * Function for building the tree from scratch.
+ *
+ * @param objects: The objects in the scene.
+ */
+void SceneBVH::build(const vector<Object> &objects)
+{
+    collectItems(objects);
+    buildNodes();
+}
+
+/**
+ * Function for refitting the tree after objects have been moved. The
+ * objects and instances must be the same as when the tree was built.
+ *
+ * @param objects: The objects in the scene.
+ */
+void SceneBVH::refit(const vector<Object> &objects)
+{
+    collectItems(objects);
+    refitNodes();
+}
+
+/**
+ * Function for finding all items whose box is inside or intersects the
+ * frustum. Subtrees that are entirely inside are accepted without
+ * testing their items.
+ *
+ * @param frustum: The frustum to test against.
+ * @param result: Filled with the indices of the visible items.
+ */
+void SceneBVH::queryFrustum(const Frustum &frustum, vector<size_t> &result) const
+{
+    result.clear();
+    if(nodes.empty()) return;
+
+    unsigned int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        unsigned int nodeIndex = stack[--stackSize];
+        const Node &node = nodes[nodeIndex];
+        Frustum::Containment containment = frustum.classify(node.min, node.max);
+        if(containment == Frustum::OUTSIDE) continue;
+        if(containment == Frustum::INSIDE) {
+            addSubtree(nodeIndex, result);
+        } else if(node.count > 0) {
+            for(unsigned int i = node.first; i < node.first + node.count; i++) {
+                const Item &item = items[itemOrder[i]];
+                if(frustum.classify(item.min, item.max) != Frustum::OUTSIDE) result.push_back(itemOrder[i]);
+            }
+        } else {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+        }
+    }
+}
+
+/**
+ * Function for finding all items whose box is hit by a ray. The hits
+ * are sorted by distance, so the closest box comes first.
+ *
+ * @param origin: The origin of the ray.
+ * @param direction: The direction of the ray.
+ * @param result: Filled with the hit items and their distances.
+ */
+void SceneBVH::queryRay(const glm::vec3 &origin, const glm::vec3 &direction, vector<RayHit> &result) const
+{
+    result.clear();
+    if(nodes.empty()) return;
+
+    glm::vec3 invDirection = 1.0f/direction;
+    unsigned int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        const Node &node = nodes[stack[--stackSize]];
+        float t;
+        if(!rayBox(origin, invDirection, node.min, node.max, t)) continue;
+        if(node.count > 0) {
+            for(unsigned int i = node.first; i < node.first + node.count; i++) {
+                const Item &item = items[itemOrder[i]];
+                if(rayBox(origin, invDirection, item.min, item.max, t)) result.push_back({ itemOrder[i], t });
+            }
+        } else {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+        }
+    }
+    sort(result.begin(), result.end(), [](const RayHit &a, const RayHit &b) { return a.t < b.t; });
+}
+
+/**
+ * Function for creating one item for each instance of each object,
+ * with the world space box of the instance.
+ *
+ * @param objects: The objects in the scene.
+ */
+void SceneBVH::collectItems(const vector<Object> &objects)
+{
+    items.clear();
+    transformRevisions.resize(objects.size());
+    for(size_t o = 0; o < objects.size(); o++) {
+        const vector<glm::mat4> &instances = objects[o].getInstanceMatrices();
+        for(size_t i = 0; i < instances.size(); i++) {
+            Item item;
+            item.objectIndex = o;
+            item.instanceIndex = i;
+            item.M = objects[o].matModel*instances[i];
+            transformBox(objects[o].bounds, item.M, item.min, item.max);
+            items.push_back(item);
+        }
+        transformRevisions[o] = objects[o].getTransformRevision();
+    }
+}
+
+/**
+ * Function for building the nodes of the tree from the items. Nodes
+ * are split until they hold few enough items or until no split is
+ * cheaper than keeping the node as a leaf.
+ */
+void SceneBVH::buildNodes()
+{
+    nodes.clear();
+    itemOrder.resize(items.size());
+    for(size_t i = 0; i < itemOrder.size(); i++) itemOrder[i] = static_cast<unsigned int>(i);
+    if(items.empty()) return;
+
+    nodes.reserve(2*items.size());
+    Node root;
+    root.first = 0;
+    root.count = static_cast<unsigned int>(items.size());
+    updateNodeBounds(root);
+    nodes.push_back(root);
+
+    // Pairs of node index and depth.
+    vector<pair<unsigned int, unsigned int>> stack(1, make_pair(0u, 0u));
+    while(!stack.empty()) {
+        unsigned int nodeIndex = stack.back().first;
+        unsigned int depth = stack.back().second;
+        stack.pop_back();
+        Node node = nodes[nodeIndex];
+
+        int axis;
+        float position;
+        if(node.count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH || !findSplit(node, axis, position)) continue;
+
+        // Partition the items of the node around the split.
+        unsigned int *begin = itemOrder.data() + node.first;
+        unsigned int *middle = partition(begin, begin + node.count, [&](unsigned int i) {
+            return 0.5f*(items[i].min[axis] + items[i].max[axis]) < position;
+        });
+        unsigned int leftCount = static_cast<unsigned int>(middle - begin);
+        if(leftCount == 0 || leftCount == node.count) continue;
+
+        Node left, right;
+        left.first = node.first;
+        left.count = leftCount;
+        right.first = node.first + leftCount;
+        right.count = node.count - leftCount;
+        updateNodeBounds(left);
+        updateNodeBounds(right);
+
+        unsigned int leftIndex = static_cast<unsigned int>(nodes.size());
+        nodes.push_back(left);
+        nodes.push_back(right);
+        nodes[nodeIndex].first = leftIndex;
+        nodes[nodeIndex].count = 0;
+        stack.push_back(make_pair(leftIndex, depth + 1));
+        stack.push_back(make_pair(leftIndex + 1, depth + 1));
+    }
+}
+
+/**
+ * Function for recomputing the boxes of all nodes. Children always
+ * come after their parent, so walking the nodes backwards visits
+ * every child before its parent.
+ */
+void SceneBVH::refitNodes()
+{
+    for(size_t n = nodes.size(); n-- > 0;) {
+        Node &node = nodes[n];
+        if(node.count > 0) {
+            updateNodeBounds(node);
+        } else {
+            node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+            node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+        }
+    }
+}
+
+/**
+ * Function for computing the box of a leaf node from its items.
+ *
+ * @param node: The node to update.
+ */
+void SceneBVH::updateNodeBounds(Node &node) const
+{
+    node.min = glm::vec3(numeric_limits<float>::max());
+    node.max = glm::vec3(-numeric_limits<float>::max());
+    for(unsigned int i = node.first; i < node.first + node.count; i++) {
+        node.min = glm::min(node.min, items[itemOrder[i]].min);
+        node.max = glm::max(node.max, items[itemOrder[i]].max);
+    }
+}
+
+/**
+ * Function for finding the cheapest split of a node with the surface
+ * area heuristic. The centroids of the items are sorted into bins
+ * along each axis and every split between two bins is evaluated.
+ *
+ * @param node: The node to split.
+ * @param axis: Set to the axis of the best split.
+ * @param position: Set to the position of the best split along the axis.
+ *
+ * @return False if no split is cheaper than keeping the node as a leaf.
+ */
+bool SceneBVH::findSplit(const Node &node, int &axis, float &position) const
+{
+    struct Bin {
+        glm::vec3 min = glm::vec3(numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-numeric_limits<float>::max());
+        unsigned int count = 0;
+    };
+
+    glm::vec3 centroidMin = glm::vec3(numeric_limits<float>::max());
+    glm::vec3 centroidMax = glm::vec3(-numeric_limits<float>::max());
+    for(unsigned int i = node.first; i < node.first + node.count; i++) {
+        glm::vec3 centroid = 0.5f*(items[itemOrder[i]].min + items[itemOrder[i]].max);
+        centroidMin = glm::min(centroidMin, centroid);
+        centroidMax = glm::max(centroidMax, centroid);
+    }
+
+    float bestCost = node.count*surfaceArea(node.min, node.max);
+    bool found = false;
+    for(int a = 0; a < 3; a++) {
+        float extent = centroidMax[a] - centroidMin[a];
+        if(extent <= 0.0f) continue;
+
+        Bin bins[SAH_BINS];
+        float scale = SAH_BINS/extent;
+        for(unsigned int i = node.first; i < node.first + node.count; i++) {
+            const Item &item = items[itemOrder[i]];
+            float centroid = 0.5f*(item.min[a] + item.max[a]);
+            int b = std::min(SAH_BINS - 1, static_cast<int>((centroid - centroidMin[a])*scale));
+            bins[b].count++;
+            bins[b].min = glm::min(bins[b].min, item.min);
+            bins[b].max = glm::max(bins[b].max, item.max);
+        }
+
+        // Sweep from the right to get the cost of everything right of each split.
+        float rightArea[SAH_BINS - 1];
+        unsigned int rightCount[SAH_BINS - 1];
+        Bin right;
+        for(int b = SAH_BINS - 1; b > 0; b--) {
+            right.count += bins[b].count;
+            right.min = glm::min(right.min, bins[b].min);
+            right.max = glm::max(right.max, bins[b].max);
+            rightCount[b - 1] = right.count;
+            rightArea[b - 1] = right.count > 0 ? surfaceArea(right.min, right.max) : 0.0f;
+        }
+
+        Bin left;
+        for(int b = 0; b < SAH_BINS - 1; b++) {
+            left.count += bins[b].count;
+            left.min = glm::min(left.min, bins[b].min);
+            left.max = glm::max(left.max, bins[b].max);
+            if(left.count == 0 || rightCount[b] == 0) continue;
+            float cost = left.count*surfaceArea(left.min, left.max) + rightCount[b]*rightArea[b];
+            if(cost < bestCost) {
+                bestCost = cost;
+                axis = a;
+                position = centroidMin[a] + (b + 1)/scale;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * Function for adding all items below a node to a result.
+ *
+ * @param nodeIndex: The index of the node.
+ * @param result: The result to add the items to.
+ */
+void SceneBVH::addSubtree(unsigned int nodeIndex, vector<size_t> &result) const
+{
+    unsigned int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = nodeIndex;
+    while(stackSize > 0) {
+        const Node &node = nodes[stack[--stackSize]];
+        if(node.count > 0) {
+            for(unsigned int i = node.first; i < node.first + node.count; i++) result.push_back(itemOrder[i]);
+        } else {
+            stack[stackSize++] = node.first;
+            stack[stackSize++] = node.first + 1;
+        }
+    }
+}
+
+/**
+ * Function for calculating the surface area of a box.
+ *
+ * @param min: The smallest corner of the box.
+ * @param max: The largest corner of the box.
+ *
+ * @return The surface area of the box.
+ */
+float SceneBVH::surfaceArea(const glm::vec3 &min, const glm::vec3 &max)
+{
+    glm::vec3 d = max - min;
+    return 2.0f*(d.x*d.y + d.y*d.z + d.z*d.x);
+}
+
+/**
+ * Function for comparing the tree against a linear scan over all items.
+ * A scene of randomly placed boxes is built and the same frustum and
+ * ray queries are answered both ways, after which the timings are
+ * returned as text for the log.
+ *
+ * @param nItems: The number of boxes in the scene.
+ *
+ * @return A report of the timings.
+ */
+string SceneBVH::benchmark(size_t nItems)
+{
+    const int nFrustumQueries = 100;
+    const int nRayQueries = 1000;
+    typedef chrono::steady_clock Clock;
+
+    SceneBVH bvh;
+    mt19937 rng(1);
+    uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    uniform_real_distribution<float> size(0.5f, 2.0f);
+    for(size_t i = 0; i < nItems; i++) {
+        glm::vec3 center = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+        Item item = { i, 0, glm::mat4(1.0f), center - size(rng), center + size(rng) };
+        bvh.items.push_back(item);
+    }
+
+    Clock::time_point start = Clock::now();
+    bvh.buildNodes();
+    double buildTime = chrono::duration<double, milli>(Clock::now() - start).count();
+
+    // Frustum queries from cameras looking in random directions.
+    vector<Frustum> frustums(nFrustumQueries);
+    glm::mat4 P = glm::perspective(glm::radians(60.0f), 4.0f/3.0f, 0.1f, 50.0f);
+    for(Frustum &frustum : frustums) {
+        glm::vec3 eye = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+        glm::vec3 target = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+        frustum.extract(P*glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    vector<size_t> result;
+    size_t bvhVisible = 0, linearVisible = 0;
+    start = Clock::now();
+    for(const Frustum &frustum : frustums) {
+        bvh.queryFrustum(frustum, result);
+        bvhVisible += result.size();
+    }
+    double bvhFrustumTime = chrono::duration<double, milli>(Clock::now() - start).count()/nFrustumQueries;
+
+    start = Clock::now();
+    for(const Frustum &frustum : frustums) {
+        for(const Item &item : bvh.items) {
+            if(frustum.classify(item.min, item.max) != Frustum::OUTSIDE) linearVisible++;
+        }
+    }
+    double linearFrustumTime = chrono::duration<double, milli>(Clock::now() - start).count()/nFrustumQueries;
+
+    // Ray queries from random points in random directions.
+    vector<glm::vec3> origins(nRayQueries), directions(nRayQueries);
+    for(int r = 0; r < nRayQueries; r++) {
+        origins[r] = glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng));
+        directions[r] = glm::normalize(glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng)));
+    }
+
+    vector<RayHit> hits;
+    size_t bvhHits = 0, linearHits = 0;
+    start = Clock::now();
+    for(int r = 0; r < nRayQueries; r++) {
+        bvh.queryRay(origins[r], directions[r], hits);
+        bvhHits += hits.size();
+    }
+    double bvhRayTime = chrono::duration<double, micro>(Clock::now() - start).count()/nRayQueries;
+
+    start = Clock::now();
+    for(int r = 0; r < nRayQueries; r++) {
+        glm::vec3 invDirection = 1.0f/directions[r];
+        hits.clear();
+        for(size_t i = 0; i < bvh.items.size(); i++) {
+            float t;
+            if(rayBox(origins[r], invDirection, bvh.items[i].min, bvh.items[i].max, t)) hits.push_back({ i, t });
+        }
+        sort(hits.begin(), hits.end(), [](const RayHit &a, const RayHit &b) { return a.t < b.t; });
+        linearHits += hits.size();
+    }
+    double linearRayTime = chrono::duration<double, micro>(Clock::now() - start).count()/nRayQueries;
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+             "\nScene BVH benchmark, %zu objects (%zu nodes, built in %.2f ms):\n"
+             "\tFrustum query: BVH %.4f ms, linear scan %.4f ms (%zu/%zu visible)\n"
+             "\tRay query:     BVH %.2f us, linear scan %.2f us (%zu/%zu hits)\n",
+             nItems, bvh.nodes.size(), buildTime,
+             bvhFrustumTime, linearFrustumTime, bvhVisible, linearVisible,
+             bvhRayTime, linearRayTime, bvhHits, linearHits);
+    return string(buffer);
+}
@@ -0,0 +1,44 @@
+#include "shaderprogram.h"
+
+/**
+ * This class represents a linked shader program. All uniform
+ * locations that the program uses are looked up once when the
+ * class is created, so that no string lookups has to be done
+ * while rendering.
+ */
+
+namespace
+{
+    // The names of the uniforms, in the same order as ShaderProgram::Uniform.
+    const char *UNIFORM_NAMES[ShaderProgram::N_UNIFORMS] = {
+        "M",
+        "showTexture",
+        "alpha",
+        "matIndex",
+        "ourTexture"
+    };
+}
+
+/**
+ * Constructor of the shader program. Looks up the locations of all
+ * uniforms and binds the uniform blocks to their binding points.
+ * Uniforms that the program does not use get the location -1, which
+ * OpenGL silently ignores.
+ *
+ * @param program: A linked shader program, or 0 for no program.
+ */
+ShaderProgram::ShaderProgram(GLuint program) : program(program)
+{
+    for(int u = 0; u < N_UNIFORMS; u++) locations[u] = -1;
+    if(program == 0) return;
+
+    for(int u = 0; u < N_UNIFORMS; u++) {
+        locations[u] = glGetUniformLocation(program, UNIFORM_NAMES[u]);
+    }
+
+    GLuint frameBlock = glGetUniformBlockIndex(program, "FrameData");
+    if(frameBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, frameBlock, FRAME_DATA_BINDING);
+
+    GLuint materialBlock = glGetUniformBlockIndex(program, "Materials");
+    if(materialBlock != GL_INVALID_INDEX) glUniformBlockBinding(program, materialBlock, MATERIALS_BINDING);
+}
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 
 in vec2 texCoord;
 in vec3 fragNormal; // Normalized
@@ -6,20 +6,64 @@ in vec3 fragPosition;
 
 out vec4 color;
 
-uniform vec3 camPos; // Camera Position
-uniform vec4 la; // Ambient Light Intensity
-uniform vec4 lsPos;  // Light source position
-uniform vec4 lsColor;  // Light source color
+// Values that are the same for every object, updated once per frame.
+layout (std140) uniform FrameData {
+    mat4 V;
+    mat4 P;
+    vec4 camPos; // Camera Position
+    vec4 la; // Ambient Light Intensity
+    vec4 lsPos;  // Light source position
+    vec4 lsColor;  // Light source color
+};
+
+#ifdef MULTI_DRAW
+flat in uint fragDrawId;
+
+// Must match SceneBatch::DrawData.
+struct DrawData {
+    mat4 M;
+    vec4 ka;
+    vec4 kd;
+    vec4 ks;
+    vec4 params; // Shininess coefficient in x
+};
+layout (std430, binding = 2) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+#else
+// The materials of the object, must match ShaderProgram::MAX_MATERIALS.
+struct Material {
+    vec4 ka;
+    vec4 kd;
+    vec4 ks;
+};
+layout (std140) uniform Materials {
+    Material materials[256];
+};
+
+uniform int matIndex; // Material of the faces being drawn
 uniform float alpha;  // Shininess coefficient
-uniform vec3 ka;
-uniform vec3 kd;
-uniform vec3 ks;
+#endif
 uniform sampler2D ourTexture;
+#ifndef MULTI_DRAW
 uniform bool showTexture;
+#endif
 
 void main() {
+#ifdef MULTI_DRAW
+    vec3 ka = draws[fragDrawId].ka.rgb;
+    vec3 kd = draws[fragDrawId].kd.rgb;
+    vec3 ks = draws[fragDrawId].ks.rgb;
+    float alpha = draws[fragDrawId].params.x;
+    bool showTexture = false;
+#else
+    vec3 ka = materials[matIndex].ka.rgb;
+    vec3 kd = materials[matIndex].kd.rgb;
+    vec3 ks = materials[matIndex].ks.rgb;
+#endif
+
     vec3 lightDir = normalize(lsPos.xyz - fragPosition);
-    vec3 viewDir = normalize(camPos - fragPosition);
+    vec3 viewDir = normalize(camPos.xyz - fragPosition);
 
     // Ambient component
     vec4 ambient = la * vec4(ka, 1.0);
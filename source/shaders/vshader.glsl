@@ -1,22 +1,74 @@
-#version 330 core
+#version 430 core
 
 layout (location = 0) in vec3 vPosition;
+#ifdef PACKED_VERTICES
+// The normal folded onto an octahedron, see PackedVertex.
+layout (location = 1) in vec2 vPackedNormal;
+#else
 layout (location = 1) in vec3 vNormal;
+#endif
 layout (location = 2) in vec2 aTexCoord;
 out vec3 fragNormal;
 out vec3 fragPosition;
 out vec2 texCoord;
 
+// Values that are the same for every object, updated once per frame.
+layout (std140) uniform FrameData {
+    mat4 V;
+    mat4 P;
+    vec4 camPos;
+    vec4 la;
+    vec4 lsPos;
+    vec4 lsColor;
+};
+
+#ifdef MULTI_DRAW
+// The index of the draw, given by the base instance of each indirect command.
+layout (location = 3) in uint drawId;
+flat out uint fragDrawId;
+
+// Must match SceneBatch::DrawData.
+struct DrawData {
+    mat4 M;
+    vec4 ka;
+    vec4 kd;
+    vec4 ks;
+    vec4 params;
+};
+layout (std430, binding = 2) readonly buffer DrawBuffer {
+    DrawData draws[];
+};
+#define MODEL draws[drawId].M
+#else
+// The placement of the instance, relative to the model matrix.
+layout (location = 3) in mat4 instanceMatrix;
+
 uniform mat4 M;
-uniform mat4 P;
-uniform mat4 V;
+#define MODEL (M * instanceMatrix)
+#endif
+
+#ifdef PACKED_VERTICES
+vec3 unpackNormal(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#define NORMAL unpackNormal(vPackedNormal)
+#else
+#define NORMAL vNormal
+#endif
 
 void main() {
-    fragNormal = normalize(mat3(M) * vNormal);
-    vec4 worldPosition = M * vec4(vPosition, 1.0);
+    fragNormal = normalize(mat3(MODEL) * NORMAL);
+    vec4 worldPosition = MODEL * vec4(vPosition, 1.0);
     fragPosition = worldPosition.xyz;
 
     texCoord = aTexCoord;
+#ifdef MULTI_DRAW
+    fragDrawId = drawId;
+#endif
     
     gl_Position = P * V * worldPosition;
 }
@@ -1,5 +1,7 @@
 #include "studio3d.h"
 #include "studiogui.h"
+#include <chrono>
+#include <ctime>
 
 using namespace std;
 
@@ -24,8 +26,10 @@ using namespace std;
  * @param title: The title of the window.
  * @param width: The starting width of the window.
  * @param height: The starting height of the window.
+ * @param headless: If the window should be hidden and the gui left out,
+ *                  for rendering to files without showing anything.
  */
-Studio3D::Studio3D(string title, int width, int height)
+Studio3D::Studio3D(string title, int width, int height, bool headless) : headless(headless)
 {
     // Initialize glfw
     if (!glfwInit())
@@ -36,6 +40,9 @@ Studio3D::Studio3D(string title, int width, int height)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    // A hidden window still gives an OpenGL context to render into framebuffers with.
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // Create OpenGL window
     windowWidth = width;
@@ -48,7 +55,7 @@ Studio3D::Studio3D(string title, int width, int height)
     }
 
     glfwMakeContextCurrent(glfwWindow);
-    glfwSwapInterval(1); 
+    glfwSwapInterval(headless ? 0 : 1);
     
     // Initialize glew
     glewExperimental = GL_TRUE;
@@ -64,14 +71,16 @@ Studio3D::Studio3D(string title, int width, int height)
     }
 
     // Setup Dear ImGui context
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGuiIO& io = ImGui::GetIO(); (void)io;
-    io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
-    ImGui::StyleColorsDark();
-
-    ImGui_ImplGlfw_InitForOpenGL(glfwWindow, true);
-    ImGui_ImplOpenGL3_Init(NULL);
+    if (!headless) {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO(); (void)io;
+        io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
+        ImGui::StyleColorsDark();
+
+        ImGui_ImplGlfw_InitForOpenGL(glfwWindow, true);
+        ImGui_ImplOpenGL3_Init(NULL);
+    }
 
     // Set graphics attributes
     glPointSize(5.0);
@@ -87,9 +96,12 @@ Studio3D::Studio3D(string title, int width, int height)
  */
 Studio3D::~Studio3D()
 {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    Profiler::shared().releaseQueries();
+    if (!headless) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
     glfwDestroyWindow(glfwWindow);
     glfwTerminate();
 }
@@ -183,10 +195,15 @@ string Studio3D::readShaderSource(const string shaderFile) const
  * directed to standard output since the program will not
  * be able to start if any errors were to occur.
  * 
+ * The defines are inserted right after the #version line of both
+ * shaders, which makes it possible to compile different variants
+ * of the same shader files.
+ * 
  * @param vShaderFile: The file path to the vertex shader code.
  * @param fShaderFile: The file path to the fragment shader code.
+ * @param defines: Preprocessor lines to add to both shaders.
  */ 
-GLuint Studio3D::initProgram(const string vShaderFile, const string fShaderFile) const
+GLuint Studio3D::initProgram(const string vShaderFile, const string fShaderFile, const string defines) const
 {
     GLuint program;
     int i;
@@ -212,6 +229,10 @@ GLuint Studio3D::initProgram(const string vShaderFile, const string fShaderFile)
             cerr << "Failed to read " << shaders[i].filename << endl;
             exit( EXIT_FAILURE );
         }
+        if ( !defines.empty() ) {
+            size_t versionEnd = shaderSource.find('\n');
+            shaderSource.insert(versionEnd == string::npos ? 0 : versionEnd + 1, defines);
+        }
 
         shader = glCreateShader( shaders[i].type );
         const char *shaderSrc = shaderSource.c_str();
@@ -267,6 +288,8 @@ GLuint Studio3D::initProgram(const string vShaderFile, const string fShaderFile)
  */
 void Studio3D::resizeCallback(GLFWwindow* window, int width, int height)
 {
+    wContext.dirty.camera = true;
+    guiFramesLeft = GUI_SETTLE_FRAMES;
     reshape(width, height);
 }
 
@@ -284,6 +307,7 @@ void Studio3D::resizeCallback(GLFWwindow* window, int width, int height)
 void Studio3D::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     static ImGuiFileDialog fileDialog;
+    guiFramesLeft = GUI_SETTLE_FRAMES;
     
     if(action == GLFW_PRESS) 
     {
@@ -323,6 +347,7 @@ void Studio3D::keyCallback(GLFWwindow* window, int key, int scancode, int action
             case GLFW_KEY_F4: if(wContext.objects.size() != 0) wInfo.showObjInfWindow = !wInfo.showObjInfWindow; break;
             case GLFW_KEY_F5: wInfo.showCamWindow = !wInfo.showCamWindow; break;
             case GLFW_KEY_F6: wInfo.showLightSourcesWindow = !wInfo.showLightSourcesWindow; break;
+            case GLFW_KEY_F7: wInfo.showProfilerWindow = !wInfo.showProfilerWindow; break;
             case GLFW_KEY_F9: wInfo.showLogWindow = !wInfo.showLogWindow; break;
             case GLFW_KEY_F10: wInfo.showKeyRefWindow = !wInfo.showKeyRefWindow; break;
         } 
@@ -347,45 +372,146 @@ void Studio3D::errorCallback(int error, const char* description)
     cerr << "GLFW error: " << description << endl;
 }
 
+/**
+ * Callback function for any input to the window that the key and
+ * resize callbacks do not get, such as mouse movement, scrolling and
+ * the window being uncovered. The gui is drawn for a few frames.
+ * 
+ * @param window: The window of the program.
+ */
+void Studio3D::inputCallback(GLFWwindow* window)
+{
+    guiFramesLeft = GUI_SETTLE_FRAMES;
+}
+
+/**
+ * Function for checking if a frame must be drawn. Nothing has to be
+ * drawn when the scene and the gui are unchanged, nothing is moving
+ * and nothing is being loaded.
+ * 
+ * @return True if the next frame should be drawn.
+ */
+bool Studio3D::needsRedraw() const
+{
+    return !wContext.rInfo.renderOnDemand || guiFramesLeft > 0 || wContext.dirty.any() ||
+           wContext.isMoving() || !objectLoads.empty() || !textureLoads.empty();
+}
+
 /**
  * Function for starting the rendering loop where
  * all the rendering and user interaction are occuring.
  * If the window is emitting that it should close, the 
  * loop will be stopped and the program will be exited.
+ * 
+ * When nothing has changed the loop sleeps until an event
+ * arrives, instead of drawing the same frame again. A headless
+ * studio has no loop, since there is nothing to interact with.
+ * 
+ * @param duration: Seconds to run the loop for, or 0 to run until the window is closed.
  */
-void Studio3D::start()
+void Studio3D::start(double duration)
 {
+    if (headless)
+        return;
+
+    chrono::steady_clock::time_point loopStart = chrono::steady_clock::now();
+    chrono::steady_clock::time_point statsStart = loopStart;
+    clock_t cpuStart = clock();
+    int framesDrawn = 0;
+
     // Loop until the user closes the window
     while (!glfwWindowShouldClose(glfwWindow)) {
-        glfwPollEvents();
-        // Start the Dear ImGui frame
+        if(duration > 0.0 && chrono::duration<double>(chrono::steady_clock::now() - loopStart).count() >= duration) break;
+        if(needsRedraw()) glfwPollEvents();
+        else glfwWaitEventsTimeout(IDLE_WAIT_TIME);
+
+        // The cpu usage is measured every second, and shown by drawing the overlay once more.
+        double statsTime = chrono::duration<double>(chrono::steady_clock::now() - statsStart).count();
+        if(statsTime >= 1.0) {
+            clock_t cpuNow = clock();
+            stats.cpuUsage = 100.0*(cpuNow - cpuStart)/CLOCKS_PER_SEC/statsTime;
+            stats.framesPerSecond = framesDrawn/statsTime;
+            statsStart = chrono::steady_clock::now();
+            cpuStart = cpuNow;
+            framesDrawn = 0;
+            if(wInfo.showOverlay && guiFramesLeft == 0) guiFramesLeft = 1;
+        }
+        if(!needsRedraw()) continue;
+        if(guiFramesLeft > 0) guiFramesLeft--;
+        framesDrawn++;
+        drawFrame();
+    }
+    
+}
+
+/**
+ * Function for drawing one frame of the studio: the loads that have
+ * finished are added, the gui is built, the scene and the gui are
+ * drawn and the buffers are swapped.
+ * 
+ * @return How long it took to build the gui, in ms.
+ */
+double Studio3D::drawFrame()
+{
+    PROFILE_FRAME();
+
+    // Start the Dear ImGui frame
+    {
+        PROFILE_SCOPE("New gui frame");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
+    }
 
-        //ImGui example gui
-        //ImGui::ShowDemoWindow(&show_demo_window);
-        handleMouseInput();
-        // Draw the gui
+    //ImGui example gui
+    //ImGui::ShowDemoWindow(&show_demo_window);
+    handleMouseInput();
+    // Objects and textures that were loaded in the background are added before the gui is drawn.
+    {
+        PROFILE_SCOPE("Finish loads");
+        string loadOutput = finishLoads();
+        if(!loadOutput.empty()) log.addLog("%s", loadOutput.c_str());
+    }
+    // Draw the gui and measure how long it takes
+    double guiFrameTime;
+    {
+        PROFILE_SCOPE("DrawGui");
+        chrono::steady_clock::time_point guiStart = chrono::steady_clock::now();
         DrawGui();
+        guiFrameTime = chrono::duration<double, milli>(chrono::steady_clock::now() - guiStart).count();
+        stats.guiTime = 0.95*stats.guiTime + 0.05*guiFrameTime;
+    }
 
+    {
+        PROFILE_SCOPE("updateObject");
         updateObject(wContext.selectedObject);
         updateCamera();
         updateLight();
-        
-        // Call display in geomentryRender to render the scene
+    }
+    
+    // Call display in geomentryRender to render the scene
+    {
+        PROFILE_SCOPE("display");
+        PROFILE_GPU_PASS("Scene");
         display();
+    }
 
+    {
+        PROFILE_SCOPE("Render gui");
+        PROFILE_GPU_PASS("Gui");
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        
-        // Swap buffers
-        glfwSwapBuffers(glfwWindow);
-
-        // Sleep and wait for an event
-        //glfwWaitEvents();
     }
     
+    // Swap buffers
+    {
+        PROFILE_SCOPE("Swap buffers");
+        glfwSwapBuffers(glfwWindow);
+    }
+
+    // Everything that changed has been drawn.
+    wContext.dirty.clear();
+    return guiFrameTime;
 }
 
 /**
@@ -418,16 +544,27 @@ void Studio3D::DrawGui()
         StudioGui::objMatWindow(wInfo.showObjMatWindow, wContext.objects[wContext.selectedObject]);
         StudioGui::objInfWindow(wInfo.showObjInfWindow, wContext.objects[wContext.selectedObject].fileName, wContext.objects[wContext.selectedObject].oInfo);
     }
-    StudioGui::camWindow(wInfo.showCamWindow, wContext.cInfo, wContext.pZeroDefault, wContext.pRefDefault);
-    StudioGui::showLightSourcesWindow(wInfo.showLightSourcesWindow, wContext);
+    if(StudioGui::camWindow(wInfo.showCamWindow, wContext.cInfo, wContext.pZeroDefault, wContext.pRefDefault)) wContext.dirty.camera = true;
+    if(StudioGui::showLightSourcesWindow(wInfo.showLightSourcesWindow, wContext)) wContext.dirty.light = true;
     StudioGui::keyRefWindow(wInfo.showKeyRefWindow);
-    StudioGui::showStudioOverlay(wInfo.showOverlay, wContext);
+    StudioGui::showStudioOverlay(wInfo.showOverlay, wContext, objectLoads, textureLoads, stats);
 
     if(wInfo.openObjFileDialog) openObjectFile();
     if(wInfo.openTexFileDialog) openTextureFile();
 
     StudioGui::settingsWindow(wInfo.showSettingsWindow, wContext);
+    if(wContext.rInfo.runBVHBenchmark) {
+        log.addLog(SceneBVH::benchmark(10000).c_str());
+        wContext.rInfo.runBVHBenchmark = false;
+    }
+    if(wContext.lInfo.runNormalBenchmark) {
+        const Object &object = wContext.objects[wContext.selectedObject];
+        log.addLog(("\n" + object.fileName + ":").c_str());
+        log.addLog(NormalGenerator::benchmark(object.vertices, object.getTriangles()).c_str());
+        wContext.lInfo.runNormalBenchmark = false;
+    }
     StudioGui::logWindow(wInfo.showLogWindow, log);
+    StudioGui::profilerWindow(wInfo.showProfilerWindow, Profiler::shared());
 }
 
 /**
@@ -482,10 +619,21 @@ void Studio3D::openTextureFile()
 /**
  * Function for handling the mouse input. Depending on the direction the
  * mouse is moving changes the camera rotation offset ONLY if the 
- * left mouse button is pressed.
+ * left mouse button is pressed. A click that does not move the mouse
+ * selects the object under the cursor.
  */
 void Studio3D::handleMouseInput() 
 {
+    ImGuiIO &io = ImGui::GetIO();
+    if(ImGui::IsMouseReleased(ImGuiMouseButton_Left) && !io.WantCaptureMouse && !wContext.objects.empty()) {
+        glm::vec2 clickDelta = glm::vec2(io.MousePos.x - io.MouseClickedPos[0].x, io.MousePos.y - io.MouseClickedPos[0].y);
+        if(glm::length(clickDelta) < 3.0f && io.DisplaySize.x > 0.0f && io.DisplaySize.y > 0.0f) {
+            float ndcX = 2.0f*io.MousePos.x/io.DisplaySize.x - 1.0f;
+            float ndcY = 1.0f - 2.0f*io.MousePos.y/io.DisplaySize.y;
+            wContext.selectObjectAt(ndcX, ndcY);
+        }
+    }
+
     if(ImGui::IsMouseDragging(ImGuiMouseButton_Left, -1.0f) && !ImGui::IsWindowFocused(ImGuiFocusedFlags_AnyWindow)) {
         wContext.cInfo.camRotOffset = glm::vec3(-ImGui::GetIO().MouseDelta.x, -ImGui::GetIO().MouseDelta.y, 0.0f);
     } else {
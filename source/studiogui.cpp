@@ -59,6 +59,7 @@ namespace StudioGui
                 if(ImGui::MenuItem("Light Sources", "F6", wInfo.showLightSourcesWindow)) { wInfo.showLightSourcesWindow = !wInfo.showLightSourcesWindow; }
                 ImGui::SeparatorText("Studio");
                 if(ImGui::MenuItem("Studio Overlay", NULL, wInfo.showOverlay)) { wInfo.showOverlay = !wInfo.showOverlay; }
+                if(ImGui::MenuItem("Profiler", "F7", wInfo.showProfilerWindow)) { wInfo.showProfilerWindow = !wInfo.showProfilerWindow; }
                 if(ImGui::MenuItem("Log Window", "F9", wInfo.showLogWindow)) { wInfo.showLogWindow = ! wInfo.showLogWindow; }
                 ImGui::EndMenu();
             }
@@ -78,7 +79,9 @@ namespace StudioGui
     /**
      * Creates the scene window which contains all the loaded
      * objects and the ability to switch which object that
-     * is currently selected. The selected object will 
+     * is currently selected. Instances of each object can
+     * also be added and removed here, and each instance of the
+     * selected object can be placed. The selected object will 
      * be affected by transformations, loading textures and
      * such.
      * 
@@ -91,23 +94,38 @@ namespace StudioGui
         if(showWindow) {
             ImGui::Begin("Scene", &showWindow, ImGuiWindowFlags_AlwaysAutoResize);
             ImGui::SeparatorText("Current Loaded Objects:");
-            if(wContext.objects.size() == 0) {
+            const WorldContext::SceneSummary &summary = wContext.getSceneSummary();
+            if(summary.entries.size() == 0) {
                 ImGui::Text("No objects currently loaded!");
             } else {
-                int oIndex = 0;
-                for(Object object : wContext.objects) {
-                    bool disable = wContext.selectedObject == oIndex;
-                    char fileName[object.fileName.length()+1];
-                    strcpy(fileName, object.fileName.c_str());
+                for(size_t oIndex = 0; oIndex < summary.entries.size(); oIndex++) {
+                    const WorldContext::SceneSummary::Entry &entry = summary.entries[oIndex];
+                    bool disable = summary.selectedObject == (int)oIndex;
 
-                    ImGui::Text("%s", fileName); ImGui::SameLine(200);
-                    std::string buttonLabel = "Select ##" + std::to_string(oIndex);
+                    ImGui::TextUnformatted(entry.fileName.c_str()); ImGui::SameLine(200);
 
                     if(disable) ImGui::BeginDisabled();
-                    if(ImGui::Button(buttonLabel.c_str())) { wContext.selectedObject = oIndex; }
+                    if(ImGui::Button(entry.selectLabel.c_str())) { wContext.selectObject(oIndex); }
                     if(disable) ImGui::EndDisabled();
-                    oIndex++;
+
+                    ImGui::SameLine(); ImGui::Text("Instances: %d", entry.nInstances);
+                    ImGui::SameLine();
+                    if(ImGui::Button(entry.addInstanceLabel.c_str())) { wContext.addInstance(oIndex); }
+                    ImGui::SameLine();
+                    if(entry.nInstances <= 1) ImGui::BeginDisabled();
+                    if(ImGui::Button(entry.removeInstanceLabel.c_str())) { wContext.removeInstance(oIndex); }
+                    if(entry.nInstances <= 1) ImGui::EndDisabled();
                 }
+
+                ImGui::SeparatorText("Selected Instance:");
+                int instance = summary.selectedInstance;
+                int nInstances = summary.entries[summary.selectedObject].nInstances;
+                if(nInstances > 1 && ImGui::SliderInt("Instance", &instance, 0, nInstances - 1)) wContext.selectInstance(instance);
+                Object::InstanceTransform transform = summary.instanceTransform;
+                bool changed = ImGui::DragFloat3("Translation", &transform.translation.x, 0.05f);
+                changed |= ImGui::SliderFloat3("Rotation", &transform.rotation.x, -180.0f, 180.0f, "%.0f deg");
+                changed |= ImGui::SliderFloat("Scale", &transform.scale, 0.1f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+                if(changed) wContext.setInstanceTransform(transform);
             }
 
             ImGui::Separator();
@@ -126,28 +144,78 @@ namespace StudioGui
      * @param objFileName: The name of the selected object.
      * @param oInfo: The object information of the selected object.
      */
-    void objInfWindow(bool &showWindow, std::string objFileName, Object::ObjectInfo& oInfo)
+    void objInfWindow(bool &showWindow, const std::string &objFileName, Object::ObjectInfo& oInfo)
     {
         if(showWindow) {
             ImGui::Begin("Object Information", &showWindow, ImGuiWindowFlags_AlwaysAutoResize);
             ImGui::SeparatorText("Object Information");
             if(oInfo.objectLoaded) {
-                char fileName[objFileName.length()+1];
-                strcpy(fileName, objFileName.c_str());
-                ImGui::Text("Object File Name: %s", fileName);
+                ImGui::Text("Object File Name: %s", objFileName.c_str());
                 ImGui::Separator();
                 ImGui::Text("Shapes:");
                 ImGui::SameLine(200); ImGui::Text("%d", (int)oInfo.nShapes);
                 ImGui::Text("Vertices:");
-                ImGui::SameLine(200); ImGui::Text("%d", oInfo.nVertices);
+                ImGui::SameLine(200); ImGui::Text("%d (%d before welding)", oInfo.nVertices, oInfo.nUnweldedVertices);
                 ImGui::Text("Indices:");
                 ImGui::SameLine(200); ImGui::Text("%d", oInfo.nIndices);
                 ImGui::Text("Faces:");
                 ImGui::SameLine(200); ImGui::Text("%d", oInfo.nFaces);
                 ImGui::Text("Normals:");
-                ImGui::SameLine(200); ImGui::Text("%d", oInfo.nVertexNormals);
+                if(oInfo.normalsGenerated) {
+                    const char *weighting = oInfo.normalWeighting == NormalGenerator::ANGLE_WEIGHTED ? "angle" : "area";
+                    ImGui::SameLine(200); ImGui::Text("%d (generated, %s weighted)", oInfo.nVertexNormals, weighting);
+                } else {
+                    ImGui::SameLine(200); ImGui::Text("%d", oInfo.nVertexNormals);
+                }
                 ImGui::Text("Texture Coordinates:");
                 ImGui::SameLine(200); ImGui::Text("%d", oInfo.nTexCoords);
+                if(oInfo.meshOptimized) {
+                    ImGui::Text("Vertex Cache ACMR:");
+                    ImGui::SameLine(200); ImGui::Text("%.3f (%.3f before optimizing)", oInfo.cacheStats.acmr, oInfo.cacheStatsBefore.acmr);
+                    ImGui::Text("Vertex Cache ATVR:");
+                    ImGui::SameLine(200); ImGui::Text("%.3f (%.3f before optimizing)", oInfo.cacheStats.atvr, oInfo.cacheStatsBefore.atvr);
+                }
+                if(oInfo.normalsGenerated) {
+                    ImGui::Separator();
+                    ImGui::SliderFloat("Crease Angle", &oInfo.creaseAngle, 0.0f, 180.0f, "%.0f deg");
+                    oInfo.editingNormals = ImGui::IsItemActive();
+                    if(!oInfo.hasSmoothingGroups) ImGui::BeginDisabled();
+                    ImGui::Checkbox("Use Smoothing Groups", &oInfo.useSmoothingGroups);
+                    if(!oInfo.hasSmoothingGroups) ImGui::EndDisabled();
+                    ImGui::Text("Split Vertices:");
+                    ImGui::SameLine(200); ImGui::Text("%d", oInfo.nSplitVertices);
+                    ImGui::Text("Last Normal Update:");
+                    ImGui::SameLine(200); ImGui::Text("%.2f ms (%d vertices)", oInfo.normalUpdateTime, oInfo.nNormalsUpdated);
+                }
+                if(oInfo.lodErrors.size() > 0) {
+                    ImGui::Separator();
+                    ImGui::Text("Level of Detail:");
+                    ImGui::SameLine(200); ImGui::Text("%d of %d", oInfo.currentLod, (int)oInfo.lodErrors.size());
+                    for(size_t lod = 0; lod < oInfo.lodTriangles.size(); lod++) {
+                        float error = lod == 0 ? 0.0f : oInfo.lodErrors[lod - 1];
+                        ImGui::Text("  LOD %d:", (int)lod);
+                        ImGui::SameLine(200); ImGui::Text("%d triangles (error %.5f)", oInfo.lodTriangles[lod], error);
+                    }
+                } else if(oInfo.lodsOutdated) {
+                    ImGui::Separator();
+                    ImGui::Text("Level of Detail:");
+                    ImGui::SameLine(200); ImGui::Text("rebuilt when the crease angle is released");
+                }
+                ImGui::Separator();
+                size_t indexBytes = oInfo.nIndices*sizeof(unsigned int);
+                size_t vertexSize = oInfo.packedVertices ? sizeof(PackedVertex) : sizeof(Vertex);
+                ImGui::Text("GPU Buffer Size:");
+                ImGui::SameLine(200); ImGui::Text("%.1f KB (%d bytes per vertex)", (oInfo.nVertices*vertexSize + oInfo.indexBufferSize)/1024.0, (int)vertexSize);
+                ImGui::Text("Index Buffer Size:");
+                ImGui::SameLine(200); ImGui::Text("%.1f KB (%.1f KB with 32 bit indices)", oInfo.indexBufferSize/1024.0, oInfo.fullIndexBufferSize/1024.0);
+                if(oInfo.packedVertices) {
+                    const PackedVertex::QuantizationError &error = oInfo.quantizationError;
+                    ImGui::Text("Packing Error:");
+                    ImGui::SameLine(200); ImGui::Text("position %.2e (rms %.2e)", error.maxPosition, error.rmsPosition);
+                    ImGui::SameLine(); ImGui::Text("normal %.4f deg  uv %.2e", error.maxNormalDegrees, error.maxTexCoord);
+                }
+                ImGui::Text("Before Welding:");
+                ImGui::SameLine(200); ImGui::Text("%.1f KB", (oInfo.nUnweldedVertices*sizeof(Vertex) + indexBytes)/1024.0);
                 ImGui::Checkbox("Wireframe Mode", &oInfo.showWireFrame);
                 bool hasTexture = oInfo.hasTexture;
                 if(!hasTexture) ImGui::BeginDisabled();
@@ -242,9 +310,12 @@ namespace StudioGui
      * @param cInfo: The camera info, containing position and more.
      * @param defaultZero: The default camera position.
      * @param defaultRef: The default cameras reference point.
+     * 
+     * @return True if the camera was changed.
      */
-    void camWindow(bool &showWindow, WorldContext::CameraInfo &cInfo, glm::vec3 defaultZero, glm::vec3 defaultRef)
+    bool camWindow(bool &showWindow, WorldContext::CameraInfo &cInfo, glm::vec3 defaultZero, glm::vec3 defaultRef)
     {
+        bool changed = false;
         if(showWindow) {
             static ImGuiSliderFlags flags = ImGuiSliderFlags_AlwaysClamp;
             ImGui::Begin("Camera", &showWindow, ImGuiWindowFlags_AlwaysAutoResize);
@@ -264,26 +335,27 @@ namespace StudioGui
             ImGui::SeparatorText("Camera Transformations");
             ImGui::Text("Translation");
             ImGui::Text("Rotation");
-            if(ImGui::Button("Reset Camera Position")) { cInfo.pZero = defaultZero; }
-            if(ImGui::Button("Reset Reference Point")) { cInfo.pRef = defaultRef; }
+            if(ImGui::Button("Reset Camera Position")) { cInfo.pZero = defaultZero; changed = true; }
+            if(ImGui::Button("Reset Reference Point")) { cInfo.pRef = defaultRef; changed = true; }
             ImGui::SeparatorText("Projection");
             const char* items[] = {"Perspective", "Parallel" };
             static int proj_current_idx = 0;
-            if (ImGui::Combo("Projection type", &proj_current_idx, items, IM_ARRAYSIZE(items), IM_ARRAYSIZE(items)));
+            if (ImGui::Combo("Projection type", &proj_current_idx, items, IM_ARRAYSIZE(items), IM_ARRAYSIZE(items))) changed = true;
             if (proj_current_idx == 0) {
                 cInfo.perspProj = true;
-                ImGui::SliderFloat("Field of view",&cInfo.fov, 20.0f, 160.0f, "%1.0f", flags);
-                ImGui::SliderFloat("Far",&cInfo.farPlane, 1.0f, 1000.0f, "%1.0f", flags);
+                changed |= ImGui::SliderFloat("Field of view",&cInfo.fov, 20.0f, 160.0f, "%1.0f", flags);
+                changed |= ImGui::SliderFloat("Far",&cInfo.farPlane, 1.0f, 1000.0f, "%1.0f", flags);
             }
             if (proj_current_idx == 1) {
                 cInfo.perspProj = false;
-                ImGui::SliderFloat("Top",&cInfo.top, 1.0f, 100.0f, "%.1f", flags);
-                ImGui::SliderFloat("Far",&cInfo.farPlane, 1.0f, 1000.0f, "%1.0f", flags);
-                ImGui::SliderFloat("Oblique scale",&cInfo.obliqueScale, 0.0f, 1.0f, "%.1f", flags);
-                ImGui::SliderAngle("Oblique angle",&cInfo.obliqueAngleRad, 15, 75, "%1.0f", flags);
+                changed |= ImGui::SliderFloat("Top",&cInfo.top, 1.0f, 100.0f, "%.1f", flags);
+                changed |= ImGui::SliderFloat("Far",&cInfo.farPlane, 1.0f, 1000.0f, "%1.0f", flags);
+                changed |= ImGui::SliderFloat("Oblique scale",&cInfo.obliqueScale, 0.0f, 1.0f, "%.1f", flags);
+                changed |= ImGui::SliderAngle("Oblique angle",&cInfo.obliqueAngleRad, 15, 75, "%1.0f", flags);
             }
             ImGui::End();
         }
+        return changed;
     }
 
     /**
@@ -295,9 +367,12 @@ namespace StudioGui
      * 
      * @param showWindow: Bool if the window should be visible.
      * @param wContext: The world context, which holds the light information.
+     * 
+     * @return True if the light was changed.
      */
-    void showLightSourcesWindow(bool &showWindow, WorldContext& wContext)
+    bool showLightSourcesWindow(bool &showWindow, WorldContext& wContext)
     {
+        bool changed = false;
         if(showWindow) {
             static ImGuiSliderFlags flags = ImGuiSliderFlags_AlwaysClamp;
             ImGui::Begin("Light Sources", &showWindow, ImGuiWindowFlags_AlwaysAutoResize);
@@ -308,33 +383,34 @@ namespace StudioGui
             ImGui::Text("Y: %.3f", wContext.light.position.y); ImGui::SameLine(); 
             ImGui::Text("Z: %.3f", wContext.light.position.z);
             ImGui::PopItemWidth();
-            ImGui::SliderFloat("X",&wContext.light.position.x, -10.0f, 10.0f, "%.2f", flags);
-            ImGui::SliderFloat("Y",&wContext.light.position.y, -10.0f, 10.0f, "%.2f", flags);
-            ImGui::SliderFloat("Z",&wContext.light.position.z, -10.0f, 10.0f, "%.2f", flags);
-            if(ImGui::Button("Reset Light Direction")) { wContext.light.resetDir(); }
+            changed |= ImGui::SliderFloat("X",&wContext.light.position.x, -10.0f, 10.0f, "%.2f", flags);
+            changed |= ImGui::SliderFloat("Y",&wContext.light.position.y, -10.0f, 10.0f, "%.2f", flags);
+            changed |= ImGui::SliderFloat("Z",&wContext.light.position.z, -10.0f, 10.0f, "%.2f", flags);
+            if(ImGui::Button("Reset Light Direction")) { wContext.light.resetDir(); changed = true; }
             ImGui::SeparatorText("Color");
             ImGui::PushItemWidth(100);
             ImGui::Text("R: %.3f", wContext.light.color.x); ImGui::SameLine(); 
             ImGui::Text("G: %.3f", wContext.light.color.y); ImGui::SameLine(); 
             ImGui::Text("B: %.3f", wContext.light.color.z);
             ImGui::PopItemWidth();
-            ImGui::SliderFloat("R",&wContext.light.color.x, 0.0f, 1.0f, "%.2f", flags);
-            ImGui::SliderFloat("G",&wContext.light.color.y, 0.0f, 1.0f, "%.2f", flags);
-            ImGui::SliderFloat("B",&wContext.light.color.z, 0.0f, 1.0f, "%.2f", flags);
-            if(ImGui::Button("Reset Light Color")) { wContext.light.resetColor(); }
+            changed |= ImGui::SliderFloat("R",&wContext.light.color.x, 0.0f, 1.0f, "%.2f", flags);
+            changed |= ImGui::SliderFloat("G",&wContext.light.color.y, 0.0f, 1.0f, "%.2f", flags);
+            changed |= ImGui::SliderFloat("B",&wContext.light.color.z, 0.0f, 1.0f, "%.2f", flags);
+            if(ImGui::Button("Reset Light Color")) { wContext.light.resetColor(); changed = true; }
             ImGui::SeparatorText("Ambient Light Intensity");
             ImGui::PushItemWidth(100);
             ImGui::Text("R: %.3f", wContext.ambientLight.x); ImGui::SameLine(); 
             ImGui::Text("G: %.3f", wContext.ambientLight.y); ImGui::SameLine(); 
             ImGui::Text("B: %.3f", wContext.ambientLight.z);
             ImGui::PopItemWidth();
-            ImGui::SliderFloat("R##1",&wContext.ambientLight.x, 0.0f, 1.0f, "%.2f", flags);
-            ImGui::SliderFloat("G##1",&wContext.ambientLight.y, 0.0f, 1.0f, "%.2f", flags);
-            ImGui::SliderFloat("B##1",&wContext.ambientLight.z, 0.0f, 1.0f, "%.2f", flags);
+            changed |= ImGui::SliderFloat("R##1",&wContext.ambientLight.x, 0.0f, 1.0f, "%.2f", flags);
+            changed |= ImGui::SliderFloat("G##1",&wContext.ambientLight.y, 0.0f, 1.0f, "%.2f", flags);
+            changed |= ImGui::SliderFloat("B##1",&wContext.ambientLight.z, 0.0f, 1.0f, "%.2f", flags);
 
-            if(ImGui::Button("Reset Ambient Intensity")) { wContext.ambientLight = wContext.defaultAmbientLight; }
+            if(ImGui::Button("Reset Ambient Intensity")) { wContext.ambientLight = wContext.defaultAmbientLight; changed = true; }
             ImGui::End();
         }
+        return changed;
     }
     
     /**
@@ -383,6 +459,7 @@ namespace StudioGui
             ImGui::Text("Object Information:"); ImGui::SameLine(margin); ImGui::Text("'F4'");
             ImGui::Text("Camera Information:"); ImGui::SameLine(margin); ImGui::Text("'F5'");
             ImGui::Text("Light Sources:"); ImGui::SameLine(margin); ImGui::Text("'F6'");
+            ImGui::Text("Profiler:"); ImGui::SameLine(margin); ImGui::Text("'F7'");
             ImGui::Text("Log Window:"); ImGui::SameLine(margin); ImGui::Text("'F9'");
             ImGui::Text("Keyboard Shortcuts:"); ImGui::SameLine(margin); ImGui::Text("'F10'");
 
@@ -394,12 +471,14 @@ namespace StudioGui
      * Function for creating the studio overlay. This overlay will
      * display the version of the program and all loaded objects.
      * It will also be displayed here which object that is currently
-     * selected.
+     * selected, and how many OpenGL objects that are alive which
+     * shows if any GPU memory is leaked when the scene is reset.
      * 
      * @param showOverlay: Bool if the overlay should be visible.
      * @param wContext: The world context, holds information regarding objects.
+     * @param stats: How long the gui takes to build and how much cpu the program uses.
      */
-    void showStudioOverlay(bool &showOverlay, WorldContext wContext)
+    void showStudioOverlay(bool &showOverlay, const WorldContext &wContext, AsyncLoader &objectLoads, const TextureLoader &textureLoads, const Studio3D::FrameStats &stats)
     {
         if(showOverlay) {
             static int location = 0;
@@ -419,23 +498,54 @@ namespace StudioGui
             ImGui::SetNextWindowBgAlpha(0.35f);
             if(ImGui::Begin("Overlay", &showOverlay, window_flags))
             {
-                string selected;
+                const WorldContext::SceneSummary &summary = wContext.getSceneSummary();
                 ImGui::SeparatorText(VERSION);
-                if(wContext.objects.size() != 0) {
+                if(summary.entries.size() != 0) {
                     ImGui::Text("Loaded object(s):");
-                    int oIndex = 0;
-                    for(Object object : wContext.objects) {
-                        char fileName[object.fileName.length()+1];
-                        strcpy(fileName, object.fileName.c_str());
-                        if(wContext.selectedObject == oIndex) {
-                            selected = "(Selected)";
-                        } else {
-                            selected = "";
-                        }
-                        ImGui::Text("%s %s", fileName, selected.c_str());
-                        oIndex++;
+                    for(size_t oIndex = 0; oIndex < summary.entries.size(); oIndex++) {
+                        const char *selected = summary.selectedObject == (int)oIndex ? "(Selected)" : "";
+                        ImGui::Text("%s %s", summary.entries[oIndex].fileName.c_str(), selected);
                     }
                 }
+                vector<AsyncLoader::Status> loads = objectLoads.getStatus();
+                for(size_t l = 0; l < loads.size(); l++) {
+                    const AsyncLoader::Status &load = loads[l];
+                    ImGui::Separator();
+                    ImGui::Text("Loading %s: %s", load.fileName.c_str(), load.cancelled ? "Cancelling" : LoadProgress::stageName(load.stage));
+                    float fraction = load.totalBytes > 0 ? static_cast<float>(load.bytesParsed)/load.totalBytes : 0.0f;
+                    char progressText[64];
+                    snprintf(progressText, sizeof(progressText), "%.1f / %.1f MB", load.bytesParsed/1048576.0, load.totalBytes/1048576.0);
+                    ImGui::ProgressBar(fraction, ImVec2(200.0f, 0.0f), load.totalBytes > 0 ? progressText : "");
+                    ImGui::SameLine();
+                    ImGui::PushID(static_cast<int>(l));
+                    if(load.cancelled) ImGui::BeginDisabled();
+                    if(ImGui::SmallButton("Cancel")) objectLoads.cancel(l);
+                    if(load.cancelled) ImGui::EndDisabled();
+                    ImGui::PopID();
+                }
+                vector<TextureLoader::Status> textures = textureLoads.getStatus();
+                for(const TextureLoader::Status &texture : textures) {
+                    ImGui::Separator();
+                    ImGui::Text("Loading texture %s: %s", texture.fileName.c_str(), texture.decoded ? "Uploading" : "Decoding");
+                    float fraction = texture.totalBytes > 0 ? static_cast<float>(texture.bytesUploaded)/texture.totalBytes : 0.0f;
+                    char progressText[64];
+                    snprintf(progressText, sizeof(progressText), "%.1f / %.1f MB", texture.bytesUploaded/1048576.0, texture.totalBytes/1048576.0);
+                    ImGui::ProgressBar(fraction, ImVec2(200.0f, 0.0f), texture.totalBytes > 0 ? progressText : "");
+                }
+                ImGui::Separator();
+                ImGui::Text("Scene vertices: %lld  indices: %lld", summary.totalVertices, summary.totalIndices);
+                ImGui::Text("Draw calls: %d", wContext.rInfo.nDrawCalls);
+                ImGui::Text("Triangles drawn: %lld", wContext.rInfo.nTrianglesDrawn);
+                ImGui::Text("Objects drawn: %d  culled: %d", wContext.rInfo.nObjectsDrawn, wContext.rInfo.nObjectsCulled);
+                ImGui::Text("Material groups drawn: %d  culled: %d", wContext.rInfo.nGroupsDrawn, wContext.rInfo.nGroupsCulled);
+                ImGui::Text("Culling time: %.3f ms", wContext.rInfo.cullTime);
+                ImGui::Text("Last pick time: %.1f us", wContext.rInfo.pickTime);
+                ImGui::Text("GUI time: %.3f ms", stats.guiTime);
+                ImGui::Text("CPU: %.1f %%  Frames per second: %.0f", stats.cpuUsage, stats.framesPerSecond);
+                ImGui::Separator();
+                ImGui::Text("GPU objects alive:");
+                ImGui::Text("Buffers: %d  Vertex arrays: %d  Textures: %d",
+                            (int)GLBuffer::aliveCount(), (int)GLVertexArray::aliveCount(), (int)GLTexture::aliveCount());
                 if (ImGui::BeginPopupContextWindow())
                 {
                     if (ImGui::MenuItem("Top-left (default)",     NULL, location == 0)) location = 0;
@@ -520,9 +630,128 @@ namespace StudioGui
             ImGui::SliderFloat("##3", &wContext.ROT_SPEED, 0.0f, 10.0f, "%.2f", flags);
             ImGui::Text("Scaling Speed");
             ImGui::SliderFloat("##4", &wContext.SCA_SPEED, 0.0f, 1.0f, "%.2f", flags);
+            ImGui::SeparatorText("Loader Settings");
+            ImGui::Checkbox("Use mesh cache", &wContext.lInfo.useMeshCache);
+            ImGui::Checkbox("Use parallel OBJ parser", &wContext.lInfo.useParallelParser);
+            ImGui::Combo("Generated normals", &wContext.lInfo.normalWeighting, "Area weighted\0Angle weighted\0");
+            ImGui::SliderFloat("Crease angle", &wContext.lInfo.creaseAngle, 0.0f, 180.0f, "%.0f deg");
+            ImGui::Checkbox("Use smoothing groups", &wContext.lInfo.useSmoothingGroups);
+            ImGui::Checkbox("Optimize meshes for the GPU", &wContext.lInfo.optimizeMeshes);
+            ImGui::Checkbox("Generate levels of detail", &wContext.lInfo.generateLods);
+            if(wContext.objects.empty()) ImGui::BeginDisabled();
+            if(ImGui::Button("Run normal generation benchmark")) wContext.lInfo.runNormalBenchmark = true;
+            if(wContext.objects.empty()) ImGui::EndDisabled();
+            ImGui::SeparatorText("Render Settings");
+            if(!wContext.rInfo.multiDrawSupported) ImGui::BeginDisabled();
+            ImGui::Checkbox("Use multi-draw indirect", &wContext.rInfo.useMultiDraw);
+            if(!wContext.rInfo.multiDrawSupported) ImGui::EndDisabled();
+            ImGui::Checkbox("Use frustum culling", &wContext.rInfo.useFrustumCulling);
+            ImGui::Checkbox("Use scene BVH", &wContext.rInfo.useSceneBVH);
+            if(ImGui::Button("Run scene BVH benchmark")) wContext.rInfo.runBVHBenchmark = true;
+            ImGui::Checkbox("Use packed vertices", &wContext.rInfo.usePackedVertices);
+            ImGui::Checkbox("Use 16-bit indices", &wContext.rInfo.useShortIndices);
+            ImGui::Checkbox("Use levels of detail", &wContext.rInfo.useLods);
+            ImGui::SliderFloat("LOD pixel error", &wContext.rInfo.lodPixelError, 0.25f, 8.0f, "%.2f px");
+            ImGui::Checkbox("Only redraw when something changes", &wContext.rInfo.renderOnDemand);
+            ImGui::SliderFloat("Texture upload budget", &wContext.rInfo.textureUploadBudget, 0.25f, 16.0f, "%.2f MB/frame");
 
             ImGui::End();
         }
     }
 
+    /**
+     * Function for creating the profiler window. It shows the time of
+     * the kept frames as a histogram, and the scopes of one frame as a
+     * flame graph where each row is one level deeper. Clicking a bar in
+     * the histogram pauses the profiler and shows that frame. The kept
+     * frames can be written as a Chrome trace.
+     * 
+     * @param showWindow: Bool if the window should be visible.
+     * @param profiler: The profiler that records the frames.
+     */
+    void profilerWindow(bool &showWindow, Profiler &profiler)
+    {
+        if(!showWindow) return;
+        static int selectedAge = 0;
+        static string exportStatus;
+        ImGui::SetNextWindowSize(ImVec2(600.0f, 400.0f), ImGuiCond_FirstUseEver);
+        ImGui::Begin("Profiler", &showWindow);
+#ifdef NO_PROFILER
+        ImGui::TextDisabled("The profiler is compiled out with NO_PROFILER.");
+#endif
+        size_t nFrames = profiler.frameCount();
+        if(nFrames == 0) {
+            ImGui::Text("No frames recorded yet.");
+            ImGui::End();
+            return;
+        }
+        ImGui::Checkbox("Pause", &profiler.paused);
+        ImGui::SameLine();
+        if(ImGui::Button("Export Chrome trace")) {
+            exportStatus = profiler.writeChromeTrace("profile.json") ? "Wrote profile.json" : "Could not write profile.json";
+        }
+        if(!exportStatus.empty()) {
+            ImGui::SameLine();
+            ImGui::Text("%s", exportStatus.c_str());
+        }
+
+        // Frame times, oldest first.
+        vector<float> frameTimes(nFrames);
+        float totalTime = 0.0f, maxTime = 0.0f;
+        for(size_t i = 0; i < nFrames; i++) {
+            frameTimes[i] = profiler.frame(nFrames - 1 - i).duration/1.0e6f;
+            totalTime += frameTimes[i];
+            maxTime = std::max(maxTime, frameTimes[i]);
+        }
+        char histogramText[64];
+        snprintf(histogramText, sizeof(histogramText), "avg %.2f ms  max %.2f ms", totalTime/nFrames, maxTime);
+        float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+        ImGui::PlotHistogram("##frameTimes", frameTimes.data(), static_cast<int>(nFrames), 0, histogramText, 0.0f, maxTime*1.1f, ImVec2(width, 80.0f));
+        if(ImGui::IsItemClicked()) {
+            float t = (ImGui::GetIO().MousePos.x - ImGui::GetItemRectMin().x)/ImGui::GetItemRectSize().x;
+            int index = std::max(0, std::min(static_cast<int>(nFrames) - 1, static_cast<int>(t*nFrames)));
+            selectedAge = static_cast<int>(nFrames) - 1 - index;
+            profiler.paused = true;
+        }
+        ImGui::SliderInt("Frames ago", &selectedAge, 0, static_cast<int>(nFrames) - 1);
+        selectedAge = std::max(0, std::min(selectedAge, static_cast<int>(nFrames) - 1));
+
+        const Profiler::Frame &frame = profiler.frame(selectedAge);
+        ImGui::Text("Frame %llu: %.3f ms", static_cast<unsigned long long>(frame.number), frame.duration/1.0e6);
+        for(const Profiler::GpuPass &pass : frame.gpuPasses) {
+            ImGui::SameLine();
+            if(pass.time >= 0) ImGui::Text("  GPU %s: %.3f ms", pass.name, pass.time/1.0e6);
+            else ImGui::Text("  GPU %s: waiting", pass.name);
+        }
+
+        // The flame graph, the whole width is the frame.
+        int maxDepth = 0;
+        for(const Profiler::Scope &scope : frame.scopes) maxDepth = std::max(maxDepth, scope.depth);
+        float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton("##flameGraph", ImVec2(width, rowHeight*(maxDepth + 1)));
+        bool hovered = ImGui::IsItemHovered();
+        ImVec2 mouse = ImGui::GetIO().MousePos;
+        ImDrawList *drawList = ImGui::GetWindowDrawList();
+        double scale = width/std::max<double>(static_cast<double>(frame.duration), 1.0);
+        for(const Profiler::Scope &scope : frame.scopes) {
+            int64_t end = scope.end < 0 ? frame.duration : scope.end;
+            ImVec2 min(origin.x + static_cast<float>(scope.start*scale), origin.y + scope.depth*rowHeight);
+            ImVec2 max(std::max(min.x + 1.0f, origin.x + static_cast<float>(end*scale)), min.y + rowHeight - 1.0f);
+            // The same name always gets the same color.
+            unsigned int hash = 2166136261u;
+            for(const char *c = scope.name; *c; c++) hash = (hash ^ static_cast<unsigned char>(*c))*16777619u;
+            drawList->AddRectFilled(min, max, ImColor::HSV((hash % 360)/360.0f, 0.5f, 0.8f));
+            if(max.x - min.x > 20.0f) {
+                drawList->PushClipRect(min, max, true);
+                drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(0, 0, 0, 255), scope.name);
+                drawList->PopClipRect();
+            }
+            if(hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+                ImGui::SetTooltip("%s: %.3f ms", scope.name, (end - scope.start)/1.0e6);
+            }
+        }
+        ImGui::End();
+    }
+
 }
\ No newline at end of file
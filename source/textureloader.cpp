@@ -0,0 +1,231 @@
+#include "textureloader.h"
+#include "threadpool.h"
+#include "stb_image.h"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * This class loads textures in the background and uploads them to the
+ * GPU a few rows at a time.
+ */
+
+// The formats of the texture and the pixels for 1, 2, 3 and 4 channels.
+static const GLint INTERNAL_FORMATS[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+static const GLenum PIXEL_FORMATS[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+/**
+ * Frees the decoded pixels, if they were never uploaded.
+ */
+TextureLoader::Job::~Job()
+{
+    if(pixels) stbi_image_free(pixels);
+}
+
+/**
+ * Function for starting to load a texture. The file is decoded by the
+ * shared thread pool, and uploaded by later calls to upload.
+ *
+ * @param fileName: The name of the image file.
+ * @param filePath: The directory of the image file.
+ * @param objectIndex: The index of the object that the texture is for.
+ * @param objectName: The file name of that object, to check that it is still the same object when the texture is done.
+ */
+void TextureLoader::start(const string &fileName, const string &filePath, int objectIndex, const string &objectName)
+{
+    shared_ptr<Job> job(new Job());
+    job->fileName = fileName;
+    job->filePath = filePath;
+    job->objectIndex = objectIndex;
+    job->objectName = objectName;
+    jobs.push_back(job);
+    ThreadPool::shared().enqueue([job]() {
+        decode(*job);
+        job->decoded = true;
+    });
+}
+
+/**
+ * Function for uploading decoded textures, oldest first, until the
+ * budget is used up. At least one row is uploaded per call, even if
+ * that row is larger than the budget, so every texture finishes.
+ * Must be called from the thread that owns the OpenGL context.
+ *
+ * @param byteBudget: The largest number of bytes to upload.
+ */
+void TextureLoader::upload(size_t byteBudget)
+{
+    size_t remaining = byteBudget;
+    bool uploaded = false;
+    for(shared_ptr<Job> &job : jobs) {
+        if(job->finished || !job->decoded) continue;
+        if(!job->pixels) {
+            job->finished = true;
+            continue;
+        }
+        if(!job->texture.valid()) beginUpload(*job);
+
+        while(job->rowsUploaded < job->height) {
+            if(remaining < job->rowBytes() && uploaded) return;
+            size_t bytes = uploadRows(*job, remaining > job->rowBytes() ? remaining : job->rowBytes());
+            remaining = bytes < remaining ? remaining - bytes : 0;
+            uploaded = true;
+        }
+        endUpload(*job);
+    }
+}
+
+/**
+ * Function for taking the oldest load, if it has finished. The loads
+ * are taken in the order they were started, so if two textures are
+ * loaded for the same object the last one is kept.
+ *
+ * @param result: Set to the texture and the object it is for.
+ *
+ * @return True if a load was taken.
+ */
+bool TextureLoader::takeFinished(Result &result)
+{
+    if(jobs.empty() || !jobs.front()->finished) return false;
+    Job &job = *jobs.front();
+    result.fileName = job.fileName;
+    result.objectIndex = job.objectIndex;
+    result.objectName = job.objectName;
+    result.success = job.error.empty();
+    if(result.success) {
+        char info[128];
+        snprintf(info, sizeof(info), "\t%d x %d pixels, %d channel(s), %.1f KB\n",
+                 job.width, job.height, job.nChannels, job.totalBytes()/1024.0);
+        result.output = info;
+    } else {
+        result.output = "\t" + job.error + "\n";
+    }
+    result.texture = move(job.texture);
+    jobs.erase(jobs.begin());
+    return true;
+}
+
+/**
+ * Function for getting the progress of all loads that have not been taken.
+ *
+ * @return The status of each load, oldest first.
+ */
+vector<TextureLoader::Status> TextureLoader::getStatus() const
+{
+    vector<Status> status;
+    for(const shared_ptr<Job> &job : jobs) {
+        bool decoded = job->decoded;
+        Status s = { job->fileName, decoded, decoded ? job->rowsUploaded*job->rowBytes() : 0, decoded ? job->totalBytes() : 0 };
+        status.push_back(s);
+    }
+    return status;
+}
+
+/**
+ * Function for decoding the image file of a job. Runs on a worker thread
+ * and never touches OpenGL.
+ *
+ * @param job: The job, its pixels or error is set.
+ */
+void TextureLoader::decode(Job &job)
+{
+    string path = job.filePath + "/" + job.fileName;
+    job.pixels = stbi_load(path.c_str(), &job.width, &job.height, &job.nChannels, 0);
+    if(!job.pixels) {
+        const char *reason = stbi_failure_reason();
+        job.error = "Could not decode " + path + (reason ? string(": ") + reason : string());
+    } else if(job.nChannels < 1 || job.nChannels > 4 || job.width <= 0 || job.height <= 0) {
+        job.error = "Unsupported image " + path;
+        stbi_image_free(job.pixels);
+        job.pixels = NULL;
+    }
+}
+
+/**
+ * Function for creating the texture of a job, without any pixels, and
+ * the pixel buffer that the rows are copied through.
+ *
+ * @param job: The decoded job.
+ */
+void TextureLoader::beginUpload(Job &job)
+{
+    int format = job.nChannels - 1;
+    job.texture.create();
+    glBindTexture(GL_TEXTURE_2D, job.texture.id());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Grey images are stored in red (and alpha in green), the shader should see them as grey.
+    if(job.nChannels <= 2) {
+        GLint swizzle[] = { GL_RED, GL_RED, GL_RED, job.nChannels == 2 ? GL_GREEN : GL_ONE };
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, INTERNAL_FORMATS[format], job.width, job.height, 0, PIXEL_FORMATS[format], GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    job.pixelBuffer.create();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.pixelBuffer.id());
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, job.totalBytes(), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/**
+ * Function for uploading the next rows of a job. The rows are copied
+ * into their part of the pixel buffer, which is never used before, so
+ * it can be written without waiting for the GPU. The texture is then
+ * filled from the buffer.
+ *
+ * @param job: The job, with its upload begun.
+ * @param byteBudget: The largest number of bytes to upload, at least one row.
+ *
+ * @return The number of bytes uploaded.
+ */
+size_t TextureLoader::uploadRows(Job &job, size_t byteBudget)
+{
+    size_t rowBytes = job.rowBytes();
+    size_t rows = byteBudget/rowBytes;
+    if(rows > static_cast<size_t>(job.height - job.rowsUploaded)) rows = job.height - job.rowsUploaded;
+    size_t offset = job.rowsUploaded*rowBytes;
+    size_t bytes = rows*rowBytes;
+    int format = job.nChannels - 1;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job.pixelBuffer.id());
+    void *destination = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes,
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if(destination) {
+        memcpy(destination, job.pixels + offset, bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        glBufferSubData(GL_PIXEL_UNPACK_BUFFER, offset, bytes, job.pixels + offset);
+    }
+
+    // Rows of 1 and 3 channel images are not aligned to 4 bytes.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, job.texture.id());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.rowsUploaded, job.width, static_cast<GLsizei>(rows),
+                    PIXEL_FORMATS[format], GL_UNSIGNED_BYTE, reinterpret_cast<void*>(static_cast<uintptr_t>(offset)));
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    job.rowsUploaded += static_cast<int>(rows);
+    return bytes;
+}
+
+/**
+ * Function for finishing the texture of a job once all rows are
+ * uploaded. The mipmaps are built and the pixels are freed.
+ *
+ * @param job: The job, with all rows uploaded.
+ */
+void TextureLoader::endUpload(Job &job)
+{
+    glBindTexture(GL_TEXTURE_2D, job.texture.id());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    job.pixelBuffer.destroy();
+    stbi_image_free(job.pixels);
+    job.pixels = NULL;
+    job.finished = true;
+}
@@ -0,0 +1,141 @@
+#include "threadpool.h"
+#include <memory>
+#include <algorithm>
+
+/**
+ * This class represents a fixed size pool of worker threads. Tasks
+ * are put in a queue and picked up by the first idle worker. The
+ * pool is used for the work in the program that can be split into
+ * independent parts, such as parsing large object files.
+ */
+
+/**
+ * Constructor of the thread pool. Starts all the worker threads
+ * which will wait until a task is added to the queue.
+ *
+ * @param nThreads: The number of worker threads, 0 uses one
+ *                  thread per hardware core.
+ */
+ThreadPool::ThreadPool(size_t nThreads)
+{
+    if(nThreads == 0) nThreads = thread::hardware_concurrency();
+    if(nThreads == 0) nThreads = 1;
+
+    for(size_t i = 0; i < nThreads; i++) {
+        workers.push_back(thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+/**
+ * Deconstructor of the thread pool. Lets the workers finish all
+ * the queued tasks and then joins them.
+ */
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for(thread &worker : workers) worker.join();
+}
+
+/**
+ * Function for getting the thread pool that is shared by the
+ * whole program. The pool is created on the first call.
+ *
+ * @return The shared thread pool.
+ */
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+/**
+ * Function for adding a task to the queue. The task will be run
+ * by the first worker that becomes idle.
+ *
+ * @param task: The task to be run.
+ */
+void ThreadPool::enqueue(function<void()> task)
+{
+    {
+        lock_guard<mutex> lock(queueMutex);
+        tasks.push(move(task));
+    }
+    queueCondition.notify_one();
+}
+
+/**
+ * Function for running a task once for each index in [0, nTasks)
+ * on the worker threads. The calling thread also takes part in
+ * running the tasks and the function returns when all of them
+ * are done, which also makes it safe to call from a worker.
+ *
+ * @param nTasks: The number of times the task should be run.
+ * @param task: The task, called with the index of the run.
+ */
+void ThreadPool::parallelFor(size_t nTasks, const function<void(size_t)> &task)
+{
+    if(nTasks == 0) return;
+    if(nTasks == 1) {
+        task(0);
+        return;
+    }
+
+    struct SharedState {
+        mutex doneMutex;
+        condition_variable doneCondition;
+        size_t nextTask = 0;
+        size_t nDone = 0;
+    };
+
+    // The state is shared since a helper may only start after all tasks are done.
+    shared_ptr<SharedState> state = make_shared<SharedState>();
+    const function<void(size_t)> *taskPtr = &task;
+
+    // Every runner keeps taking the next task index until all are taken.
+    function<void()> runner = [state, taskPtr, nTasks]() {
+        while(true) {
+            size_t t;
+            {
+                lock_guard<mutex> lock(state->doneMutex);
+                if(state->nextTask >= nTasks) return;
+                t = state->nextTask++;
+            }
+            (*taskPtr)(t);
+            {
+                lock_guard<mutex> lock(state->doneMutex);
+                state->nDone++;
+            }
+            state->doneCondition.notify_all();
+        }
+    };
+
+    size_t nHelpers = min(workers.size(), nTasks - 1);
+    for(size_t i = 0; i < nHelpers; i++) enqueue(runner);
+    runner();
+
+    unique_lock<mutex> lock(state->doneMutex);
+    state->doneCondition.wait(lock, [&state, nTasks]() { return state->nDone == nTasks; });
+}
+
+/**
+ * The loop that every worker thread runs. Waits for tasks in
+ * the queue and runs them until the pool is destroyed.
+ */
+void ThreadPool::workerLoop()
+{
+    while(true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if(stopping && tasks.empty()) return;
+            task = move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
@@ -32,13 +32,55 @@ float WorldContext::getAspectRatio()
  * Function for updating the matrices that is used
  * to produce the scene. Only the selected objects
  * model matrix will be updated when transformations
- * are occurring.
+ * are occurring, and the camera matrices are only
+ * made again if the camera has changed.
  */
 void WorldContext::updateMatrices() 
 {
-    objects[selectedObject].updateModelMatrix(tInfo.tVals, tInfo.scVal, tInfo.rVals, ROT_SPEED, tInfo.reset);
-    updateViewMatrix();
-    updateProjMatrix();
+    if(!objects.empty() && isTransforming()) {
+        objects[selectedObject].updateModelMatrix(tInfo.tVals, tInfo.scVal, tInfo.rVals, ROT_SPEED, tInfo.reset);
+        dirty.objects = true;
+    }
+    if(dirty.objects) sceneBVH.update(objects);
+
+    if(isCameraMoving()) dirty.camera = true;
+    if(dirty.camera) {
+        updateViewMatrix();
+        updateProjMatrix();
+    }
+}
+
+/**
+ * Function for checking if the camera or the selected object
+ * is being moved by a held key or a mouse drag, which changes
+ * the scene every frame until it is let go.
+ * 
+ * @return True if something is moving.
+ */
+bool WorldContext::isMoving() const
+{
+    return isTransforming() || isCameraMoving();
+}
+
+/**
+ * Function for checking if the selected object is being
+ * translated, scaled, rotated or reset.
+ * 
+ * @return True if the model matrix will change.
+ */
+bool WorldContext::isTransforming() const
+{
+    return tInfo.tVals != glm::vec3(0.0f) || tInfo.rVals != glm::vec3(0.0f) || tInfo.scVal != 0.0f || tInfo.reset;
+}
+
+/**
+ * Function for checking if the camera is being moved or rotated.
+ * 
+ * @return True if the view matrix will change.
+ */
+bool WorldContext::isCameraMoving() const
+{
+    return cInfo.camOffset != glm::vec3(0.0f) || cInfo.camRotOffset != glm::vec3(0.0f);
 }
 
 /**
@@ -112,6 +154,175 @@ glm::mat4x4 WorldContext::obliqueProjection(glm::mat4x4 m, float a, float angle)
     return m*shearMat;
 }
 
+/**
+ * Function for adding a loaded object to the scene.
+ * 
+ * @param object: The object to be moved into the scene.
+ */
+void WorldContext::addObject(Object &&object)
+{
+    objects.push_back(move(object));
+    sceneSummary.geometryRevision++;
+    sceneBVH.build(objects);
+    updateSceneSummary();
+}
+
+/**
+ * Function for selecting which object that should be
+ * affected by transformations, textures and such.
+ * 
+ * @param objIndex: The index of the object to select.
+ */
+void WorldContext::selectObject(int objIndex)
+{
+    selectedObject = objIndex;
+    selectedInstance = 0;
+    updateSceneSummary();
+}
+
+/**
+ * Function for finding the object that a ray hits first. The scene
+ * BVH gives the instances whose boxes the ray hits, sorted by distance,
+ * and the ray is then tested against the triangles of each instance
+ * until no closer box is left.
+ * 
+ * @param origin: The origin of the ray, in world coordinates.
+ * @param direction: The direction of the ray, in world coordinates.
+ * 
+ * @return The index of the hit object, or -1 if no object is hit.
+ */
+int WorldContext::pickObject(const glm::vec3 &origin, const glm::vec3 &direction) const
+{
+    vector<SceneBVH::RayHit> hits;
+    sceneBVH.queryRay(origin, direction, hits);
+
+    int picked = -1;
+    float closest = numeric_limits<float>::max();
+    for(const SceneBVH::RayHit &hit : hits) {
+        if(hit.t > closest) break;
+        const SceneBVH::Item &item = sceneBVH.item(hit.item);
+
+        // The ray in the coordinates of the object keeps the same distances along it.
+        glm::mat4 invM = glm::inverse(item.M);
+        glm::vec3 objOrigin = glm::vec3(invM*glm::vec4(origin, 1.0f));
+        glm::vec3 objDirection = glm::vec3(invM*glm::vec4(direction, 0.0f));
+        float t = closest;
+        if(objects[item.objectIndex].meshBVH.intersect(objOrigin, objDirection, t)) {
+            closest = t;
+            picked = static_cast<int>(item.objectIndex);
+        }
+    }
+    return picked;
+}
+
+/**
+ * Function for selecting the object under a point on the screen. A
+ * ray is cast from the camera through the point, using the inverse of
+ * the projection and view matrices.
+ * 
+ * @param ndcX: The x coordinate of the point, from -1 to 1.
+ * @param ndcY: The y coordinate of the point, from -1 to 1.
+ * 
+ * @return True if an object was hit and selected.
+ */
+bool WorldContext::selectObjectAt(float ndcX, float ndcY)
+{
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    glm::mat4 invProjView = glm::inverse(matProj*matView);
+    glm::vec4 nearPoint = invProjView*glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = invProjView*glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint)/nearPoint.w;
+    glm::vec3 direction = glm::normalize(glm::vec3(farPoint)/farPoint.w - origin);
+
+    int picked = pickObject(origin, direction);
+    rInfo.pickTime = chrono::duration<double, micro>(chrono::steady_clock::now() - startTime).count();
+    if(picked < 0) return false;
+    selectObject(picked);
+    return true;
+}
+
+/**
+ * Function for adding an instance of a loaded object. The
+ * instance shares all the data of the object but is placed
+ * at its own position.
+ * 
+ * @param objIndex: The index of the object.
+ */
+void WorldContext::addInstance(int objIndex)
+{
+    objects[objIndex].addInstance();
+    sceneBVH.build(objects);
+    updateSceneSummary();
+}
+
+/**
+ * Function for removing the last added instance of a
+ * loaded object.
+ * 
+ * @param objIndex: The index of the object.
+ */
+void WorldContext::removeInstance(int objIndex)
+{
+    objects[objIndex].removeInstance();
+    if(objIndex == selectedObject) selectedInstance = std::min(selectedInstance, (int)objects[objIndex].getInstanceCount() - 1);
+    sceneBVH.build(objects);
+    updateSceneSummary();
+}
+
+/**
+ * Function for choosing which instance of the selected object
+ * is edited in the gui.
+ * 
+ * @param instance: The index of the instance.
+ */
+void WorldContext::selectInstance(int instance)
+{
+    if(objects.empty() || instance < 0 || instance >= (int)objects[selectedObject].getInstanceCount()) return;
+    selectedInstance = instance;
+    updateSceneSummary();
+}
+
+/**
+ * Function for placing the selected instance of the selected
+ * object. The scene BVH is refitted when the matrices are
+ * updated, since it only moves.
+ * 
+ * @param transform: The placement of the instance, relative to the model matrix.
+ */
+void WorldContext::setInstanceTransform(const Object::InstanceTransform &transform)
+{
+    if(objects.empty()) return;
+    objects[selectedObject].setInstanceTransform(selectedInstance, transform);
+    sceneSummary.instanceTransform = transform;
+    dirty.objects = true;
+}
+
+/**
+ * Function for making the generated normals of an object again
+ * after its crease angle or use of smoothing groups has changed.
+ * The number of vertices can change, so the scene summary is
+ * updated. The scene batch sees the new mesh revision of the
+ * object and writes only that object again.
+ * 
+ * @param objIndex: The index of the object.
+ * 
+ * @return True if the object must be sent to its buffers again.
+ */
+bool WorldContext::updateVertexNormals(int objIndex)
+{
+    if(objIndex < 0 || objIndex >= (int)objects.size()) return false;
+    Object &object = objects[objIndex];
+    bool changed = object.updateVertexNormals();
+    // The levels of detail are slow to build, so they wait until the crease angle is let go.
+    if(object.oInfo.lodsOutdated && !object.oInfo.editingNormals) {
+        object.buildLods();
+        changed = true;
+    }
+    if(!changed) return false;
+    updateSceneSummary();
+    return true;
+}
+
 /**
  * Function for clearing all the loaded objects
  * in the scene.
@@ -120,4 +331,39 @@ void WorldContext::clearObjects()
 {
     objects.clear();
     selectedObject = 0;
+    selectedInstance = 0;
+    sceneSummary.geometryRevision++;
+    sceneBVH.build(objects);
+    updateSceneSummary();
+}
+
+/**
+ * Function for rebuilding the scene summary that the gui
+ * reads every frame. It must be called whenever objects are
+ * added, removed or selected so that the gui never has to
+ * look at the objects themselves. The scene is drawn again.
+ */
+void WorldContext::updateSceneSummary()
+{
+    dirty.objects = true;
+    sceneSummary.entries.clear();
+    sceneSummary.totalVertices = 0;
+    sceneSummary.totalIndices = 0;
+    for(size_t i = 0; i < objects.size(); i++) {
+        SceneSummary::Entry entry;
+        entry.fileName = objects[i].fileName;
+        entry.selectLabel = "Select ##" + to_string(i);
+        entry.addInstanceLabel = "+##" + to_string(i);
+        entry.removeInstanceLabel = "-##" + to_string(i);
+        entry.nInstances = objects[i].getInstanceCount();
+        entry.nVertices = objects[i].oInfo.nVertices;
+        entry.nIndices = objects[i].oInfo.nIndices;
+        sceneSummary.totalVertices += (long long)entry.nVertices*entry.nInstances;
+        sceneSummary.totalIndices += (long long)entry.nIndices*entry.nInstances;
+        sceneSummary.entries.push_back(entry);
+    }
+    sceneSummary.selectedObject = selectedObject;
+    sceneSummary.selectedInstance = selectedInstance;
+    if(!objects.empty()) sceneSummary.instanceTransform = objects[selectedObject].getInstanceTransform(selectedInstance);
+    sceneSummary.revision++;
 }
\ No newline at end of file